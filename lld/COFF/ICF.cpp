@@ -49,25 +49,42 @@ private:
 
   size_t findBoundary(size_t Begin, size_t End);
 
-  void forEachColorRange(size_t Begin, size_t End,
+  void forEachClassRange(size_t Begin, size_t End,
                          std::function<void(size_t, size_t)> Fn);
 
-  void forEachColor(std::function<void(size_t, size_t)> Fn);
+  void forEachClass(std::function<void(size_t, size_t)> Fn);
 
   std::vector<SectionChunk *> Chunks;
-  int Cnt = 0;
-  std::atomic<uint32_t> NextId = {1};
+
+  // We repeat the main loop while `Repeat` is true.
   std::atomic<bool> Repeat = {false};
+
+  // The main loop counter.
+  int Cnt = 0;
+
+  // Chunks have two slots for equivalence classes, and we read from
+  // Class[Current] and write to Class[Next]. They are switched on each
+  // iteration of the main loop if threading is enabled, and are always
+  // (0, 0) otherwise. See ELF/ICF.cpp for the details.
+  int Current = 0;
+  int Next = 0;
 };
 
-// Returns a hash value for S.
+// Returns a hash value for S. Note that the information about
+// relocation targets is not included in the hash value.
 uint32_t ICF::getHash(SectionChunk *C) {
-  return hash_combine(C->getPermissions(),
-                      hash_value(C->SectionName),
-                      C->NumRelocs,
-                      C->getAlign(),
-                      uint32_t(C->Header->SizeOfRawData),
-                      C->Checksum);
+  ArrayRef<uint8_t> Contents = C->getContents();
+  hash_code H = hash_combine(C->getPermissions(),
+                             hash_value(C->SectionName),
+                             C->NumRelocs,
+                             C->getAlign(),
+                             uint32_t(C->Header->SizeOfRawData),
+                             C->Checksum,
+                             hash_combine_range(Contents.begin(),
+                                                Contents.end()));
+  for (const coff_relocation &R : C->Relocs)
+    H = hash_combine(H, uint16_t(R.Type), uint32_t(R.VirtualAddress));
+  return H;
 }
 
 // Returns true if section S is subject of ICF.
@@ -77,7 +94,7 @@ bool ICF::isEligible(SectionChunk *C) {
   return C->isCOMDAT() && C->isLive() && Global && !Writable;
 }
 
-// Split a range into smaller ranges by recoloring sections
+// Split an equivalence class into smaller classes.
 void ICF::segregate(size_t Begin, size_t End, bool Constant) {
   while (Begin < End) {
     // Divide [Begin, End) into two. Let Mid be the start index of the
@@ -90,10 +107,10 @@ void ICF::segregate(size_t Begin, size_t End, bool Constant) {
         });
     size_t Mid = Bound - Chunks.begin();
 
-    // Split [Begin, End) into [Begin, Mid) and [Mid, End).
-    uint32_t Id = NextId++;
+    // Split [Begin, End) into [Begin, Mid) and [Mid, End). We use Mid as
+    // an equivalence class ID because every group ends with a unique index.
     for (size_t I = Begin; I < Mid; ++I)
-      Chunks[I]->Color[(Cnt + 1) % 2] = Id;
+      Chunks[I]->Class[Next] = Mid;
 
     // If we created a group, we need to iterate the main loop again.
     if (Mid != End)
@@ -122,7 +139,8 @@ bool ICF::equalsConstant(const SectionChunk *A, const SectionChunk *B) {
     if (auto *D1 = dyn_cast<DefinedRegular>(B1))
       if (auto *D2 = dyn_cast<DefinedRegular>(B2))
         return D1->getValue() == D2->getValue() &&
-               D1->getChunk()->Color[Cnt % 2] == D2->getChunk()->Color[Cnt % 2];
+               D1->getChunk()->Class[Current] ==
+                   D2->getChunk()->Class[Current];
     return false;
   };
   if (!std::equal(A->Relocs.begin(), A->Relocs.end(), B->Relocs.begin(), Eq))
@@ -145,22 +163,30 @@ bool ICF::equalsVariable(const SectionChunk *A, const SectionChunk *B) {
     SymbolBody *B2 = B->File->getSymbolBody(R2.SymbolTableIndex);
     if (B1 == B2)
       return true;
-    if (auto *D1 = dyn_cast<DefinedRegular>(B1))
-      if (auto *D2 = dyn_cast<DefinedRegular>(B2))
-        return D1->getChunk()->Color[Cnt % 2] == D2->getChunk()->Color[Cnt % 2];
+    if (auto *D1 = dyn_cast<DefinedRegular>(B1)) {
+      if (auto *D2 = dyn_cast<DefinedRegular>(B2)) {
+        // Ineligible chunks are in the special equivalence class 0.
+        // They can never be the same in terms of the equivalence class.
+        uint32_t Class = D1->getChunk()->Class[Current];
+        return Class != 0 && Class == D2->getChunk()->Class[Current];
+      }
+    }
     return false;
   };
   return std::equal(A->Relocs.begin(), A->Relocs.end(), B->Relocs.begin(), Eq);
 }
 
 size_t ICF::findBoundary(size_t Begin, size_t End) {
+  uint32_t Class = Chunks[Begin]->Class[Current];
   for (size_t I = Begin + 1; I < End; ++I)
-    if (Chunks[Begin]->Color[Cnt % 2] != Chunks[I]->Color[Cnt % 2])
+    if (Class != Chunks[I]->Class[Current])
       return I;
   return End;
 }
 
-void ICF::forEachColorRange(size_t Begin, size_t End,
+// Chunks in the same equivalence class are contiguous in Chunks vector.
+// This function calls Fn on every group that starts within [Begin, End).
+void ICF::forEachClassRange(size_t Begin, size_t End,
                             std::function<void(size_t, size_t)> Fn) {
   if (Begin > 0)
     Begin = findBoundary(Begin - 1, End);
@@ -172,70 +198,71 @@ void ICF::forEachColorRange(size_t Begin, size_t End,
   }
 }
 
-// Call Fn on each color group.
-void ICF::forEachColor(std::function<void(size_t, size_t)> Fn) {
+// Call Fn on each equivalence class.
+void ICF::forEachClass(std::function<void(size_t, size_t)> Fn) {
   // If the number of sections are too small to use threading,
   // call Fn sequentially.
   if (Chunks.size() < 1024) {
-    forEachColorRange(0, Chunks.size(), Fn);
+    forEachClassRange(0, Chunks.size(), Fn);
+    ++Cnt;
     return;
   }
 
+  Current = Cnt % 2;
+  Next = (Cnt + 1) % 2;
+
   // Split sections into 256 shards and call Fn in parallel.
   size_t NumShards = 256;
   size_t Step = Chunks.size() / NumShards;
   parallel_for(size_t(0), NumShards, [&](size_t I) {
-    forEachColorRange(I * Step, (I + 1) * Step, Fn);
+    forEachClassRange(I * Step, (I + 1) * Step, Fn);
   });
-  forEachColorRange(Step * NumShards, Chunks.size(), Fn);
+  forEachClassRange(Step * NumShards, Chunks.size(), Fn);
+  ++Cnt;
 }
 
 // Merge identical COMDAT sections.
 // Two sections are considered the same if their section headers,
 // contents and relocations are all the same.
 void ICF::run(const std::vector<Chunk *> &Vec) {
-  // Collect only mergeable sections and group by hash value.
-  for (Chunk *C : Vec) {
-    auto *SC = dyn_cast<SectionChunk>(C);
-    if (!SC)
-      continue;
-
-    if (isEligible(SC)) {
-      // Set MSB to 1 to avoid collisions with non-hash colors.
-      SC->Color[0] = getHash(SC) | (1 << 31);
-      Chunks.push_back(SC);
-    } else {
-      SC->Color[0] = NextId++;
-    }
-  }
+  // Collect only mergeable sections. Ineligible ones stay in class 0.
+  for (Chunk *C : Vec)
+    if (auto *SC = dyn_cast<SectionChunk>(C))
+      if (isEligible(SC))
+        Chunks.push_back(SC);
 
   if (Chunks.empty())
     return;
 
+  // Initially, we use hash values to partition sections. Hashing
+  // contents and relocations is done in parallel.
+  parallel_for_each(Chunks.begin(), Chunks.end(), [&](SectionChunk *SC) {
+    // Set MSB to 1 to avoid collisions with non-hash IDs.
+    SC->Class[0] = getHash(SC) | (1 << 31);
+  });
+
   // From now on, sections in Chunks are ordered so that sections in
   // the same group are consecutive in the vector.
   std::stable_sort(Chunks.begin(), Chunks.end(),
                    [](SectionChunk *A, SectionChunk *B) {
-                     return A->Color[0] < B->Color[0];
+                     return A->Class[0] < B->Class[0];
                    });
 
   // Compare static contents and assign unique IDs for each static content.
-  forEachColor([&](size_t Begin, size_t End) { segregate(Begin, End, true); });
-  ++Cnt;
+  forEachClass([&](size_t Begin, size_t End) { segregate(Begin, End, true); });
 
   // Split groups by comparing relocations until convergence is obtained.
   do {
     Repeat = false;
-    forEachColor(
+    forEachClass(
         [&](size_t Begin, size_t End) { segregate(Begin, End, false); });
-    ++Cnt;
   } while (Repeat);
 
   if (Config->Verbose)
     outs() << "\nICF needed " << Cnt << " iterations\n";
 
-  // Merge sections in the same colors.
-  forEachColor([&](size_t Begin, size_t End) {
+  // Merge sections in the same classes.
+  forEachClass([&](size_t Begin, size_t End) {
     if (End - Begin == 1)
       return;
 
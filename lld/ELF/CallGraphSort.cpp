@@ -0,0 +1,269 @@
+//===- CallGraphSort.cpp --------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements function layout based on a call graph profile given
+// by --call-graph-ordering-file. Each line of the file has the form
+//
+//   <caller symbol> <callee symbol> <number of calls>
+//
+// and such a file can be created from sampled profiles (e.g. perf LBR
+// records) by a separate tool. Placing functions that call each other
+// frequently next to each other reduces i-TLB and i-cache misses.
+//
+// We use the C3 (call-chain clustering) heuristic described in [1]. Each
+// section starts as its own cluster. We then visit clusters in decreasing
+// order of density (number of calls divided by size) and merge each
+// cluster into the cluster containing its most frequent caller, unless
+// the merged cluster would become too large or too sparse. Finally,
+// clusters are sorted by density so that hot code is packed at the
+// beginning of the output section.
+//
+// [1] Ottoni, Guilherme, and Bertrand Maher. "Optimizing function placement
+// for large-scale data-center applications." Proceedings of the 2017
+// International Symposium on Code Generation and Optimization. IEEE Press,
+// 2017.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallGraphSort.h"
+#include "Config.h"
+#include "Error.h"
+#include "InputSection.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace llvm::object;
+using namespace lld;
+using namespace lld::elf;
+
+namespace {
+struct Edge {
+  int From = -1;
+  uint64_t Weight = 0;
+};
+
+struct Cluster {
+  Cluster(int Sec, size_t Size) : Sections{Sec}, Size(Size) {}
+
+  double getDensity() const {
+    if (Size == 0)
+      return 0;
+    return double(Weight) / double(Size);
+  }
+
+  std::vector<int> Sections;
+  size_t Size = 0;
+  uint64_t Weight = 0;
+  uint64_t InitialWeight = 0;
+  Edge BestPred;
+};
+
+template <class ELFT> class CallGraphSort {
+public:
+  CallGraphSort();
+  DenseMap<InputSectionBase<ELFT> *, int> run();
+
+private:
+  void readProfile();
+  int getOrCreateNode(InputSection<ELFT> *IS);
+  void groupClusters();
+
+  std::vector<Cluster> Clusters;
+  std::vector<InputSection<ELFT> *> Sections;
+  DenseMap<InputSection<ELFT> *, int> SecToCluster;
+};
+} // namespace
+
+// Clusters are not merged if the density of the result would be less
+// than 1/8 of the density of the caller cluster.
+static const int MaxDensityDegradation = 8;
+
+// Clusters larger than this are not merged because they would no longer
+// fit in a few pages anyway.
+static const uint64_t MaxClusterSize = 1024 * 1024;
+
+template <class ELFT> CallGraphSort<ELFT>::CallGraphSort() {
+  readProfile();
+  for (Cluster &C : Clusters)
+    C.InitialWeight = C.Weight;
+}
+
+template <class ELFT>
+int CallGraphSort<ELFT>::getOrCreateNode(InputSection<ELFT> *IS) {
+  auto P = SecToCluster.insert({IS, Clusters.size()});
+  if (P.second) {
+    Sections.push_back(IS);
+    Clusters.emplace_back(Clusters.size(), IS->getSize());
+  }
+  return P.first->second;
+}
+
+// Reads --call-graph-ordering-file and builds a graph whose nodes are
+// input sections. Local symbols are accepted as well as global ones
+// because static functions are often hot. Since the profile only has
+// symbol names, names defined in more than one section are ignored.
+template <class ELFT> void CallGraphSort<ELFT>::readProfile() {
+  struct Call {
+    StringRef From;
+    StringRef To;
+    uint64_t Weight;
+  };
+  std::vector<Call> Calls;
+  DenseMap<StringRef, InputSection<ELFT> *> SymbolSections;
+
+  for (StringRef Line : Config->CallGraphOrderingFile) {
+    SmallVector<StringRef, 3> Fields;
+    Line.split(Fields, ' ', -1, false);
+    uint64_t Weight;
+    if (Fields.size() != 3 || Fields[2].getAsInteger(10, Weight)) {
+      error("--call-graph-ordering-file: invalid line: " + Line);
+      continue;
+    }
+    Calls.push_back({Fields[0], Fields[1], Weight});
+    SymbolSections[Fields[0]] = nullptr;
+    SymbolSections[Fields[1]] = nullptr;
+  }
+
+  DenseSet<StringRef> Ambiguous;
+  for (elf::ObjectFile<ELFT> *File : Symtab<ELFT>::X->getObjectFiles()) {
+    for (SymbolBody *Body : File->getSymbols()) {
+      auto *D = dyn_cast<DefinedRegular<ELFT>>(Body);
+      if (!D || !D->Section || !D->Section->Live)
+        continue;
+      auto It = SymbolSections.find(D->getName());
+      if (It == SymbolSections.end())
+        continue;
+      auto *IS = dyn_cast<InputSection<ELFT>>(D->Section->Repl);
+      if (!IS)
+        continue;
+      if (!It->second)
+        It->second = IS;
+      else if (It->second != IS && Ambiguous.insert(It->first).second)
+        warn("--call-graph-ordering-file: " + It->first +
+             " is defined in more than one section; ignoring it");
+    }
+  }
+  for (StringRef Name : Ambiguous)
+    SymbolSections.erase(Name);
+
+  for (const Call &C : Calls) {
+    InputSection<ELFT> *FromSec = SymbolSections.lookup(C.From);
+    InputSection<ELFT> *ToSec = SymbolSections.lookup(C.To);
+    if (!FromSec || !ToSec || C.Weight == 0)
+      continue;
+
+    // Ignore edges between sections in different output sections because
+    // we cannot place them next to each other.
+    if (FromSec->OutSec != ToSec->OutSec)
+      continue;
+
+    int From = getOrCreateNode(FromSec);
+    int To = getOrCreateNode(ToSec);
+    Clusters[To].Weight += C.Weight;
+    if (From == To)
+      continue;
+
+    // Remember the most frequent caller.
+    Edge &Best = Clusters[To].BestPred;
+    if (Best.From == -1 || Best.Weight < C.Weight) {
+      Best.From = From;
+      Best.Weight = C.Weight;
+    }
+  }
+}
+
+static bool isNewDensityBad(Cluster &A, Cluster &B) {
+  double NewDensity = double(A.Weight + B.Weight) / double(A.Size + B.Size);
+  return NewDensity < A.getDensity() / MaxDensityDegradation;
+}
+
+static void mergeClusters(Cluster &Into, Cluster &From) {
+  Into.Sections.insert(Into.Sections.end(), From.Sections.begin(),
+                       From.Sections.end());
+  Into.Size += From.Size;
+  Into.Weight += From.Weight;
+  From.Sections.clear();
+  From.Size = 0;
+  From.Weight = 0;
+}
+
+// Groups sections into clusters using the C3 heuristic.
+template <class ELFT> void CallGraphSort<ELFT>::groupClusters() {
+  std::vector<int> SortedSecs(Clusters.size());
+  std::vector<Cluster *> Leaders(Clusters.size());
+  for (size_t I = 0, E = Clusters.size(); I != E; ++I) {
+    SortedSecs[I] = I;
+    Leaders[I] = &Clusters[I];
+  }
+
+  std::stable_sort(SortedSecs.begin(), SortedSecs.end(), [&](int A, int B) {
+    return Clusters[A].getDensity() > Clusters[B].getDensity();
+  });
+
+  for (int I : SortedSecs) {
+    Cluster &C = Clusters[I];
+
+    // Don't merge a cluster into its caller if the caller accounts for
+    // only a small fraction of its calls.
+    if (C.BestPred.From == -1 || C.BestPred.Weight * 10 <= C.InitialWeight)
+      continue;
+
+    Cluster *Pred = Leaders[C.BestPred.From];
+    if (Pred == &C || C.Size + Pred->Size > MaxClusterSize ||
+        isNewDensityBad(*Pred, C))
+      continue;
+
+    for (int Sec : C.Sections)
+      Leaders[Sec] = Pred;
+    mergeClusters(*Pred, C);
+  }
+
+  Clusters.erase(std::remove_if(Clusters.begin(), Clusters.end(),
+                                [](const Cluster &C) {
+                                  return C.Sections.empty();
+                                }),
+                 Clusters.end());
+
+  std::stable_sort(Clusters.begin(), Clusters.end(),
+                   [](const Cluster &A, const Cluster &B) {
+                     return A.getDensity() > B.getDensity();
+                   });
+}
+
+// Returns a map from sections to their priorities. All sections in the
+// call graph get negative (higher) priorities in the order of clusters.
+template <class ELFT>
+DenseMap<InputSectionBase<ELFT> *, int> CallGraphSort<ELFT>::run() {
+  groupClusters();
+
+  DenseMap<InputSectionBase<ELFT> *, int> Ret;
+  int Priority = -Sections.size();
+  for (const Cluster &C : Clusters)
+    for (int Sec : C.Sections)
+      Ret[Sections[Sec]] = Priority++;
+  return Ret;
+}
+
+template <class ELFT>
+DenseMap<InputSectionBase<ELFT> *, int> elf::computeCallGraphOrder() {
+  return CallGraphSort<ELFT>().run();
+}
+
+template DenseMap<InputSectionBase<ELF32LE> *, int>
+elf::computeCallGraphOrder<ELF32LE>();
+template DenseMap<InputSectionBase<ELF32BE> *, int>
+elf::computeCallGraphOrder<ELF32BE>();
+template DenseMap<InputSectionBase<ELF64LE> *, int>
+elf::computeCallGraphOrder<ELF64LE>();
+template DenseMap<InputSectionBase<ELF64BE> *, int>
+elf::computeCallGraphOrder<ELF64BE>();
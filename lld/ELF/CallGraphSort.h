@@ -0,0 +1,26 @@
+//===- CallGraphSort.h ------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_CALL_GRAPH_SORT_H
+#define LLD_ELF_CALL_GRAPH_SORT_H
+
+#include "llvm/ADT/DenseMap.h"
+
+namespace lld {
+namespace elf {
+template <class ELFT> class InputSectionBase;
+
+// Returns section priorities computed from --call-graph-ordering-file.
+// Sections that are not in the map have the lowest priority 0.
+template <class ELFT>
+llvm::DenseMap<InputSectionBase<ELFT> *, int> computeCallGraphOrder();
+}
+}
+
+#endif
@@ -79,14 +79,17 @@ struct Configuration {
   llvm::StringRef Fini;
   llvm::StringRef Init;
   llvm::StringRef LTOAAPipeline;
+  llvm::StringRef LTOCacheDir;
   llvm::StringRef LTONewPmPasses;
   llvm::StringRef OutputFile;
   llvm::StringRef SoName;
   llvm::StringRef Sysroot;
+  llvm::StringRef ThinLTOCacheDir;
   llvm::StringSet<> RetainSymbolsFile;
   std::string RPath;
   std::vector<VersionDefinition> VersionDefinitions;
   std::vector<llvm::StringRef> AuxiliaryList;
+  std::vector<llvm::StringRef> CallGraphOrderingFile;
   std::vector<llvm::StringRef> SearchPaths;
   std::vector<llvm::StringRef> SymbolOrderingFile;
   std::vector<llvm::StringRef> Undefined;
@@ -108,8 +111,10 @@ struct Configuration {
   bool GdbIndex;
   bool GnuHash = false;
   bool ICF;
+  bool Incremental;
   bool Mips64EL = false;
   bool MipsN32Abi = false;
+  bool MmapOutputFile;
   bool NoGnuUnique;
   bool NoUndefinedVersion;
   bool Nostdlib;
@@ -118,6 +123,7 @@ struct Configuration {
   bool Pic;
   bool Pie;
   bool PrintGcSections;
+  bool PrintStats;
   bool Rela;
   bool Relocatable;
   bool SaveTemps;
@@ -151,10 +157,14 @@ struct Configuration {
   uint64_t ErrorLimit = 20;
   uint64_t ImageBase;
   uint64_t MaxPageSize;
+  uint64_t ThinLTOCachePruneAfter = 7 * 24 * 60 * 60;
+  uint64_t ThinLTOCachePruneInterval = 20 * 60;
   uint64_t ZStackSize;
+  unsigned IncrementalPadding;
   unsigned LTOPartitions;
   unsigned LTOO;
   unsigned Optimize;
+  unsigned ThinLTOCacheMaxSize = 75;
   unsigned ThinLTOJobs;
 };
 
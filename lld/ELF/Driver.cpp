@@ -11,6 +11,7 @@
 #include "Config.h"
 #include "Error.h"
 #include "ICF.h"
+#include "Incremental.h"
 #include "InputFiles.h"
 #include "InputSection.h"
 #include "LinkerScript.h"
@@ -54,6 +55,7 @@ bool elf::link(ArrayRef<const char *> Args, bool CanExitEarly,
   Config = make<Configuration>();
   Driver = make<LinkerDriver>();
   ScriptConfig = make<ScriptConfiguration>();
+  resetIncrementalState();
 
   Driver->main(Args, CanExitEarly);
   freeArena();
@@ -184,6 +186,8 @@ Optional<MemoryBufferRef> LinkerDriver::readFile(StringRef Path) {
 
   if (Cpio)
     Cpio->append(relativeToRoot(Path), MBRef.getBuffer());
+  if (Config->Incremental)
+    addIncrementalInput(Saver.save(Path), MBRef);
 
   return MBRef;
 }
@@ -225,6 +229,11 @@ static void checkOptions(opt::InputArgList &Args) {
   if (Config->Pie && Config->Shared)
     error("-shared and -pie may not be used together");
 
+  if (!Config->CallGraphOrderingFile.empty() &&
+      !Config->SymbolOrderingFile.empty())
+    error("--symbol-ordering-file and --call-graph-ordering-file "
+          "may not be used together");
+
   if (Config->Relocatable) {
     if (Config->Shared)
       error("-r and -shared may not be used together");
@@ -234,6 +243,8 @@ static void checkOptions(opt::InputArgList &Args) {
       error("-r and --icf may not be used together");
     if (Config->Pie)
       error("-r and -pie may not be used together");
+    if (Config->Incremental)
+      error("-r and --incremental may not be used together");
   }
 }
 
@@ -254,6 +265,51 @@ static int getInteger(opt::InputArgList &Args, unsigned Key, int Default) {
   return V;
 }
 
+// Parses a duration such as "30s", "20m" or "1h" and returns it in seconds.
+static bool parseDuration(StringRef S, uint64_t &Seconds) {
+  if (S.empty())
+    return false;
+  uint64_t Mul = StringSwitch<uint64_t>(S.take_back())
+                     .Case("h", 60 * 60)
+                     .Case("m", 60)
+                     .Case("s", 1)
+                     .Default(0);
+  if (Mul)
+    S = S.drop_back();
+  else
+    Mul = 1;
+  if (S.getAsInteger(10, Seconds))
+    return false;
+  Seconds *= Mul;
+  return true;
+}
+
+// Parses --thinlto-cache-policy. The argument is a colon-separated list
+// of key=value pairs, e.g. "prune_interval=20m:prune_after=1h:cache_size=50%".
+static void parseCachePolicy(StringRef Policy) {
+  SmallVector<StringRef, 3> Fields;
+  Policy.split(Fields, ':', -1, false);
+  for (StringRef Field : Fields) {
+    StringRef Key, Value;
+    std::tie(Key, Value) = Field.split('=');
+    bool Ok;
+    if (Key == "prune_interval") {
+      Ok = parseDuration(Value, Config->ThinLTOCachePruneInterval);
+    } else if (Key == "prune_after") {
+      Ok = parseDuration(Value, Config->ThinLTOCachePruneAfter);
+    } else if (Key == "cache_size") {
+      Ok = Value.endswith("%") &&
+           !Value.drop_back().getAsInteger(10, Config->ThinLTOCacheMaxSize) &&
+           Config->ThinLTOCacheMaxSize <= 100;
+    } else {
+      error("--thinlto-cache-policy: unknown key: " + Key);
+      continue;
+    }
+    if (!Ok)
+      error("--thinlto-cache-policy: invalid value for " + Key + ": " + Value);
+  }
+}
+
 static const char *getReproduceOption(opt::InputArgList &Args) {
   if (auto *Arg = Args.getLastArg(OPT_reproduce))
     return Arg->getValue();
@@ -320,6 +376,12 @@ void LinkerDriver::main(ArrayRef<const char *> ArgsArr, bool CanExitEarly) {
   }
 
   readConfigs(Args);
+
+  // If the previous output can be updated in place, we are done.
+  if (Config->Incremental && !Config->Relocatable &&
+      tryIncrementalLink(Args))
+    return;
+
   initLLVM(Args);
   createFiles(Args);
   inferMachineType();
@@ -501,12 +563,17 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->GcSections = getArg(Args, OPT_gc_sections, OPT_no_gc_sections, false);
   Config->GdbIndex = Args.hasArg(OPT_gdb_index);
   Config->ICF = Args.hasArg(OPT_icf);
+  Config->Incremental =
+      getArg(Args, OPT_incremental, OPT_no_incremental, false);
+  Config->MmapOutputFile =
+      getArg(Args, OPT_mmap_output_file, OPT_no_mmap_output_file, true);
   Config->NoGnuUnique = Args.hasArg(OPT_no_gnu_unique);
   Config->NoUndefinedVersion = Args.hasArg(OPT_no_undefined_version);
   Config->Nostdlib = Args.hasArg(OPT_nostdlib);
   Config->OMagic = Args.hasArg(OPT_omagic);
   Config->Pie = getArg(Args, OPT_pie, OPT_nopie, false);
   Config->PrintGcSections = Args.hasArg(OPT_print_gc_sections);
+  Config->PrintStats = Args.hasArg(OPT_stats);
   Config->Relocatable = Args.hasArg(OPT_relocatable);
   Config->Discard = getDiscardOption(Args);
   Config->SaveTemps = Args.hasArg(OPT_save_temps);
@@ -523,12 +590,15 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->Fini = getString(Args, OPT_fini, "_fini");
   Config->Init = getString(Args, OPT_init, "_init");
   Config->LTOAAPipeline = getString(Args, OPT_lto_aa_pipeline);
+  Config->LTOCacheDir = getString(Args, OPT_lto_cache_dir);
   Config->LTONewPmPasses = getString(Args, OPT_lto_newpm_passes);
   Config->OutputFile = getString(Args, OPT_o);
   Config->SoName = getString(Args, OPT_soname);
   Config->Sysroot = getString(Args, OPT_sysroot);
+  Config->ThinLTOCacheDir = getString(Args, OPT_thinlto_cache_dir);
 
   Config->Optimize = getInteger(Args, OPT_O, 1);
+  Config->IncrementalPadding = getInteger(Args, OPT_incremental_padding, 25);
   Config->LTOO = getInteger(Args, OPT_lto_O, 2);
   if (Config->LTOO > 3)
     error("invalid optimization level for LTO: " + getString(Args, OPT_lto_O));
@@ -538,6 +608,7 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->ThinLTOJobs = getInteger(Args, OPT_thinlto_jobs, -1u);
   if (Config->ThinLTOJobs == 0)
     error("--thinlto-jobs: number of threads must be > 0");
+  parseCachePolicy(getString(Args, OPT_thinlto_cache_policy));
 
   Config->ZCombreloc = !hasZOption(Args, "nocombreloc");
   Config->ZExecstack = hasZOption(Args, "execstack");
@@ -615,6 +686,10 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
     if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
       Config->SymbolOrderingFile = getLines(*Buffer);
 
+  if (auto *Arg = Args.getLastArg(OPT_call_graph_ordering_file))
+    if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
+      Config->CallGraphOrderingFile = getLines(*Buffer);
+
   // If --retain-symbol-file is used, we'll retail only the symbols listed in
   // the file and discard all others.
   if (auto *Arg = Args.getLastArg(OPT_retain_symbols_file)) {
@@ -753,6 +828,7 @@ static uint64_t getImageBase(opt::InputArgList &Args) {
 template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   SymbolTable<ELFT> Symtab;
   elf::Symtab<ELFT>::X = &Symtab;
+  SymbolSideTables<ELFT>::clear();
   Target = createTarget();
   ScriptBase = Script<ELFT>::X = make<LinkerScript<ELFT>>();
 
@@ -779,6 +855,14 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   for (auto *Arg : Args.filtered(OPT_trace_symbol))
     Symtab.trace(Arg->getValue());
 
+  // Read section headers and symbol tables of object files in parallel.
+  // This is file-local work, so it doesn't affect the order in which
+  // symbols are added to the symbol table below.
+  forEach(Files.begin(), Files.end(), [](InputFile *F) {
+    if (isa<elf::ObjectFile<ELFT>>(F) && F->EKind == Config->EKind)
+      cast<elf::ObjectFile<ELFT>>(F)->preParse();
+  });
+
   // Add all files to the symbol table. This will add almost all
   // symbols that we need to the symbol table.
   for (InputFile *F : Files)
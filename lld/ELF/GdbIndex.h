@@ -11,6 +11,7 @@
 #define LLD_ELF_GDB_INDEX_H
 
 #include "InputFiles.h"
+#include "llvm/ADT/CachedHashString.h"
 #include "llvm/Object/ELF.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 
@@ -27,6 +28,24 @@ template <class ELFT> struct AddressEntry {
   size_t CuIndex;
 };
 
+// Public name or type read from .debug_gnu_pub{names,types}. Both hash values
+// (one for the string pool and one for the .gdb_index symbol table) are
+// computed when the entry is read so that the work is done in parallel.
+struct NameTypeEntry {
+  llvm::CachedHashStringRef Name;
+  uint32_t Hash;
+  uint8_t Type;
+};
+
+// Data extracted from a single .debug_info section. CU indices are local
+// to the section; they are adjusted when chunks are merged.
+template <class ELFT> struct GdbIndexChunk {
+  std::vector<std::pair<typename ELFT::uint, typename ELFT::uint>>
+      CompilationUnits;
+  std::vector<AddressEntry<ELFT>> AddressArea;
+  std::vector<NameTypeEntry> NamesAndTypes;
+};
+
 // GdbIndexBuilder is a helper class used for extracting data required
 // for building .gdb_index section from objects.
 template <class ELFT> class GdbIndexBuilder : public llvm::LoadedObjectInfo {
@@ -39,6 +58,9 @@ template <class ELFT> class GdbIndexBuilder : public llvm::LoadedObjectInfo {
 public:
   GdbIndexBuilder(InputSection<ELFT> *DebugInfoSec);
 
+  // Returns false if a DWARF context could not be created.
+  bool isValid() const { return Dwarf != nullptr; }
+
   // Extracts the compilation units. Each first element of pair is a offset of a
   // CU in the .debug_info section and second is the length of that CU.
   std::vector<std::pair<uintX_t, uintX_t>> readCUList();
@@ -0,0 +1,1051 @@
+//===- Incremental.cpp ----------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --incremental.
+//
+// When --incremental is given, the linker reserves some space after each
+// allocated input section (--incremental-padding percent of its size) and
+// saves a state file next to the output file after writing it. The state
+// file contains the identities (sizes, timestamps and hashes) of all files
+// read by the linker, hash values of the ELF header and each section header
+// and section contents of each object file, and, for sections that can be
+// patched, their locations in the output and the values the linker wrote
+// for their relocations.
+//
+// The next link with the same command line compares the input files with
+// the saved state before parsing them. If nothing has changed, the output
+// is up to date and we are done. If only the contents of patchable
+// sections of some object files have changed, and each changed section
+// still fits in the space reserved for it, all sections and symbols stay
+// at the same addresses. In that case we copy new section contents to the
+// output and apply relocations again. Otherwise, we fall back to a full
+// link.
+//
+// If the relocation records of a section have changed, the new relocated
+// values are computed from values saved by the previous link. That works
+// for relocations whose values are S + A or S + A - P for pairs of
+// a symbol S and a relocation type that were used in the same file before.
+// Symbol sizes are updated in .symtab and .dynsym. FDEs in .eh_frame can
+// be patched if their sizes don't change.
+//
+// We are conservative about patchable sections. Sections whose relocations
+// are relaxed (which rewrites instructions around relocated locations),
+// sections with thunks and sections that have changed sizes beyond the
+// reserved space are not patchable. Patching is disabled entirely for
+// targets whose addends are stored in section contents, for MIPS, and if
+// the output contains data derived from section contents such as
+// a build-id or .gdb_index. No space is reserved if a linker script
+// assigns addresses with SECTIONS commands.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "Config.h"
+#include "Driver.h"
+#include "Error.h"
+#include "InputFiles.h"
+#include "InputSection.h"
+#include "LinkerScript.h"
+#include "OutputSections.h"
+#include "SymbolTable.h"
+#include "SyntheticSections.h"
+#include "Target.h"
+#include "Threads.h"
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+using namespace llvm::ELF;
+using namespace llvm::object;
+using namespace llvm::support;
+using namespace llvm::support::endian;
+
+using namespace lld;
+using namespace lld::elf;
+
+namespace {
+// A value written for a relocation. Offset is relative to the beginning
+// of the section.
+struct RelocRecord {
+  uint64_t Offset;
+  uint64_t Value;
+  uint32_t Type;
+};
+
+// A CIE or an FDE of an .eh_frame section. OutputOff is relative to
+// the beginning of the output section, or -1 if the piece is dead.
+struct PieceRecord {
+  uint64_t InputOff;
+  uint64_t Size;
+  uint64_t OutputOff;
+  uint64_t Hash;
+};
+
+struct SectionRecord {
+  uint64_t HeaderHash = 0;
+  uint64_t ContentHash = 0;
+  uint64_t Size = 0;
+
+  // The file offset and the address of the section in the output file,
+  // or -1 if the section is not patchable. For .eh_frame, they are those
+  // of the output section and Pieces tell where each piece is.
+  uint64_t OutputOffset = -1;
+  uint64_t Addr = 0;
+
+  // The size up to which the section can grow in place.
+  uint64_t Capacity = 0;
+  std::vector<PieceRecord> Pieces;
+  std::vector<RelocRecord> Relocs;
+};
+
+// Tells that relocations of a given type to a given symbol in sections of
+// a given kind (see getSectionKind) have value Base + A, or Base + A - P
+// if PCRel is set.
+struct TargetRecord {
+  uint32_t SymIndex;
+  uint32_t Type;
+  uint32_t Kind;
+  uint32_t PCRel;
+  uint64_t Base;
+};
+
+// The file offset of the st_size field of a symbol in the output.
+// Index is the symbol's index in the object file.
+struct SymbolRecord {
+  uint32_t Index;
+  uint64_t Offset;
+};
+
+struct InputRecord {
+  std::string Path;
+  uint64_t Size = 0;
+  uint64_t Time = 0;
+  uint64_t Hash = 0;
+
+  // These are set only for object files that are not in archives.
+  uint64_t HeaderHash = 0;
+  std::vector<SectionRecord> Sections;
+  std::vector<TargetRecord> Targets;
+  std::vector<SymbolRecord> Symbols;
+};
+
+struct State {
+  uint64_t ArgsHash = 0;
+  uint64_t OutputSize = 0;
+  uint64_t OutputTime = 0;
+  uint32_t EKind = ELFNoneKind;
+  uint32_t EMachine = EM_NONE;
+  uint32_t CanPatch = 0;
+  std::vector<InputRecord> Inputs;
+};
+
+// Hash values and contents of sections of an object file. Hash values
+// don't cover section offsets and sizes in section headers and symbol
+// sizes, which are compared separately.
+struct ObjectInfo {
+  uint64_t HeaderHash = 0;
+  std::vector<SectionRecord> Sections;
+  std::vector<ArrayRef<uint8_t>> Contents;
+  std::vector<uint32_t> Types;
+  std::vector<uint32_t> Infos;
+  std::vector<uint64_t> Flags;
+  std::vector<uint64_t> SymbolSizes;
+};
+
+// Reads little-endian values from a state file.
+class StateReader {
+public:
+  StateReader(StringRef Data) : Data(Data) {}
+
+  template <class T> T read() {
+    if (Data.size() < sizeof(T)) {
+      Err = true;
+      return 0;
+    }
+    T V = endian::read<T, little, unaligned>(Data.data());
+    Data = Data.drop_front(sizeof(T));
+    return V;
+  }
+
+  StringRef readString() {
+    uint32_t Size = read<uint32_t>();
+    if (Data.size() < Size) {
+      Err = true;
+      return "";
+    }
+    StringRef S = Data.substr(0, Size);
+    Data = Data.drop_front(Size);
+    return S;
+  }
+
+  // Reads the number of elements of an array whose elements are
+  // at least ElemSize bytes long.
+  size_t readCount(size_t ElemSize) {
+    uint32_t N = read<uint32_t>();
+    if (Data.size() / ElemSize < N) {
+      Err = true;
+      return 0;
+    }
+    return N;
+  }
+
+  StringRef Data;
+  bool Err = false;
+};
+} // anonymous namespace
+
+static const char Magic[] = "LLDINC02";
+
+// Files read by the driver and a hash value of the command line. They
+// refer to memory that is freed at the end of each link, so they are
+// reset at the start of each link.
+static std::vector<std::pair<StringRef, MemoryBufferRef>> InputFiles;
+static uint64_t ArgsHash;
+
+static StringRef getOutputPath() {
+  return Config->OutputFile.empty() ? "a.out" : Config->OutputFile;
+}
+
+static std::string getStatePath() {
+  return (getOutputPath() + ".incremental").str();
+}
+
+static bool getFileStatus(StringRef Path, uint64_t &Size, uint64_t &Time) {
+  sys::fs::file_status St;
+  if (sys::fs::status(Path, St))
+    return false;
+  Size = St.getSize();
+  Time = St.getLastModificationTime().time_since_epoch().count();
+  return true;
+}
+
+static uint64_t hashBytes(const void *P, size_t Size) {
+  return xxHash64(StringRef((const char *)P, Size));
+}
+
+static bool readState(StringRef Path, State &S) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = MemoryBuffer::getFile(Path);
+  if (!MBOrErr)
+    return false;
+
+  StringRef Data = (*MBOrErr)->getBuffer();
+  if (!Data.startswith(StringRef(Magic, 8)))
+    return false;
+
+  StateReader R(Data.drop_front(8));
+  S.ArgsHash = R.read<uint64_t>();
+  S.OutputSize = R.read<uint64_t>();
+  S.OutputTime = R.read<uint64_t>();
+  S.EKind = R.read<uint32_t>();
+  S.EMachine = R.read<uint32_t>();
+  S.CanPatch = R.read<uint32_t>();
+
+  S.Inputs.resize(R.readCount(48));
+  for (InputRecord &In : S.Inputs) {
+    In.Path = R.readString();
+    In.Size = R.read<uint64_t>();
+    In.Time = R.read<uint64_t>();
+    In.Hash = R.read<uint64_t>();
+    In.HeaderHash = R.read<uint64_t>();
+
+    In.Sections.resize(R.readCount(56));
+    for (SectionRecord &Sec : In.Sections) {
+      Sec.HeaderHash = R.read<uint64_t>();
+      Sec.ContentHash = R.read<uint64_t>();
+      Sec.Size = R.read<uint64_t>();
+      Sec.OutputOffset = R.read<uint64_t>();
+      Sec.Addr = R.read<uint64_t>();
+      Sec.Capacity = R.read<uint64_t>();
+
+      Sec.Pieces.resize(R.readCount(32));
+      for (PieceRecord &P : Sec.Pieces) {
+        P.InputOff = R.read<uint64_t>();
+        P.Size = R.read<uint64_t>();
+        P.OutputOff = R.read<uint64_t>();
+        P.Hash = R.read<uint64_t>();
+      }
+
+      Sec.Relocs.resize(R.readCount(20));
+      for (RelocRecord &Rel : Sec.Relocs) {
+        Rel.Offset = R.read<uint64_t>();
+        Rel.Value = R.read<uint64_t>();
+        Rel.Type = R.read<uint32_t>();
+      }
+    }
+
+    In.Targets.resize(R.readCount(24));
+    for (TargetRecord &T : In.Targets) {
+      T.SymIndex = R.read<uint32_t>();
+      T.Type = R.read<uint32_t>();
+      T.Kind = R.read<uint32_t>();
+      T.PCRel = R.read<uint32_t>();
+      T.Base = R.read<uint64_t>();
+    }
+
+    In.Symbols.resize(R.readCount(12));
+    for (SymbolRecord &Sym : In.Symbols) {
+      Sym.Index = R.read<uint32_t>();
+      Sym.Offset = R.read<uint64_t>();
+    }
+  }
+  return !R.Err && R.Data.empty();
+}
+
+static void writeState(const State &S, StringRef Path) {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+  if (EC) {
+    warn("cannot write " + Path + ": " + EC.message());
+    return;
+  }
+
+  endian::Writer<little> W(OS);
+  OS << StringRef(Magic, 8);
+  W.write<uint64_t>(S.ArgsHash);
+  W.write<uint64_t>(S.OutputSize);
+  W.write<uint64_t>(S.OutputTime);
+  W.write<uint32_t>(S.EKind);
+  W.write<uint32_t>(S.EMachine);
+  W.write<uint32_t>(S.CanPatch);
+
+  W.write<uint32_t>(S.Inputs.size());
+  for (const InputRecord &In : S.Inputs) {
+    W.write<uint32_t>(In.Path.size());
+    OS << In.Path;
+    W.write<uint64_t>(In.Size);
+    W.write<uint64_t>(In.Time);
+    W.write<uint64_t>(In.Hash);
+    W.write<uint64_t>(In.HeaderHash);
+
+    W.write<uint32_t>(In.Sections.size());
+    for (const SectionRecord &Sec : In.Sections) {
+      W.write<uint64_t>(Sec.HeaderHash);
+      W.write<uint64_t>(Sec.ContentHash);
+      W.write<uint64_t>(Sec.Size);
+      W.write<uint64_t>(Sec.OutputOffset);
+      W.write<uint64_t>(Sec.Addr);
+      W.write<uint64_t>(Sec.Capacity);
+
+      W.write<uint32_t>(Sec.Pieces.size());
+      for (const PieceRecord &P : Sec.Pieces) {
+        W.write<uint64_t>(P.InputOff);
+        W.write<uint64_t>(P.Size);
+        W.write<uint64_t>(P.OutputOff);
+        W.write<uint64_t>(P.Hash);
+      }
+
+      W.write<uint32_t>(Sec.Relocs.size());
+      for (const RelocRecord &Rel : Sec.Relocs) {
+        W.write<uint64_t>(Rel.Offset);
+        W.write<uint64_t>(Rel.Value);
+        W.write<uint32_t>(Rel.Type);
+      }
+    }
+
+    W.write<uint32_t>(In.Targets.size());
+    for (const TargetRecord &T : In.Targets) {
+      W.write<uint32_t>(T.SymIndex);
+      W.write<uint32_t>(T.Type);
+      W.write<uint32_t>(T.Kind);
+      W.write<uint32_t>(T.PCRel);
+      W.write<uint64_t>(T.Base);
+    }
+
+    W.write<uint32_t>(In.Symbols.size());
+    for (const SymbolRecord &Sym : In.Symbols) {
+      W.write<uint32_t>(Sym.Index);
+      W.write<uint64_t>(Sym.Offset);
+    }
+  }
+}
+
+// Computes hash values of the ELF header and each section header and
+// section contents of a given object file. Section contents are also
+// returned so that the caller can copy them to the output.
+template <class ELFT>
+static bool getFingerprints(StringRef Buf, ObjectInfo &Ret) {
+  typedef typename ELFT::Ehdr Elf_Ehdr;
+  typedef typename ELFT::Shdr Elf_Shdr;
+  typedef typename ELFT::Sym Elf_Sym;
+
+  if (Buf.size() < sizeof(Elf_Ehdr))
+    return false;
+  ELFFile<ELFT> Obj(Buf);
+
+  // Section headers move if sections grow.
+  Elf_Ehdr Hdr = *Obj.getHeader();
+  Hdr.e_shoff = 0;
+  Ret.HeaderHash = hashBytes(&Hdr, sizeof(Hdr));
+
+  Expected<ArrayRef<Elf_Shdr>> SectionsOrErr = Obj.sections();
+  if (!SectionsOrErr) {
+    consumeError(SectionsOrErr.takeError());
+    return false;
+  }
+
+  for (const Elf_Shdr &Sec : *SectionsOrErr) {
+    ArrayRef<uint8_t> Data;
+    if (Sec.sh_type != SHT_NOBITS) {
+      Expected<ArrayRef<uint8_t>> DataOrErr = Obj.getSectionContents(&Sec);
+      if (!DataOrErr) {
+        consumeError(DataOrErr.takeError());
+        return false;
+      }
+      Data = *DataOrErr;
+    }
+
+    SectionRecord R;
+    Elf_Shdr Shdr = Sec;
+    Shdr.sh_offset = 0;
+    Shdr.sh_size = 0;
+    R.HeaderHash = hashBytes(&Shdr, sizeof(Shdr));
+    R.Size = Sec.sh_size;
+
+    if (Sec.sh_type == SHT_SYMTAB) {
+      // Symbol sizes are patched separately. Sizes of common symbols
+      // affect the layout, so they are not excluded.
+      std::vector<Elf_Sym> Syms(Data.size() / sizeof(Elf_Sym));
+      memcpy(Syms.data(), Data.data(), Syms.size() * sizeof(Elf_Sym));
+      for (Elf_Sym &Sym : Syms) {
+        Ret.SymbolSizes.push_back(Sym.st_size);
+        if (Sym.st_shndx != SHN_COMMON)
+          Sym.st_size = 0;
+      }
+      R.ContentHash = hashBytes(Syms.data(), Syms.size() * sizeof(Elf_Sym));
+    } else {
+      R.ContentHash = hashBytes(Data.data(), Data.size());
+    }
+
+    Ret.Sections.push_back(std::move(R));
+    Ret.Contents.push_back(Data);
+    Ret.Types.push_back(Sec.sh_type);
+    Ret.Infos.push_back(Sec.sh_info);
+    Ret.Flags.push_back(Sec.sh_flags);
+  }
+  return true;
+}
+
+// Returns true if section contents can be patched without a full link.
+template <class ELFT> static bool canPatch() {
+  return Config->Rela && Config->EMachine != EM_MIPS && !Config->ICF &&
+         !Config->GdbIndex && !Config->Relocatable && !Config->OFormatBinary &&
+         Config->BuildId == BuildIdKind::None;
+}
+
+// Returns true if all the linker writes for a given section is its
+// contents and relocated values.
+template <class ELFT> static bool isPatchable(InputSectionBase<ELFT> *S) {
+  if (!S || S == &InputSection<ELFT>::Discarded || !S->Live || !S->OutSec ||
+      !S->AreRelocsRela)
+    return false;
+  if (S->kind() != InputSectionData::Regular &&
+      S->kind() != InputSectionData::EHFrame)
+    return false;
+  if (S->Type == SHT_NOBITS || S->isCompressed())
+    return false;
+  if (auto *IS = dyn_cast<InputSection<ELFT>>(S))
+    if (IS->getThunksSize())
+      return false;
+
+  for (const Relocation &Rel : S->Relocations)
+    if (isRelExprOneOf<R_RELAX_GOT_PC, R_RELAX_GOT_PC_NOPIC,
+                       R_RELAX_TLS_GD_TO_IE, R_RELAX_TLS_GD_TO_IE_END,
+                       R_RELAX_TLS_GD_TO_IE_ABS, R_RELAX_TLS_GD_TO_IE_PAGE_PC,
+                       R_RELAX_TLS_GD_TO_LE, R_RELAX_TLS_GD_TO_LE_NEG,
+                       R_RELAX_TLS_IE_TO_LE, R_RELAX_TLS_LD_TO_LE,
+                       R_PPC_PLT_OPD>(Rel.Expr))
+      return false;
+  return true;
+}
+
+// Relocations of the same type to the same symbol may be resolved
+// differently in read-only, writable and non-allocated sections.
+static uint32_t getSectionKind(uint64_t Flags) {
+  if (!(Flags & SHF_ALLOC))
+    return 0;
+  return (Flags & SHF_WRITE) ? 2 : 1;
+}
+
+static uint64_t getTargetKey(uint32_t SymIndex, uint32_t Type, uint32_t Kind) {
+  return (uint64_t(SymIndex) << 32) | (Type << 2) | Kind;
+}
+
+// The value of a relocation to a symbol in a mergeable section or in
+// .eh_frame is not a linear function of its addend.
+template <class ELFT> static bool isInSplitSection(const SymbolBody &Sym) {
+  if (auto *D = dyn_cast<DefinedRegular<ELFT>>(&Sym))
+    return D->Section && !isa<InputSection<ELFT>>(D->Section);
+  return false;
+}
+
+// Records how to compute relocated values of a given symbol and a type
+// if GetValue(A, P) is S + A or S + A - P for some S.
+template <class ELFT, class FnTy>
+static void addTarget(std::vector<TargetRecord> &Targets, uint32_t SymIndex,
+                      uint32_t Type, uint32_t Kind, FnTy GetValue) {
+  typedef typename ELFT::uint uintX_t;
+  uintX_t Base = GetValue(0, 0);
+  uintX_t A = 0x1234;
+  uintX_t P = 0x56789;
+  uintX_t V = GetValue(A, P);
+  bool PCRel;
+  if (V == uintX_t(Base + A))
+    PCRel = false;
+  else if (V == uintX_t(Base + A - P))
+    PCRel = true;
+  else
+    return;
+
+  // Try another point to make sure that the function is linear.
+  A = 0x10;
+  P = 0x3;
+  if (GetValue(A, P) != uintX_t(Base + A - (PCRel ? P : 0)))
+    return;
+  Targets.push_back({SymIndex, Type, Kind, PCRel, Base});
+}
+
+namespace {
+// Collects relocation targets of an object file.
+template <class ELFT> struct TargetCollector {
+  TargetCollector(elf::ObjectFile<ELFT> *F, InputRecord &R) : R(R) {
+    ArrayRef<SymbolBody *> Syms = F->getSymbols();
+    for (size_t I = 0, E = Syms.size(); I != E; ++I)
+      Index[Syms[I]] = I + 1;
+  }
+
+  template <class FnTy>
+  void add(SymbolBody &Sym, uint32_t Type, uint32_t Kind, FnTy GetValue) {
+    auto It = Index.find(&Sym);
+    if (It == Index.end() || isInSplitSection<ELFT>(Sym))
+      return;
+    if (Seen.insert(getTargetKey(It->second, Type, Kind)).second)
+      addTarget<ELFT>(R.Targets, It->second, Type, Kind, GetValue);
+  }
+
+  InputRecord &R;
+  DenseMap<const SymbolBody *, uint32_t> Index;
+  DenseSet<uint64_t> Seen;
+};
+} // anonymous namespace
+
+// Computes relocated values in the same way as InputSectionBase::relocate.
+template <class ELFT>
+static void getAllocRelocs(InputSectionBase<ELFT> *IS, SectionRecord &Sec,
+                           TargetCollector<ELFT> &Targets) {
+  typedef typename ELFT::uint uintX_t;
+  const unsigned Bits = sizeof(uintX_t) * 8;
+  uint32_t Kind = getSectionKind(IS->Flags);
+  for (const Relocation &Rel : IS->Relocations) {
+    uint64_t AddrLoc = IS->OutSec->Addr + IS->getOffset(Rel.Offset);
+    uint64_t Value = SignExtend64<Bits>(getRelocTargetVA<ELFT>(
+        Rel.Type, Rel.Addend, AddrLoc, *Rel.Sym, Rel.Expr));
+    Sec.Relocs.push_back({Rel.Offset, Value, Rel.Type});
+
+    if (IS->kind() == InputSectionData::Regular &&
+        !isRelExprOneOf<R_THUNK_ABS, R_THUNK_PC, R_THUNK_PLT_PC>(Rel.Expr))
+      Targets.add(*Rel.Sym, Rel.Type, Kind, [&](uintX_t A, uintX_t P) {
+        return getRelocTargetVA<ELFT>(Rel.Type, A, P, *Rel.Sym, Rel.Expr);
+      });
+  }
+}
+
+// Computes relocated values in the same way as
+// InputSection::relocateNonAlloc.
+template <class ELFT>
+static void getNonAllocRelocs(InputSection<ELFT> *IS, SectionRecord &Sec,
+                              TargetCollector<ELFT> &Targets) {
+  typedef typename ELFT::uint uintX_t;
+  for (const typename ELFT::Rela &Rel : IS->relas()) {
+    uint32_t Type = Rel.getType(Config->Mips64EL);
+    SymbolBody &Sym = IS->getFile()->getRelocTargetSym(Rel);
+    auto GetValue = [&](uintX_t A, uintX_t P) -> uintX_t {
+      if (Sym.isTls() && !Out<ELFT>::TlsPhdr)
+        return 0;
+      return getRelocTargetVA<ELFT>(Type, A, P, Sym, R_ABS);
+    };
+    uintX_t AddrLoc = IS->OutSec->Addr + IS->getOffset(Rel.r_offset);
+    uint64_t Value =
+        SignExtend64<sizeof(uintX_t) * 8>(GetValue(Rel.r_addend, AddrLoc));
+    Sec.Relocs.push_back({Rel.r_offset, Value, Type});
+    Targets.add(Sym, Type, 0, GetValue);
+  }
+}
+
+// Returns the file offsets of the st_size fields of symbols
+// in the output .symtab and .dynsym.
+template <class ELFT>
+static DenseMap<const SymbolBody *, SmallVector<uint64_t, 2>>
+getSymbolSizeOffsets() {
+  typedef typename ELFT::Sym Elf_Sym;
+  const uint64_t SizeOff = ELFT::Is64Bits ? 16 : 8;
+
+  DenseMap<const SymbolBody *, SmallVector<uint64_t, 2>> Ret;
+  for (SymbolTableSection<ELFT> *Tab :
+       {In<ELFT>::SymTab, In<ELFT>::DynSymTab}) {
+    if (!Tab || !Tab->OutSec)
+      continue;
+    uint64_t Off =
+        Tab->OutSec->Offset + Tab->OutSecOff + sizeof(Elf_Sym) + SizeOff;
+
+    // This follows SymbolTableSection::writeTo.
+    if (Config->Discard != DiscardPolicy::All &&
+        !Tab->getStrTabSec().isDynamic()) {
+      for (elf::ObjectFile<ELFT> *F : Symtab<ELFT>::X->getObjectFiles()) {
+        for (const std::pair<const DefinedRegular<ELFT> *, size_t> &P :
+             F->KeptLocalSyms) {
+          Ret[P.first].push_back(Off);
+          Off += sizeof(Elf_Sym);
+        }
+      }
+    }
+    for (const SymbolTableEntry &E : Tab->getSymbols()) {
+      Ret[E.Symbol].push_back(Off);
+      Off += sizeof(Elf_Sym);
+    }
+  }
+  return Ret;
+}
+
+template <class ELFT>
+static void
+addObjectFile(InputRecord &R, elf::ObjectFile<ELFT> *F, bool CanPatch,
+              DenseMap<const SymbolBody *, SmallVector<uint64_t, 2>> &Sizes) {
+  ObjectInfo Info;
+  if (!getFingerprints<ELFT>(F->MB.getBuffer(), Info))
+    return;
+  R.HeaderHash = Info.HeaderHash;
+  R.Sections = std::move(Info.Sections);
+  if (!CanPatch)
+    return;
+
+  TargetCollector<ELFT> Targets(F, R);
+  ArrayRef<InputSectionBase<ELFT> *> Sections = F->getSections();
+  for (size_t I = 0, E = Sections.size(); I != E; ++I) {
+    InputSectionBase<ELFT> *S = Sections[I];
+    if (!isPatchable(S))
+      continue;
+    SectionRecord &Sec = R.Sections[I];
+
+    if (auto *Eh = dyn_cast<EhInputSection<ELFT>>(S)) {
+      Sec.OutputOffset = S->OutSec->Offset;
+      Sec.Addr = S->OutSec->Addr;
+      Sec.Capacity = Sec.Size;
+      for (EhSectionPiece &P : Eh->Pieces)
+        Sec.Pieces.push_back({P.InputOff, P.size(), uint64_t(P.OutputOff),
+                              hashBytes(P.data().data(), P.size())});
+      getAllocRelocs(S, Sec, Targets);
+      continue;
+    }
+
+    auto *IS = cast<InputSection<ELFT>>(S);
+    Sec.OutputOffset = IS->OutSec->Offset + IS->OutSecOff;
+    Sec.Addr = IS->OutSec->Addr + IS->OutSecOff;
+    Sec.Capacity = IS->getSize() + getIncrementalPadding(IS);
+    if (IS->Flags & SHF_ALLOC)
+      getAllocRelocs(S, Sec, Targets);
+    else
+      getNonAllocRelocs(IS, Sec, Targets);
+  }
+
+  ArrayRef<SymbolBody *> Syms = F->getSymbols();
+  for (size_t I = 0, E = Syms.size(); I != E; ++I) {
+    if (Syms[I]->File != F || !isa<DefinedRegular<ELFT>>(Syms[I]))
+      continue;
+    auto It = Sizes.find(Syms[I]);
+    if (It != Sizes.end())
+      for (uint64_t Off : It->second)
+        R.Symbols.push_back({uint32_t(I + 1), Off});
+  }
+}
+
+// R_SIZE relocations resolve to symbol sizes, which can change
+// in incremental links.
+template <class ELFT> static bool hasSizeRelocs() {
+  for (elf::ObjectFile<ELFT> *F : Symtab<ELFT>::X->getObjectFiles())
+    for (InputSectionBase<ELFT> *S : F->getSections())
+      if (S && S != &InputSection<ELFT>::Discarded && S->Live)
+        for (const Relocation &Rel : S->Relocations)
+          if (Rel.Expr == R_SIZE)
+            return true;
+  return false;
+}
+
+template <class ELFT>
+uint64_t elf::getIncrementalPadding(InputSection<ELFT> *S) {
+  if (!Config->Incremental || ScriptConfig->HasSections || !canPatch<ELFT>())
+    return 0;
+
+  // Only ordinary code and data can be followed by zeros. Sections such
+  // as .init_array and .ctors are arrays whose elements must be valid.
+  if (S->kind() != InputSectionData::Regular || S->Type != SHT_PROGBITS ||
+      !(S->Flags & SHF_ALLOC) || (S->Flags & SHF_LINK_ORDER) ||
+      S->Name.startswith(".ctors") || S->Name.startswith(".dtors"))
+    return 0;
+
+  // The pieces of .init and .fini from crti.o, other files and crtn.o are
+  // concatenated to form the bodies of _init and _fini. They must stay
+  // contiguous.
+  StringRef Name = S->OutSec->getName();
+  if (Name == ".init" || Name == ".fini")
+    return 0;
+  return alignTo(S->getSize() * Config->IncrementalPadding / 100,
+                 S->Alignment);
+}
+
+void elf::resetIncrementalState() {
+  InputFiles.clear();
+  ArgsHash = 0;
+}
+
+void elf::addIncrementalInput(StringRef Path, MemoryBufferRef MB) {
+  InputFiles.push_back({Path, MB});
+}
+
+template <class ELFT> void elf::writeIncrementalState() {
+  State S;
+  S.ArgsHash = ArgsHash;
+  S.EKind = Config->EKind;
+  S.EMachine = Config->EMachine;
+  S.CanPatch = canPatch<ELFT>() && !hasSizeRelocs<ELFT>();
+  if (!getFileStatus(Config->OutputFile, S.OutputSize, S.OutputTime))
+    return;
+
+  DenseMap<const SymbolBody *, SmallVector<uint64_t, 2>> Sizes;
+  if (S.CanPatch)
+    Sizes = getSymbolSizeOffsets<ELFT>();
+
+  // Object files that are not in archives can be identified
+  // by their buffers.
+  DenseMap<const char *, elf::ObjectFile<ELFT> *> Objs;
+  for (elf::ObjectFile<ELFT> *F : Symtab<ELFT>::X->getObjectFiles())
+    if (F->ArchiveName.empty())
+      Objs[F->MB.getBufferStart()] = F;
+
+  for (std::pair<StringRef, MemoryBufferRef> &P : InputFiles) {
+    InputRecord R;
+    R.Path = P.first;
+    if (!getFileStatus(P.first, R.Size, R.Time))
+      return;
+    R.Hash = xxHash64(P.second.getBuffer());
+    if (elf::ObjectFile<ELFT> *F = Objs.lookup(P.second.getBufferStart()))
+      addObjectFile(R, F, S.CanPatch, Sizes);
+    S.Inputs.push_back(std::move(R));
+  }
+  writeState(S, getStatePath());
+}
+
+namespace {
+// Bytes to copy to the output file, followed by Fill zero bytes.
+struct Patch {
+  uint64_t Offset;
+  ArrayRef<uint8_t> Data;
+  uint64_t Fill;
+};
+
+// A symbol size to write to the output file.
+struct SizePatch {
+  uint64_t Offset;
+  uint64_t Size;
+};
+
+template <class ELFT> struct Patcher {
+  Patcher(State &S) : S(S) {}
+  bool addFile(InputRecord &R, MemoryBufferRef MB);
+  bool addEhFrame(SectionRecord &Sec, ArrayRef<uint8_t> Data);
+  bool getNewRelocs(InputRecord &R, SectionRecord &Sec, uint32_t Kind,
+                    ArrayRef<uint8_t> Data);
+  bool apply();
+
+  State &S;
+  std::vector<Patch> Patches;
+  std::vector<SizePatch> SizePatches;
+  std::vector<const SectionRecord *> Relocated;
+};
+} // anonymous namespace
+
+// Finds sections of a changed object file that need to be updated, and
+// makes sure that nothing else has changed.
+template <class ELFT>
+bool Patcher<ELFT>::addFile(InputRecord &R, MemoryBufferRef MB) {
+  ObjectInfo New;
+  if (!getFingerprints<ELFT>(MB.getBuffer(), New))
+    return false;
+  if (New.HeaderHash != R.HeaderHash ||
+      New.Sections.size() != R.Sections.size())
+    return false;
+
+  // Find sections whose contents or relocations have changed.
+  size_t NumSections = R.Sections.size();
+  std::vector<bool> ContentChanged(NumSections);
+  std::vector<bool> RelocsChanged(NumSections);
+  std::vector<size_t> RelaSec(NumSections, -1);
+  for (size_t I = 0; I != NumSections; ++I) {
+    const SectionRecord &Old = R.Sections[I];
+    const SectionRecord &Cur = New.Sections[I];
+    if (Cur.HeaderHash != Old.HeaderHash)
+      return false;
+    bool Changed = Cur.ContentHash != Old.ContentHash || Cur.Size != Old.Size;
+    if (New.Types[I] == SHT_RELA) {
+      uint32_t Target = New.Infos[I];
+      if (Target >= NumSections)
+        return false;
+      RelaSec[Target] = I;
+      RelocsChanged[Target] = Changed;
+      continue;
+    }
+    ContentChanged[I] = Changed;
+  }
+
+  for (size_t I = 0; I != NumSections; ++I) {
+    if (!ContentChanged[I] && !RelocsChanged[I])
+      continue;
+    SectionRecord &Sec = R.Sections[I];
+    ArrayRef<uint8_t> Data = New.Contents[I];
+    if (Sec.OutputOffset == uint64_t(-1) || Data.size() > Sec.Capacity ||
+        Sec.OutputOffset + Sec.Capacity > S.OutputSize)
+      return false;
+
+    if (!Sec.Pieces.empty()) {
+      // Relocations of .eh_frame decide which FDEs are live,
+      // and the sizes of FDEs decide where FDEs are.
+      if (RelocsChanged[I] || Data.size() != Sec.Size ||
+          !addEhFrame(Sec, Data))
+        return false;
+    } else {
+      if (RelocsChanged[I] &&
+          !getNewRelocs(R, Sec, getSectionKind(New.Flags[I]),
+                        New.Contents[RelaSec[I]]))
+        return false;
+      uint64_t Fill = Sec.Size > Data.size() ? Sec.Size - Data.size() : 0;
+      Patches.push_back({Sec.OutputOffset, Data, Fill});
+    }
+    Relocated.push_back(&Sec);
+  }
+
+  for (size_t I = 0; I != NumSections; ++I) {
+    R.Sections[I].ContentHash = New.Sections[I].ContentHash;
+    R.Sections[I].Size = New.Sections[I].Size;
+  }
+
+  for (const SymbolRecord &Sym : R.Symbols) {
+    if (Sym.Index >= New.SymbolSizes.size() || Sym.Offset >= S.OutputSize)
+      return false;
+    SizePatches.push_back({Sym.Offset, New.SymbolSizes[Sym.Index]});
+  }
+  return true;
+}
+// Patches FDEs of an .eh_frame section. The first two words of an FDE
+// are its size and the offset to its CIE, which are rewritten by the
+// linker, so only the rest is copied.
+template <class ELFT>
+bool Patcher<ELFT>::addEhFrame(SectionRecord &Sec, ArrayRef<uint8_t> Data) {
+  const endianness E = ELFT::TargetEndianness;
+  for (PieceRecord &P : Sec.Pieces) {
+    if (P.InputOff + P.Size > Data.size())
+      return false;
+    ArrayRef<uint8_t> D = Data.slice(P.InputOff, P.Size);
+    uint64_t Hash = hashBytes(D.data(), D.size());
+    if (Hash == P.Hash)
+      continue;
+    // CIEs are shared by FDEs of other files, so they cannot be changed.
+    if (D.size() < 8 || read32<E>(D.data() + 4) == 0)
+      return false;
+    P.Hash = Hash;
+    if (P.OutputOff != uint64_t(-1))
+      Patches.push_back({Sec.OutputOffset + P.OutputOff + 8, D.slice(8), 0});
+  }
+  return true;
+}
+
+// Computes relocated values from new relocation records of a section
+// using relocation targets saved by the previous link.
+template <class ELFT>
+bool Patcher<ELFT>::getNewRelocs(InputRecord &R, SectionRecord &Sec,
+                                 uint32_t Kind, ArrayRef<uint8_t> Data) {
+  typedef typename ELFT::Rela Elf_Rela;
+  typedef typename ELFT::uint uintX_t;
+
+  DenseMap<uint64_t, const TargetRecord *> Targets;
+  for (const TargetRecord &T : R.Targets)
+    Targets[getTargetKey(T.SymIndex, T.Type, T.Kind)] = &T;
+
+  std::vector<RelocRecord> Relocs;
+  for (size_t I = 0, E = Data.size() / sizeof(Elf_Rela); I != E; ++I) {
+    Elf_Rela Rel;
+    memcpy(&Rel, Data.data() + I * sizeof(Elf_Rela), sizeof(Elf_Rela));
+    uint32_t Type = Rel.getType(false);
+    if (Rel.r_offset >= Sec.Capacity)
+      return false;
+
+    const TargetRecord *T =
+        Targets.lookup(getTargetKey(Rel.getSymbol(false), Type, Kind));
+    if (!T)
+      return false;
+    uintX_t V = T->Base + Rel.r_addend;
+    if (T->PCRel)
+      V -= Sec.Addr + Rel.r_offset;
+    Relocs.push_back(
+        {Rel.r_offset, uint64_t(SignExtend64<sizeof(uintX_t) * 8>(V)), Type});
+  }
+  Sec.Relocs = std::move(Relocs);
+  return true;
+}
+
+// Updates the output file in place.
+template <class ELFT> bool Patcher<ELFT>::apply() {
+  int FD;
+  if (sys::fs::openFileForReadWrite(getOutputPath(), FD))
+    return false;
+  std::error_code EC;
+  sys::fs::mapped_file_region MF(FD, sys::fs::mapped_file_region::readwrite,
+                                 S.OutputSize, 0, EC);
+  sys::Process::SafelyCloseFileDescriptor(FD);
+  if (EC)
+    return false;
+
+  Config->EKind = (ELFKind)S.EKind;
+  Config->EMachine = S.EMachine;
+  Target = createTarget();
+
+  uint8_t *Buf = (uint8_t *)MF.data();
+  forEach(Patches.begin(), Patches.end(), [&](const Patch &P) {
+    memcpy(Buf + P.Offset, P.Data.data(), P.Data.size());
+    memset(Buf + P.Offset + P.Data.size(), 0, P.Fill);
+  });
+  forEach(Relocated.begin(), Relocated.end(), [&](const SectionRecord *Sec) {
+    uint8_t *Loc = Buf + Sec->OutputOffset;
+    for (const RelocRecord &Rel : Sec->Relocs)
+      Target->relocateOne(Loc + Rel.Offset, Rel.Type, Rel.Value);
+  });
+  for (const SizePatch &P : SizePatches)
+    endian::write<typename ELFT::uint, ELFT::TargetEndianness, unaligned>(
+        Buf + P.Offset, P.Size);
+
+  log("incremental: patched " + Twine(Relocated.size()) + " sections");
+  return true;
+}
+
+// Patches the output file with new contents of object files.
+// Returns false if the changes cannot be applied in place.
+template <class ELFT>
+static bool patchOutput(State &S,
+                        ArrayRef<std::pair<InputRecord *, MemoryBufferRef>>
+                            Changed) {
+  Patcher<ELFT> P(S);
+  for (const std::pair<InputRecord *, MemoryBufferRef> &C : Changed)
+    if (!P.addFile(*C.first, C.second))
+      return false;
+  return P.apply();
+}
+
+bool elf::tryIncrementalLink(opt::InputArgList &Args) {
+  // Options that only change diagnostics or the way we link, but not
+  // the output, don't invalidate the previous output.
+  std::string Cmd;
+  for (auto *Arg : Args) {
+    switch (Arg->getOption().getID()) {
+    case OPT_no_threads:
+    case OPT_stats:
+    case OPT_threads:
+    case OPT_verbose:
+      continue;
+    }
+    Cmd += Arg->getAsString(Args);
+    Cmd += '\0';
+  }
+  ArgsHash = xxHash64(Cmd);
+
+  State S;
+  if (!readState(getStatePath(), S) || S.ArgsHash != ArgsHash)
+    return false;
+
+  uint64_t Size;
+  uint64_t Time;
+  if (!getFileStatus(getOutputPath(), Size, Time) || Size != S.OutputSize ||
+      Time != S.OutputTime)
+    return false;
+
+  // Find input files that have changed since the last link.
+  std::vector<std::unique_ptr<MemoryBuffer>> Buffers;
+  std::vector<std::pair<InputRecord *, MemoryBufferRef>> Changed;
+  for (InputRecord &R : S.Inputs) {
+    if (!getFileStatus(R.Path, Size, Time))
+      return false;
+    // Timestamps have a coarse granularity, so a file modified right after
+    // the last link may have the same size and time as before. We trust
+    // them only if the file is older than the previous output.
+    if (Size == R.Size && Time == R.Time && Time < S.OutputTime)
+      continue;
+
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+        MemoryBuffer::getFile(R.Path, -1, false);
+    if (!MBOrErr)
+      return false;
+    std::unique_ptr<MemoryBuffer> &MB = *MBOrErr;
+    uint64_t Hash = xxHash64(MB->getBuffer());
+    R.Size = Size;
+    R.Time = Time;
+    if (Hash == R.Hash)
+      continue;
+
+    // Only object files can be patched.
+    if (!S.CanPatch || R.Sections.empty()) {
+      log("incremental: " + R.Path + " has changed; doing a full link");
+      return false;
+    }
+    R.Hash = Hash;
+    Changed.push_back({&R, MB->getMemBufferRef()});
+    Buffers.push_back(std::move(MB));
+  }
+
+  if (!Changed.empty()) {
+    bool Patched = false;
+    switch (S.EKind) {
+    case ELF32LEKind:
+      Patched = patchOutput<ELF32LE>(S, Changed);
+      break;
+    case ELF32BEKind:
+      Patched = patchOutput<ELF32BE>(S, Changed);
+      break;
+    case ELF64LEKind:
+      Patched = patchOutput<ELF64LE>(S, Changed);
+      break;
+    case ELF64BEKind:
+      Patched = patchOutput<ELF64BE>(S, Changed);
+      break;
+    default:
+      break;
+    }
+    if (!Patched) {
+      log("incremental: cannot patch the output; doing a full link");
+      return false;
+    }
+  }
+
+  if (!getFileStatus(getOutputPath(), S.OutputSize, S.OutputTime))
+    return false;
+  writeState(S, getStatePath());
+  if (Changed.empty())
+    log("incremental: output is up to date");
+  return true;
+}
+
+template void elf::writeIncrementalState<ELF32LE>();
+template void elf::writeIncrementalState<ELF32BE>();
+template void elf::writeIncrementalState<ELF64LE>();
+template void elf::writeIncrementalState<ELF64BE>();
+
+template uint64_t elf::getIncrementalPadding(InputSection<ELF32LE> *);
+template uint64_t elf::getIncrementalPadding(InputSection<ELF32BE> *);
+template uint64_t elf::getIncrementalPadding(InputSection<ELF64LE> *);
+template uint64_t elf::getIncrementalPadding(InputSection<ELF64BE> *);
@@ -0,0 +1,45 @@
+//===- Incremental.h --------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_INCREMENTAL_H
+#define LLD_ELF_INCREMENTAL_H
+
+#include "lld/Core/LLVM.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace lld {
+namespace elf {
+
+template <class ELFT> class InputSection;
+
+// Forgets the files and the command line of the previous link.
+void resetIncrementalState();
+
+// Remembers a file read by the driver so that its identity is saved
+// to the state file for the next incremental link.
+void addIncrementalInput(StringRef Path, MemoryBufferRef MB);
+
+// Tries to bring the output file up to date using the state file saved
+// by the previous link. Returns true on success. If it returns false,
+// the caller needs to do a full link.
+bool tryIncrementalLink(llvm::opt::InputArgList &Args);
+
+// Returns the number of bytes to reserve after a given section so that
+// the section can grow in later incremental links.
+template <class ELFT> uint64_t getIncrementalPadding(InputSection<ELFT> *S);
+
+// Saves the state of the current link so that the next link can
+// update the output file in place.
+template <class ELFT> void writeIncrementalState();
+
+} // namespace elf
+} // namespace lld
+
+#endif
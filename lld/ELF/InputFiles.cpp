@@ -165,10 +165,46 @@ ArrayRef<SymbolBody *> elf::ObjectFile<ELFT>::getSymbols() {
 template <class ELFT>
 void elf::ObjectFile<ELFT>::parse(DenseSet<CachedHashStringRef> &ComdatGroups) {
   // Read section and symbol tables.
+  preParse();
   initializeSections(ComdatGroups);
   initializeSymbols();
 }
 
+// The driver calls this function for all object files in parallel
+// before adding them to the symbol table. Files that are added later
+// (e.g. archive members) are pre-parsed by parse().
+template <class ELFT> void elf::ObjectFile<ELFT>::preParse() {
+  if (PreParsed)
+    return;
+  PreParsed = true;
+
+  const ELFFile<ELFT> &Obj = this->getObj();
+  ObjSections = check(Obj.sections());
+  StringRef SectionStringTable = check(Obj.getSectionStringTable(ObjSections));
+  SectionNames.resize(ObjSections.size());
+
+  for (size_t I = 0, E = ObjSections.size(); I != E; ++I) {
+    const Elf_Shdr &Sec = ObjSections[I];
+    if ((Sec.sh_flags & SHF_EXCLUDE) && !Config->Relocatable)
+      continue;
+
+    switch (Sec.sh_type) {
+    case SHT_SYMTAB:
+      this->initSymtab(ObjSections, &Sec);
+      break;
+    case SHT_SYMTAB_SHNDX:
+      this->SymtabSHNDX = check(Obj.getSHNDXTable(Sec, ObjSections));
+      break;
+    case SHT_GROUP:
+    case SHT_STRTAB:
+    case SHT_NULL:
+      break;
+    default:
+      SectionNames[I] = check(Obj.getSectionName(&Sec, SectionStringTable));
+    }
+  }
+}
+
 // Sections with SHT_GROUP and comdat bits define comdat section groups.
 // They are identified and deduplicated by group name. This function
 // returns a group name.
@@ -251,12 +287,9 @@ bool elf::ObjectFile<ELFT>::shouldMerge(const Elf_Shdr &Sec) {
 template <class ELFT>
 void elf::ObjectFile<ELFT>::initializeSections(
     DenseSet<CachedHashStringRef> &ComdatGroups) {
-  ArrayRef<Elf_Shdr> ObjSections = check(this->getObj().sections());
-  const ELFFile<ELFT> &Obj = this->getObj();
   uint64_t Size = ObjSections.size();
   Sections.resize(Size);
   unsigned I = -1;
-  StringRef SectionStringTable = check(Obj.getSectionStringTable(ObjSections));
   for (const Elf_Shdr &Sec : ObjSections) {
     ++I;
     if (Sections[I] == &InputSection<ELFT>::Discarded)
@@ -285,16 +318,13 @@ void elf::ObjectFile<ELFT>::initializeSections(
       }
       break;
     case SHT_SYMTAB:
-      this->initSymtab(ObjSections, &Sec);
-      break;
     case SHT_SYMTAB_SHNDX:
-      this->SymtabSHNDX = check(Obj.getSHNDXTable(Sec, ObjSections));
-      break;
     case SHT_STRTAB:
     case SHT_NULL:
+      // Already handled by preParse().
       break;
     default:
-      Sections[I] = createInputSection(Sec, SectionStringTable);
+      Sections[I] = createInputSection(Sec, SectionNames[I]);
     }
 
     // .ARM.exidx sections have a reverse dependency on the InputSection they
@@ -331,10 +361,7 @@ elf::ObjectFile<ELFT>::getRelocTarget(const Elf_Shdr &Sec) {
 template <class ELFT>
 InputSectionBase<ELFT> *
 elf::ObjectFile<ELFT>::createInputSection(const Elf_Shdr &Sec,
-                                          StringRef SectionStringTable) {
-  StringRef Name =
-      check(this->getObj().getSectionName(&Sec, SectionStringTable));
-
+                                          StringRef Name) {
   switch (Sec.sh_type) {
   case SHT_ARM_ATTRIBUTES:
     // FIXME: ARM meta-data section. Retain the first attribute section
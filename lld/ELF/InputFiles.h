@@ -145,9 +145,18 @@ public:
   explicit ObjectFile(MemoryBufferRef M);
   void parse(llvm::DenseSet<llvm::CachedHashStringRef> &ComdatGroups);
 
+  // Reads the section header table, section names and the symbol table.
+  // This doesn't touch any global state, so it is safe to call this
+  // function for multiple files in parallel before calling parse().
+  void preParse();
+
   ArrayRef<InputSectionBase<ELFT> *> getSections() const { return Sections; }
   InputSectionBase<ELFT> *getSection(const Elf_Sym &Sym) const;
 
+  bool isValidSymbolIndex(uint32_t SymbolIndex) const {
+    return SymbolIndex < SymbolBodies.size();
+  }
+
   SymbolBody &getSymbolBody(uint32_t SymbolIndex) const {
     if (SymbolIndex >= SymbolBodies.size())
       fatal(toString(this) + ": invalid symbol index");
@@ -185,11 +194,16 @@ private:
   void initializeDwarfLine();
   InputSectionBase<ELFT> *getRelocTarget(const Elf_Shdr &Sec);
   InputSectionBase<ELFT> *createInputSection(const Elf_Shdr &Sec,
-                                             StringRef SectionStringTable);
+                                             StringRef Name);
 
   bool shouldMerge(const Elf_Shdr &Sec);
   SymbolBody *createSymbolBody(const Elf_Sym *Sym);
 
+  // Section headers and their names read by preParse().
+  ArrayRef<Elf_Shdr> ObjSections;
+  std::vector<StringRef> SectionNames;
+  bool PreParsed = false;
+
   // List of all sections defined by this file.
   std::vector<InputSectionBase<ELFT> *> Sections;
 
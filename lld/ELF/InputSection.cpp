@@ -334,9 +334,10 @@ static uint64_t getAArch64UndefinedRelativeWeakVA(uint64_t Type, uint64_t A,
 }
 
 template <class ELFT>
-static typename ELFT::uint
-getRelocTargetVA(uint32_t Type, typename ELFT::uint A, typename ELFT::uint P,
-                 const SymbolBody &Body, RelExpr Expr) {
+typename ELFT::uint
+elf::getRelocTargetVA(uint32_t Type, typename ELFT::uint A,
+                      typename ELFT::uint P, const SymbolBody &Body,
+                      RelExpr Expr) {
   switch (Expr) {
   case R_HINT:
   case R_TLSDESC_CALL:
@@ -848,3 +849,20 @@ template std::string elf::toString(const InputSectionBase<ELF32LE> *);
 template std::string elf::toString(const InputSectionBase<ELF32BE> *);
 template std::string elf::toString(const InputSectionBase<ELF64LE> *);
 template std::string elf::toString(const InputSectionBase<ELF64BE> *);
+
+template ELF32LE::uint elf::getRelocTargetVA<ELF32LE>(uint32_t, ELF32LE::uint,
+                                                      ELF32LE::uint,
+                                                      const SymbolBody &,
+                                                      RelExpr);
+template ELF32BE::uint elf::getRelocTargetVA<ELF32BE>(uint32_t, ELF32BE::uint,
+                                                      ELF32BE::uint,
+                                                      const SymbolBody &,
+                                                      RelExpr);
+template ELF64LE::uint elf::getRelocTargetVA<ELF64LE>(uint32_t, ELF64LE::uint,
+                                                      ELF64LE::uint,
+                                                      const SymbolBody &,
+                                                      RelExpr);
+template ELF64BE::uint elf::getRelocTargetVA<ELF64BE>(uint32_t, ELF64BE::uint,
+                                                      ELF64BE::uint,
+                                                      const SymbolBody &,
+                                                      RelExpr);
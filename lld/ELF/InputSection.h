@@ -321,6 +321,13 @@ template <class ELFT> InputSection<ELFT> InputSection<ELFT>::Discarded;
 
 template <class ELFT> std::string toString(const InputSectionBase<ELFT> *);
 
+// Returns the value that a relocation of a given expression should
+// write at address P.
+template <class ELFT>
+typename ELFT::uint getRelocTargetVA(uint32_t Type, typename ELFT::uint A,
+                                     typename ELFT::uint P,
+                                     const SymbolBody &Body, RelExpr Expr);
+
 } // namespace elf
 } // namespace lld
 
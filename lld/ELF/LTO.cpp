@@ -18,9 +18,11 @@
 #include "llvm/ADT/Twine.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/LTO/Caching.h"
 #include "llvm/LTO/Config.h"
 #include "llvm/LTO/LTO.h"
 #include "llvm/Object/SymbolicFile.h"
+#include "llvm/Support/CachePruning.h"
 #include "llvm/Support/CodeGen.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/Error.h"
@@ -28,6 +30,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <memory>
 #include <string>
@@ -76,6 +79,8 @@ static std::unique_ptr<lto::LTO> createLTO() {
   Conf.DisableVerify = Config->DisableVerify;
   Conf.DiagHandler = diagnosticHandler;
   Conf.OptLevel = Config->LTOO;
+  if (!Config->Threads)
+    Conf.ThinLinkThreads = 1;
 
   // Set up a custom pipeline if we've been asked to.
   Conf.OptPipeline = Config->LTONewPmPasses;
@@ -137,13 +142,58 @@ std::vector<InputFile *> BitcodeCompiler::compile() {
   std::vector<InputFile *> Ret;
   unsigned MaxTasks = LTOObj->getMaxTasks();
   Buff.resize(MaxTasks);
-
-  checkError(LTOObj->run([&](size_t Task) {
-    return llvm::make_unique<lto::NativeObjectStream>(
-        llvm::make_unique<raw_svector_ostream>(Buff[Task]));
-  }));
+  Files.resize(MaxTasks);
+
+  // If --thinlto-cache-dir is given, ThinLTO backend outputs are read from
+  // and saved to the cache directory, and so are the outputs of the regular
+  // LTO code generation partitions if --lto-cache-dir is given. A cache hit
+  // is reported by calling AddFile instead of returning an output stream.
+  auto CreateCache = [&](StringRef Dir) -> lto::NativeObjectCache {
+    if (Dir.empty())
+      return nullptr;
+    lto::NativeObjectCache LocalCache =
+        lto::localCache(Dir, [&](unsigned Task, StringRef Path) {
+          Files[Task] = check(MemoryBuffer::getFile(Path));
+        });
+    return [=](unsigned Task, StringRef Key) {
+      lto::AddStreamFn AddStream = LocalCache(Task, Key);
+      if (AddStream)
+        ++CacheMisses;
+      else
+        ++CacheHits;
+      return AddStream;
+    };
+  };
+
+  checkError(LTOObj->run(
+      [&](size_t Task) {
+        return llvm::make_unique<lto::NativeObjectStream>(
+            llvm::make_unique<raw_svector_ostream>(Buff[Task]));
+      },
+      CreateCache(Config->ThinLTOCacheDir), CreateCache(Config->LTOCacheDir)));
+
+  if (!Config->ThinLTOCacheDir.empty() || !Config->LTOCacheDir.empty())
+    log("LTO cache: " + Twine(CacheHits.load()) + " hits, " +
+        Twine(CacheMisses.load()) + " misses");
+  for (StringRef Dir : {Config->ThinLTOCacheDir, Config->LTOCacheDir}) {
+    if (Dir.empty())
+      continue;
+    CachePruning(Dir)
+        .setPruningInterval(
+            std::chrono::seconds(Config->ThinLTOCachePruneInterval))
+        .setEntryExpiration(std::chrono::seconds(Config->ThinLTOCachePruneAfter))
+        .setMaxSize(Config->ThinLTOCacheMaxSize)
+        .prune();
+  }
 
   for (unsigned I = 0; I != MaxTasks; ++I) {
+    // Objects from the cache are not saved by --save-temps because
+    // they are already on disk.
+    if (Files[I]) {
+      Ret.push_back(createObjectFile(
+          MemoryBufferRef(Files[I]->getBuffer(), "lto.tmp")));
+      continue;
+    }
     if (Buff[I].empty())
       continue;
     if (Config->SaveTemps) {
@@ -23,6 +23,7 @@
 
 #include "lld/Core/LLVM.h"
 #include "llvm/ADT/SmallString.h"
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -46,9 +47,15 @@ public:
   void add(BitcodeFile &F);
   std::vector<InputFile *> compile();
 
+  // The number of ThinLTO backend outputs found in or added to the
+  // cache directory given by --thinlto-cache-dir.
+  std::atomic<unsigned> CacheHits{0};
+  std::atomic<unsigned> CacheMisses{0};
+
 private:
   std::unique_ptr<llvm::lto::LTO> LTOObj;
   std::vector<SmallString<0>> Buff;
+  std::vector<std::unique_ptr<MemoryBuffer>> Files;
 };
 }
 }
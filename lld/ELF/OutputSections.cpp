@@ -10,6 +10,7 @@
 #include "OutputSections.h"
 #include "Config.h"
 #include "EhFrame.h"
+#include "Incremental.h"
 #include "LinkerScript.h"
 #include "Memory.h"
 #include "Strings.h"
@@ -21,6 +22,7 @@
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/SHA1.h"
+#include <thread>
 
 using namespace llvm;
 using namespace llvm::dwarf;
@@ -146,7 +148,7 @@ template <class ELFT> void OutputSection<ELFT>::assignOffsets() {
   for (InputSection<ELFT> *S : Sections) {
     Off = alignTo(Off, S->Alignment);
     S->OutSecOff = Off;
-    Off += S->getSize();
+    Off += S->getSize() + getIncrementalPadding(S);
   }
   this->Size = Off;
 }
@@ -154,7 +156,7 @@ template <class ELFT> void OutputSection<ELFT>::assignOffsets() {
 template <class ELFT>
 void OutputSection<ELFT>::sort(
     std::function<int(InputSection<ELFT> *S)> Order) {
-  typedef std::pair<unsigned, InputSection<ELFT> *> Pair;
+  typedef std::pair<int, InputSection<ELFT> *> Pair;
   auto Comp = [](const Pair &A, const Pair &B) { return A.first < B.first; };
 
   std::vector<Pair> V;
@@ -249,16 +251,22 @@ void fill(uint8_t *Buf, size_t Size, uint32_t Filler) {
 }
 
 template <class ELFT> void OutputSection<ELFT>::writeTo(uint8_t *Buf) {
+  beginWrite(Buf);
+  auto Fn = [=](InputSection<ELFT> *IS) { IS->writeTo(Buf); };
+  forEach(Sections.begin(), Sections.end(), Fn);
+  endWrite();
+}
+
+template <class ELFT> void OutputSection<ELFT>::beginWrite(uint8_t *Buf) {
   Loc = Buf;
   if (uint32_t Filler = Script<ELFT>::X->getFiller(this->Name))
     fill(Buf, this->Size, Filler);
+}
 
-  auto Fn = [=](InputSection<ELFT> *IS) { IS->writeTo(Buf); };
-  forEach(Sections.begin(), Sections.end(), Fn);
-
+template <class ELFT> void OutputSection<ELFT>::endWrite() {
   // Linker scripts may have BYTE()-family commands with which you
   // can write arbitrary bytes to the output. Process them if any.
-  Script<ELFT>::X->writeDataBytes(this->Name, Buf);
+  Script<ELFT>::X->writeDataBytes(this->Name, Loc);
 }
 
 template <class ELFT>
@@ -468,10 +476,17 @@ template <class ELFT>
 MergeOutputSection<ELFT>::MergeOutputSection(StringRef Name, uint32_t Type,
                                              uintX_t Flags, uintX_t Alignment)
     : OutputSectionBase(Name, Type, Flags),
-      Builder(StringTableBuilder::RAW, Alignment) {}
+      Builder(StringTableBuilder::RAW, Alignment), Alignment(Alignment) {}
+
+template <class ELFT> const size_t MergeOutputSection<ELFT>::NumShards;
 
 template <class ELFT> void MergeOutputSection<ELFT>::writeTo(uint8_t *Buf) {
-  Builder.write(Buf);
+  if (shouldTailMerge()) {
+    Builder.write(Buf);
+    return;
+  }
+  forLoop(0, NumShards,
+          [&](size_t I) { Shards[I].write(Buf + ShardOffsets[I]); });
 }
 
 template <class ELFT>
@@ -508,18 +523,67 @@ template <class ELFT> void MergeOutputSection<ELFT>::finalizeTailMerge() {
         Sec->Pieces[I].OutputOff = Builder.getOffset(Sec->getData(I));
 }
 
+// This function is very hot (i.e. it can take several seconds to finish)
+// because sometimes the number of inputs is in an order of magnitude of
+// millions. So, we use multi-threading.
+//
+// For any strings S and T, we know S is not mergeable with T if S's hash
+// value is different from T's. If that's the case, we can safely put S and
+// T into different string builders without worrying about merge misses.
+// We do it in parallel.
+//
+// Which shard a string goes to depends only on its hash, and each shard is
+// filled by a single thread in input order, so the output does not depend
+// on the number of threads.
 template <class ELFT> void MergeOutputSection<ELFT>::finalizeNoTailMerge() {
-  // Add all string pieces to the string table builder to create section
-  // contents. Because we are not tail-optimizing, offsets of strings are
-  // fixed when they are added to the builder (string table builder contains
-  // a hash table from strings to offsets).
-  for (MergeInputSection<ELFT> *Sec : Sections)
+  // Concurrency level. Must be a power of 2 to avoid expensive modulo
+  // operations in the following tight loop.
+  size_t Concurrency = 1;
+  if (Config->Threads)
+    Concurrency = PowerOf2Floor(
+        std::min<size_t>(std::thread::hardware_concurrency(), NumShards));
+  if (Concurrency == 0)
+    Concurrency = 1;
+
+  Shards.reserve(NumShards);
+  for (size_t I = 0; I < NumShards; ++I)
+    Shards.emplace_back(StringTableBuilder::RAW, Alignment);
+  ShardOffsets.resize(NumShards);
+
+  // Add section pieces to the builders. Because we are not tail-optimizing,
+  // offsets of strings are fixed when they are added to the builders.
+  forLoop(0, Concurrency, [&](size_t ThreadId) {
+    for (MergeInputSection<ELFT> *Sec : Sections) {
+      for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
+        if (!Sec->Pieces[I].Live)
+          continue;
+        CachedHashStringRef Data = Sec->getData(I);
+        size_t ShardId = getShardId(Data.hash());
+        if ((ShardId & (Concurrency - 1)) == ThreadId)
+          Sec->Pieces[I].OutputOff = Shards[ShardId].add(Data);
+      }
+    }
+  });
+
+  // Compute an in-section offset for each shard.
+  uintX_t Off = 0;
+  for (size_t I = 0; I < NumShards; ++I) {
+    Shards[I].finalizeInOrder();
+    if (Shards[I].getSize() > 0)
+      Off = alignTo(Off, Alignment);
+    ShardOffsets[I] = Off;
+    Off += Shards[I].getSize();
+  }
+  this->Size = Off;
+
+  // So far, section pieces have offsets from beginning of shards, but
+  // we want offsets from beginning of the whole section. Fix them.
+  forEach(Sections.begin(), Sections.end(), [&](MergeInputSection<ELFT> *Sec) {
     for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I)
       if (Sec->Pieces[I].Live)
-        Sec->Pieces[I].OutputOff = Builder.add(Sec->getData(I));
-
-  Builder.finalizeInOrder();
-  this->Size = Builder.getSize();
+        Sec->Pieces[I].OutputOff +=
+            ShardOffsets[getShardId(Sec->getData(I).hash())];
+  });
 }
 
 template <class ELFT> void MergeOutputSection<ELFT>::finalize() {
@@ -16,6 +16,7 @@
 #include "lld/Core/LLVM.h"
 #include "llvm/MC/StringTableBuilder.h"
 #include "llvm/Object/ELF.h"
+#include "llvm/Support/MathExtras.h"
 
 namespace lld {
 namespace elf {
@@ -117,6 +118,13 @@ public:
   void writeTo(uint8_t *Buf) override;
   void finalize() override;
   void assignOffsets() override;
+
+  // writeTo() is split into these two functions and a loop over input
+  // sections in between, so that the writer can write input sections of
+  // all output sections in a single parallel loop.
+  void beginWrite(uint8_t *Buf);
+  void endWrite();
+
   Kind getKind() const override { return Regular; }
   static bool classof(const OutputSectionBase *B) {
     return B->getKind() == Regular;
@@ -147,7 +155,26 @@ private:
   void finalizeTailMerge();
   void finalizeNoTailMerge();
 
+  // We use the most significant bits of a hash as a shard ID.
+  // The reason why we don't want to use the least significant bits is
+  // because DenseMap also uses lower bits to determine a bucket ID.
+  // If we use the lower bits, it significantly increases the probability
+  // of hash collisions.
+  size_t getShardId(uint32_t Hash) const {
+    return Hash >> (32 - llvm::countTrailingZeros(NumShards));
+  }
+
+  // Used for tail merging.
   llvm::StringTableBuilder Builder;
+
+  // Used if not tail merging. Strings are distributed to shards by hash,
+  // and the shards are laid out one after another. These are only
+  // allocated by finalizeNoTailMerge.
+  static const size_t NumShards = 32;
+  std::vector<llvm::StringTableBuilder> Shards;
+  std::vector<size_t> ShardOffsets;
+
+  uintX_t Alignment;
   std::vector<MergeInputSection<ELFT> *> Sections;
 };
 
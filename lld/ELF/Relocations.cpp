@@ -39,6 +39,17 @@
 // It instead stores Relocation objects to InputSection's Relocations
 // vector to let it apply later in InputSection::writeTo.
 //
+// Relocations are scanned in two passes. The first pass visits input
+// sections in parallel and handles relocations that don't need any of the
+// above, which is the majority of relocations in usual programs (e.g. a
+// PC-relative call to a non-preemptible function). Other relocations are
+// only recorded. The second pass then handles the recorded relocations
+// serially in input order, so that GOT/PLT entries and dynamic relocations
+// are created in a deterministic order. The first pass never reports
+// errors; a relocation that could cause one is left to the second pass, so
+// each error is reported once and in input order. The second pass also
+// puts the relocations of each section back into input order.
+//
 //===----------------------------------------------------------------------===//
 
 #include "Relocations.h"
@@ -48,6 +59,7 @@
 #include "SymbolTable.h"
 #include "SyntheticSections.h"
 #include "Target.h"
+#include "Threads.h"
 #include "Thunks.h"
 
 #include "llvm/Support/Endian.h"
@@ -425,12 +437,12 @@ template <class ELFT> static void addCopyRelSymbol(SharedSymbol<ELFT> *SS) {
         Symtab<ELFT>::X->find(check(S.getName(SS->file()->getStringTable()))));
     if (!Alias)
       continue;
-    Alias->OffsetInBss = Off;
+    Alias->setOffsetInBss(Off);
     Alias->NeedsCopyOrPltAddr = true;
     Alias->symbol()->IsUsedInRegularObj = true;
   }
   In<ELFT>::RelaDyn->addReloc(
-      {Target->CopyRel, Out<ELFT>::Bss, SS->OffsetInBss, false, SS, 0});
+      {Target->CopyRel, Out<ELFT>::Bss, SS->getOffsetInBss(), false, SS, 0});
 }
 
 template <class ELFT>
@@ -600,8 +612,15 @@ static void scanRelocs(InputSectionBase<ELFT> &C, ArrayRef<RelTy> Rels) {
   if (auto *Eh = dyn_cast<EhInputSection<ELFT>>(&C))
     Pieces = Eh->Pieces;
 
+  // Rels may be a slice of the section's relocations, so skip pieces that
+  // precede the first relocation.
   ArrayRef<EhSectionPiece>::iterator PieceI = Pieces.begin();
   ArrayRef<EhSectionPiece>::iterator PieceE = Pieces.end();
+  if (!Rels.empty())
+    PieceI = std::upper_bound(PieceI, PieceE, Rels[0].r_offset,
+                              [](uintX_t Off, const EhSectionPiece &P) {
+                                return Off < P.InputOff + P.size();
+                              });
 
   for (auto I = Rels.begin(), E = Rels.end(); I != E; ++I) {
     const RelTy &RI = *I;
@@ -778,11 +797,168 @@ static void scanRelocs(InputSectionBase<ELFT> &C, ArrayRef<RelTy> Rels) {
   }
 }
 
-template <class ELFT> void scanRelocations(InputSectionBase<ELFT> &S) {
-  if (S.AreRelocsRela)
-    scanRelocs(S, S.relas());
-  else
-    scanRelocs(S, S.rels());
+// Returns true if a given relocation can be handled without creating
+// GOT/PLT entries, dynamic relocations or copy relocations and without
+// reporting errors. In other words, it returns true if the relocation can
+// be processed without touching any global state. Expr is updated to the
+// expression that scanRelocs would compute for the relocation.
+template <class ELFT>
+static bool isLocalReloc(const elf::ObjectFile<ELFT> &File, SymbolBody &Body,
+                         RelExpr &Expr, uint32_t Type, const uint8_t *Data,
+                         InputSectionBase<ELFT> &S,
+                         typename ELFT::uint RelOff) {
+  if (!Body.isDefined() || Body.isShared() || Body.isTls() ||
+      Body.isGnuIFunc() || isPreemptible(Body, Type))
+    return false;
+
+  // This is the same as what adjustExpr does for non-preemptible symbols.
+  if (needsPlt(Expr))
+    Expr = fromPlt(Expr);
+  if (Expr == R_GOT_PC && !isAbsoluteValue<ELFT>(Body))
+    Expr = Target->adjustRelaxExpr(Type, Data, Expr);
+  Expr = Target->getThunkExpr(Expr, Type, File, Body);
+
+  if (needsPlt(Expr) || refersToGotEntry(Expr) ||
+      isRelExprOneOf<R_GOTONLY_PC, R_GOTONLY_PC_FROM_END, R_GOTREL,
+                     R_GOTREL_FROM_END, R_PPC_TOC, R_THUNK_ABS, R_THUNK_PC,
+                     R_THUNK_PLT_PC, R_HINT, R_TLSDESC_CALL>(Expr))
+    return false;
+
+  // isStaticLinkTimeConstant may report an error in this case.
+  if (Config->Pic && isAbsoluteValue<ELFT>(Body) && isRelExpr(Expr))
+    return false;
+  return isStaticLinkTimeConstant<ELFT>(Expr, Type, Body, S, RelOff);
+}
+
+// A half-open range of indices of relocations that need to be handled
+// by scanRelocs. NumLocal is the number of relocations that preScanRelocs
+// added to the section before reaching the range.
+struct RelRange {
+  size_t Begin;
+  size_t End;
+  size_t NumLocal;
+};
+typedef std::vector<RelRange> RelRanges;
+
+// This is the first pass of relocation scanning. This function is called
+// from multiple threads. It handles relocations for which isLocalReloc is
+// true and appends the others to Pending.
+template <class ELFT, class RelTy>
+static void preScanRelocs(InputSectionBase<ELFT> &C, ArrayRef<RelTy> Rels,
+                          RelRanges &Pending) {
+  typedef typename ELFT::uint uintX_t;
+
+  if (Rels.empty())
+    return;
+
+  // MIPS relocations need to be paired and MIPS GOT is special,
+  // so we always handle them in the second pass. AMDGPU's getRelExpr
+  // reports unknown relocations, which we only do in the second pass.
+  if (Config->EMachine == EM_MIPS || Config->EMachine == EM_AMDGPU) {
+    Pending.push_back({0, Rels.size(), 0});
+    return;
+  }
+
+  auto AddPending = [&](size_t I) {
+    if (!Pending.empty() && Pending.back().End == I)
+      ++Pending.back().End;
+    else
+      Pending.push_back({I, I + 1, C.Relocations.size()});
+  };
+
+  const elf::ObjectFile<ELFT> *File = C.getFile();
+  const uint8_t *Buf = C.Data.begin();
+
+  ArrayRef<EhSectionPiece> Pieces;
+  if (auto *Eh = dyn_cast<EhInputSection<ELFT>>(&C))
+    Pieces = Eh->Pieces;
+
+  ArrayRef<EhSectionPiece>::iterator PieceI = Pieces.begin();
+  ArrayRef<EhSectionPiece>::iterator PieceE = Pieces.end();
+
+  for (size_t I = 0, E = Rels.size(); I != E; ++I) {
+    const RelTy &RI = Rels[I];
+    // An invalid symbol index is a fatal error.
+    if (!File->isValidSymbolIndex(RI.getSymbol(Config->Mips64EL))) {
+      AddPending(I);
+      continue;
+    }
+    SymbolBody &Body = File->getRelocTargetSym(RI);
+    uint32_t Type = RI.getType(Config->Mips64EL);
+    RelExpr Expr = Target->getRelExpr(Type, Body);
+
+    if (!isLocalReloc<ELFT>(*File, Body, Expr, Type, Buf + RI.r_offset, C,
+                            RI.r_offset)) {
+      AddPending(I);
+      // A TLS relocation may be relaxed together with the relocation that
+      // follows it (see handleTlsRelocation), so keep them together. The
+      // following relocation may itself be a TLS one with its own pair.
+      for (const RelTy *R = &RI; I + 1 != E; R = &Rels[I]) {
+        uint32_t SymIndex = R->getSymbol(Config->Mips64EL);
+        if (File->isValidSymbolIndex(SymIndex) &&
+            !File->getSymbolBody(SymIndex).isTls())
+          break;
+        AddPending(++I);
+      }
+      continue;
+    }
+
+    // Skip a relocation that points to a dead piece
+    // in a eh_frame section.
+    while (PieceI != PieceE &&
+           (PieceI->InputOff + PieceI->size() <= RI.r_offset))
+      ++PieceI;
+
+    uintX_t Offset;
+    if (PieceI != PieceE) {
+      assert(PieceI->InputOff <= RI.r_offset && "Relocation not in any piece");
+      if (PieceI->OutputOff == -1)
+        continue;
+      Offset = PieceI->OutputOff + RI.r_offset - PieceI->InputOff;
+    } else {
+      Offset = RI.r_offset;
+    }
+
+    uintX_t Addend = computeAddend(*File, Buf, Rels.end(), RI, Expr, Body);
+    C.Relocations.push_back({Expr, Type, Offset, Addend, &Body});
+  }
+}
+
+template <class ELFT>
+void scanRelocations(ArrayRef<InputSectionBase<ELFT> *> Sections) {
+  std::vector<RelRanges> Pending(Sections.size());
+
+  forLoop(0, Sections.size(), [&](size_t I) {
+    InputSectionBase<ELFT> &S = *Sections[I];
+    if (S.AreRelocsRela)
+      preScanRelocs(S, S.relas(), Pending[I]);
+    else
+      preScanRelocs(S, S.rels(), Pending[I]);
+  });
+
+  for (size_t I = 0, E = Sections.size(); I != E; ++I) {
+    if (Pending[I].empty())
+      continue;
+
+    // scanRelocs appends to S.Relocations. Interleave its results with
+    // the relocations added by the first pass to keep the input order.
+    InputSectionBase<ELFT> &S = *Sections[I];
+    std::vector<Relocation> Local = std::move(S.Relocations);
+    S.Relocations.clear();
+    S.Relocations.reserve(Local.size());
+    size_t NumLocal = 0;
+    for (RelRange &R : Pending[I]) {
+      S.Relocations.insert(S.Relocations.end(), Local.begin() + NumLocal,
+                           Local.begin() + R.NumLocal);
+      NumLocal = R.NumLocal;
+      if (S.AreRelocsRela)
+        scanRelocs(S, S.relas().slice(R.Begin, R.End - R.Begin));
+      else
+        scanRelocs(S, S.rels().slice(R.Begin, R.End - R.Begin));
+    }
+    S.Relocations.insert(S.Relocations.end(), Local.begin() + NumLocal,
+                         Local.end());
+  }
 }
 
 template <class ELFT, class RelTy>
@@ -812,10 +988,14 @@ template <class ELFT> void createThunks(InputSectionBase<ELFT> &S) {
     createThunks(S, S.rels());
 }
 
-template void scanRelocations<ELF32LE>(InputSectionBase<ELF32LE> &);
-template void scanRelocations<ELF32BE>(InputSectionBase<ELF32BE> &);
-template void scanRelocations<ELF64LE>(InputSectionBase<ELF64LE> &);
-template void scanRelocations<ELF64BE>(InputSectionBase<ELF64BE> &);
+template void
+scanRelocations<ELF32LE>(ArrayRef<InputSectionBase<ELF32LE> *>);
+template void
+scanRelocations<ELF32BE>(ArrayRef<InputSectionBase<ELF32BE> *>);
+template void
+scanRelocations<ELF64LE>(ArrayRef<InputSectionBase<ELF64LE> *>);
+template void
+scanRelocations<ELF64BE>(ArrayRef<InputSectionBase<ELF64BE> *>);
 
 template void createThunks<ELF32LE>(InputSectionBase<ELF32LE> &);
 template void createThunks<ELF32BE>(InputSectionBase<ELF32BE> &);
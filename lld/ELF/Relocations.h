@@ -111,7 +111,8 @@ struct Relocation {
   SymbolBody *Sym;
 };
 
-template <class ELFT> void scanRelocations(InputSectionBase<ELFT> &);
+template <class ELFT>
+void scanRelocations(ArrayRef<InputSectionBase<ELFT> *> Sections);
 
 template <class ELFT> void createThunks(InputSectionBase<ELFT> &);
 
@@ -21,6 +21,8 @@
 #include "Memory.h"
 #include "Symbols.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/xxhash.h"
 
 using namespace llvm;
 using namespace llvm::object;
@@ -148,7 +150,7 @@ DefinedRegular<ELFT> *SymbolTable<ELFT>::addIgnored(StringRef Name,
 // Set a flag for --trace-symbol so that we can print out a log message
 // if a new symbol with the same name is inserted into the symbol table.
 template <class ELFT> void SymbolTable<ELFT>::trace(StringRef Name) {
-  Symtab.insert({CachedHashStringRef(Name), {-1, true}});
+  TracedNames.insert(CachedHashStringRef(Name));
 }
 
 // Rename SYM as __wrap_SYM. The original symbol is preserved as __real_SYM.
@@ -164,6 +166,8 @@ template <class ELFT> void SymbolTable<ELFT>::wrap(StringRef Name) {
   // We rename symbols by replacing the old symbol's SymbolBody with the new
   // symbol's SymbolBody. This causes all SymbolBody pointers referring to the
   // old symbol to instead refer to the new symbol.
+  RenamedSymbols[Sym] = getInsertedName(Sym);
+  RenamedSymbols[Real] = getInsertedName(Real);
   memcpy(Real->Body.buffer, Sym->Body.buffer, sizeof(Sym->Body));
   memcpy(Sym->Body.buffer, Wrap->Body.buffer, sizeof(Wrap->Body));
 }
@@ -176,34 +180,74 @@ static uint8_t getMinVisibility(uint8_t VA, uint8_t VB) {
   return std::min(VA, VB);
 }
 
-// Find an existing symbol or create and insert a new one.
+static uint32_t hashName(StringRef Name) { return xxHash64(Name); }
+
+// Returns the slot for a given name. If the name is not in the table,
+// returns an empty slot where it should be inserted.
 template <class ELFT>
-std::pair<Symbol *, bool> SymbolTable<ELFT>::insert(StringRef Name) {
-  auto P = Symtab.insert(
-      {CachedHashStringRef(Name), SymIndex((int)SymVector.size(), false)});
-  SymIndex &V = P.first->second;
-  bool IsNew = P.second;
-
-  if (V.Idx == -1) {
-    IsNew = true;
-    V = SymIndex((int)SymVector.size(), true);
+size_t SymbolTable<ELFT>::findSlot(StringRef Name, uint32_t Hash) const {
+  size_t Mask = Symtab.size() - 1;
+  for (size_t I = Hash & Mask;; I = (I + 1) & Mask) {
+    const SymSlot &Slot = Symtab[I];
+    if (Slot.Idx == 0)
+      return I;
+    if (Slot.Hash == Hash && getInsertedName(SymVector[Slot.Idx - 1]) == Name)
+      return I;
   }
+}
 
-  Symbol *Sym;
-  if (IsNew) {
-    Sym = new (BAlloc) Symbol;
-    Sym->InVersionScript = false;
-    Sym->Binding = STB_WEAK;
-    Sym->Visibility = STV_DEFAULT;
-    Sym->IsUsedInRegularObj = false;
-    Sym->ExportDynamic = false;
-    Sym->Traced = V.Traced;
-    Sym->VersionId = Config->DefaultSymbolVersion;
-    SymVector.push_back(Sym);
-  } else {
-    Sym = SymVector[V.Idx];
+// Returns the name a given symbol was inserted with.
+template <class ELFT>
+StringRef SymbolTable<ELFT>::getInsertedName(const Symbol *Sym) const {
+  if (!RenamedSymbols.empty()) {
+    auto It = RenamedSymbols.find(Sym);
+    if (It != RenamedSymbols.end())
+      return It->second;
+  }
+  return Sym->body()->getName();
+}
+
+// Doubles the size of the symbol table.
+template <class ELFT> void SymbolTable<ELFT>::grow() {
+  std::vector<SymSlot> Old(std::max<size_t>(Symtab.size() * 2, 1024));
+  Old.swap(Symtab);
+
+  size_t Mask = Symtab.size() - 1;
+  for (const SymSlot &Slot : Old) {
+    if (Slot.Idx == 0)
+      continue;
+    size_t I = Slot.Hash & Mask;
+    while (Symtab[I].Idx != 0)
+      I = (I + 1) & Mask;
+    Symtab[I] = Slot;
   }
-  return {Sym, IsNew};
+}
+
+// Find an existing symbol or create and insert a new one.
+template <class ELFT>
+std::pair<Symbol *, bool> SymbolTable<ELFT>::insert(StringRef Name) {
+  // Keep the load factor below 3/4.
+  if ((SymVector.size() + 1) * 4 > Symtab.size() * 3)
+    grow();
+
+  uint32_t Hash = hashName(Name);
+  SymSlot &Slot = Symtab[findSlot(Name, Hash)];
+  if (Slot.Idx)
+    return {SymVector[Slot.Idx - 1], false};
+
+  Symbol *Sym = new (BAlloc) Symbol;
+  Sym->InVersionScript = false;
+  Sym->Binding = STB_WEAK;
+  Sym->Visibility = STV_DEFAULT;
+  Sym->IsUsedInRegularObj = false;
+  Sym->ExportDynamic = false;
+  Sym->Traced =
+      !TracedNames.empty() && TracedNames.count(CachedHashStringRef(Name));
+  Sym->VersionId = Config->DefaultSymbolVersion;
+
+  Slot = {Hash, uint32_t(SymVector.size() + 1)};
+  SymVector.push_back(Sym);
+  return {Sym, true};
 }
 
 // Construct a string in the form of "Sym in File1 and File2".
@@ -458,13 +502,41 @@ Symbol *SymbolTable<ELFT>::addBitcode(StringRef Name, uint8_t Binding,
 }
 
 template <class ELFT> SymbolBody *SymbolTable<ELFT>::find(StringRef Name) {
-  auto It = Symtab.find(CachedHashStringRef(Name));
-  if (It == Symtab.end())
+  if (Symtab.empty())
     return nullptr;
-  SymIndex V = It->second;
-  if (V.Idx == -1)
+  const SymSlot &Slot = Symtab[findSlot(Name, hashName(Name))];
+  if (Slot.Idx == 0)
     return nullptr;
-  return SymVector[V.Idx]->body();
+  return SymVector[Slot.Idx - 1]->body();
+}
+
+// Prints out memory usage of symbols for --stats.
+template <class ELFT> void SymbolTable<ELFT>::printStats() {
+  size_t NumLocals = 0;
+  for (ObjectFile<ELFT> *F : ObjectFiles)
+    NumLocals += F->getLocalSymbols().size();
+
+  size_t SymSize = SymVector.size() * sizeof(Symbol);
+  size_t TableSize = Symtab.capacity() * sizeof(SymSlot) +
+                     SymVector.capacity() * sizeof(Symbol *) +
+                     RenamedSymbols.getMemorySize();
+  size_t SideSize = SymbolSideTables<ELFT>::Thunks.getMemorySize() +
+                    SymbolSideTables<ELFT>::BssOffsets.getMemorySize();
+
+  outs() << "global symbols:     " << SymVector.size() << " ("
+         << sizeof(Symbol) << " bytes each)\n"
+         << "local symbols:      " << NumLocals << " ("
+         << sizeof(DefinedRegular<ELFT>) << " bytes each)\n"
+         << "symbol objects:     " << SymSize << " bytes\n"
+         << "symbol table:       " << TableSize << " bytes\n"
+         << "symbol side tables: " << SideSize << " bytes\n"
+         << "arena:              " << BAlloc.getTotalMemory() << " bytes\n"
+         << "malloc:             " << sys::Process::GetMallocUsage()
+         << " bytes\n";
+
+  if (LTO && (!Config->ThinLTOCacheDir.empty() || !Config->LTOCacheDir.empty()))
+    outs() << "LTO cache hits:     " << LTO->CacheHits.load() << "\n"
+           << "LTO cache misses:   " << LTO->CacheMisses.load() << "\n";
 }
 
 template <class ELFT>
@@ -668,9 +740,15 @@ template <class ELFT> void SymbolTable<ELFT>::scanVersionScript() {
   // Symbol themselves might know their versions because symbols
   // can contain versions in the form of <name>@<version>.
   // Let them parse their names.
-  if (!Config->VersionDefinitions.empty())
-    for (Symbol *Sym : SymVector)
-      Sym->body()->parseSymbolVersion();
+  if (!Config->VersionDefinitions.empty()) {
+    for (Symbol *Sym : SymVector) {
+      SymbolBody *B = Sym->body();
+      StringRef Name = B->getName();
+      B->parseSymbolVersion();
+      if (B->getName().size() != Name.size())
+        RenamedSymbols[Sym] = Name;
+    }
+  }
 
   // Handle edge cases first.
   if (!Config->VersionScriptGlobals.empty()) {
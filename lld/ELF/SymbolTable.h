@@ -86,6 +86,8 @@ public:
   void trace(StringRef Name);
   void wrap(StringRef Name);
 
+  void printStats();
+
   std::vector<InputSectionBase<ELFT> *> Sections;
 
 private:
@@ -103,22 +105,37 @@ private:
                           StringRef VersionName);
   void assignWildcardVersion(SymbolVersion Ver, uint16_t VersionId);
 
-  struct SymIndex {
-    SymIndex(int Idx, bool Traced) : Idx(Idx), Traced(Traced) {}
-    int Idx : 31;
-    unsigned Traced : 1;
+  size_t findSlot(StringRef Name, uint32_t Hash) const;
+  void grow();
+  StringRef getInsertedName(const Symbol *Sym) const;
+
+  // A slot of the symbol table. Idx is an index to SymVector plus one,
+  // or zero if the slot is empty.
+  struct SymSlot {
+    uint32_t Hash;
+    uint32_t Idx;
   };
 
-  // The order the global symbols are in is not defined. We can use an arbitrary
-  // order, but it has to be reproducible. That is true even when cross linking.
-  // The default hashing of StringRef produces different results on 32 and 64
-  // bit systems so we use a map to a vector. That is arbitrary, deterministic
-  // but a bit inefficient.
-  // FIXME: Experiment with passing in a custom hashing or sorting the symbols
-  // once symbol resolution is finished.
-  llvm::DenseMap<llvm::CachedHashStringRef, SymIndex> Symtab;
+  // The symbol table is an open-addressing hash table that maps symbol
+  // names to indices to SymVector. Slots contain only hash values and
+  // indices. A name is compared with the name of the symbol's body, so
+  // names are not stored in the table. That is more compact than
+  // a DenseMap from strings to indices because empty slots are only
+  // 8 bytes each.
+  //
+  // The order the global symbols are in is the order they are inserted.
+  // It has to be reproducible even when cross linking, so it must not
+  // depend on the hash table layout.
+  std::vector<SymSlot> Symtab;
   std::vector<Symbol *> SymVector;
 
+  // The names symbols were inserted with if their bodies now have other
+  // names. Symbols are renamed by --wrap and by symbol versions.
+  llvm::DenseMap<const Symbol *, StringRef> RenamedSymbols;
+
+  // Symbol names given by --trace-symbol.
+  llvm::DenseSet<llvm::CachedHashStringRef> TracedNames;
+
   // Comdat groups define "link once" sections. If two comdat groups have the
   // same name, only one of them is linked, and the other is ignored. This set
   // is used to uniquify them.
@@ -81,7 +81,7 @@ static typename ELFT::uint getSymVA(const SymbolBody &Body,
       return 0;
     if (SS.isFunc())
       return Body.getPltVA<ELFT>();
-    return Out<ELFT>::Bss->Addr + SS.OffsetInBss;
+    return Out<ELFT>::Bss->Addr + SS.getOffsetInBss();
   }
   case SymbolBody::UndefinedKind:
     return 0;
@@ -130,11 +130,17 @@ bool SymbolBody::isPreemptible() const {
 }
 
 template <class ELFT> bool SymbolBody::hasThunk() const {
-  if (auto *DR = dyn_cast<DefinedRegular<ELFT>>(this))
-    return DR->ThunkData != nullptr;
-  if (auto *S = dyn_cast<SharedSymbol<ELFT>>(this))
-    return S->ThunkData != nullptr;
-  return false;
+  return getThunk<ELFT>() != nullptr;
+}
+
+template <class ELFT> Thunk<ELFT> *SymbolBody::getThunk() const {
+  if (SymbolSideTables<ELFT>::Thunks.empty())
+    return nullptr;
+  return SymbolSideTables<ELFT>::Thunks.lookup(this);
+}
+
+template <class ELFT> void SymbolBody::setThunk(Thunk<ELFT> *T) {
+  SymbolSideTables<ELFT>::Thunks[this] = T;
 }
 
 template <class ELFT>
@@ -169,10 +175,8 @@ template <class ELFT> typename ELFT::uint SymbolBody::getPltVA() const {
 }
 
 template <class ELFT> typename ELFT::uint SymbolBody::getThunkVA() const {
-  if (const auto *DR = dyn_cast<DefinedRegular<ELFT>>(this))
-    return DR->ThunkData->getVA();
-  if (const auto *S = dyn_cast<SharedSymbol<ELFT>>(this))
-    return S->ThunkData->getVA();
+  if (Thunk<ELFT> *T = getThunk<ELFT>())
+    return T->getVA();
   fatal("getThunkVA() not supported for Symbol class\n");
 }
 
@@ -314,6 +318,16 @@ template bool SymbolBody::hasThunk<ELF32BE>() const;
 template bool SymbolBody::hasThunk<ELF64LE>() const;
 template bool SymbolBody::hasThunk<ELF64BE>() const;
 
+template Thunk<ELF32LE> *SymbolBody::getThunk<ELF32LE>() const;
+template Thunk<ELF32BE> *SymbolBody::getThunk<ELF32BE>() const;
+template Thunk<ELF64LE> *SymbolBody::getThunk<ELF64LE>() const;
+template Thunk<ELF64BE> *SymbolBody::getThunk<ELF64BE>() const;
+
+template void SymbolBody::setThunk<ELF32LE>(Thunk<ELF32LE> *);
+template void SymbolBody::setThunk<ELF32BE>(Thunk<ELF32BE> *);
+template void SymbolBody::setThunk<ELF64LE>(Thunk<ELF64LE> *);
+template void SymbolBody::setThunk<ELF64BE>(Thunk<ELF64BE> *);
+
 template uint32_t SymbolBody::template getVA<ELF32LE>(uint32_t) const;
 template uint32_t SymbolBody::template getVA<ELF32BE>(uint32_t) const;
 template uint64_t SymbolBody::template getVA<ELF64LE>(uint64_t) const;
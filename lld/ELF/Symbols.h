@@ -19,6 +19,7 @@
 #include "Strings.h"
 
 #include "lld/Core/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/ELF.h"
 
@@ -76,6 +77,8 @@ public:
   bool isInGot() const { return GotIndex != -1U; }
   bool isInPlt() const { return PltIndex != -1U; }
   template <class ELFT> bool hasThunk() const;
+  template <class ELFT> Thunk<ELFT> *getThunk() const;
+  template <class ELFT> void setThunk(Thunk<ELFT> *T);
 
   template <class ELFT>
   typename ELFT::uint getVA(typename ELFT::uint Addend = 0) const;
@@ -204,10 +207,6 @@ public:
   // If this is null, the symbol is an absolute symbol.
   InputSectionBase<ELFT> *&Section;
 
-  // If non-null the symbol has a Thunk that may be used as an alternative
-  // destination for callers of this Symbol.
-  Thunk<ELFT> *ThunkData = nullptr;
-
 private:
   static InputSectionBase<ELFT> *NullInputSection;
 };
@@ -276,12 +275,10 @@ public:
   // This field is a pointer to the symbol's version definition.
   const Elf_Verdef *Verdef;
 
-  // OffsetInBss is significant only when needsCopy() is true.
-  uintX_t OffsetInBss = 0;
+  // The offset in .bss is significant only when needsCopy() is true.
+  uintX_t getOffsetInBss() const;
+  void setOffsetInBss(uintX_t Off);
 
-  // If non-null the symbol has a Thunk that may be used as an alternative
-  // destination for callers of this Symbol.
-  Thunk<ELFT> *ThunkData = nullptr;
   bool needsCopy() const { return this->NeedsCopyOrPltAddr && !this->isFunc(); }
 };
 
@@ -334,6 +331,40 @@ public:
   InputFile *fetch();
 };
 
+// Attributes that only a few symbols have are kept in side tables rather
+// than in symbol bodies, so that they do not make every Symbol larger.
+template <class ELFT> struct SymbolSideTables {
+  // Thunks that may be used as alternative destinations for callers of
+  // symbols. Only ARM and MIPS use them.
+  static llvm::DenseMap<const SymbolBody *, Thunk<ELFT> *> Thunks;
+
+  // Offsets in .bss of shared symbols that need copy relocations.
+  static llvm::DenseMap<const SymbolBody *, typename ELFT::uint> BssOffsets;
+
+  // The tables are keyed by symbols allocated in the arena, which is freed
+  // at the end of each link, so they are cleared at the start of each link.
+  static void clear() {
+    Thunks.clear();
+    BssOffsets.clear();
+  }
+};
+
+template <class ELFT>
+llvm::DenseMap<const SymbolBody *, Thunk<ELFT> *>
+    SymbolSideTables<ELFT>::Thunks;
+template <class ELFT>
+llvm::DenseMap<const SymbolBody *, typename ELFT::uint>
+    SymbolSideTables<ELFT>::BssOffsets;
+
+template <class ELFT>
+typename ELFT::uint SharedSymbol<ELFT>::getOffsetInBss() const {
+  return SymbolSideTables<ELFT>::BssOffsets.lookup(this);
+}
+
+template <class ELFT> void SharedSymbol<ELFT>::setOffsetInBss(uintX_t Off) {
+  SymbolSideTables<ELFT>::BssOffsets[this] = Off;
+}
+
 // Some linker-generated symbols need to be created as
 // DefinedRegular symbols.
 template <class ELFT> struct ElfSym {
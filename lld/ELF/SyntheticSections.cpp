@@ -1466,11 +1466,25 @@ GdbIndexSection<ELFT>::GdbIndexSection()
     : SyntheticSection<ELFT>(0, SHT_PROGBITS, 1, ".gdb_index"),
       StringPool(llvm::StringTableBuilder::ELF) {}
 
+// Debug sections are read in parallel because extracting CU lists,
+// address ranges and public names requires parsing DWARF, which is
+// slow for large programs. The results are then merged in input order
+// so that the output does not depend on the number of threads.
 template <class ELFT> void GdbIndexSection<ELFT>::parseDebugSections() {
+  std::vector<InputSection<ELFT> *> Sections;
   for (InputSectionBase<ELFT> *S : Symtab<ELFT>::X->Sections)
     if (InputSection<ELFT> *IS = dyn_cast<InputSection<ELFT>>(S))
       if (IS->OutSec && IS->Name == ".debug_info")
-        readDwarf(IS);
+        Sections.push_back(IS);
+
+  std::vector<GdbIndexChunk<ELFT>> Chunks(Sections.size());
+  forLoop(0, Sections.size(),
+          [&](size_t I) { Chunks[I] = readDwarf(Sections[I]); });
+  if (ErrorCount)
+    return;
+
+  for (GdbIndexChunk<ELFT> &Chunk : Chunks)
+    addChunk(Chunk);
 }
 
 // Iterative hash function for symbol's name is described in .gdb_index format
@@ -1483,38 +1497,50 @@ static uint32_t hash(StringRef Str) {
   return R;
 }
 
+// This function may be called from multiple threads,
+// so it must not update the section.
 template <class ELFT>
-void GdbIndexSection<ELFT>::readDwarf(InputSection<ELFT> *I) {
+GdbIndexChunk<ELFT> GdbIndexSection<ELFT>::readDwarf(InputSection<ELFT> *I) {
+  GdbIndexChunk<ELFT> Ret;
   GdbIndexBuilder<ELFT> Builder(I);
-  if (ErrorCount)
-    return;
+  if (!Builder.isValid())
+    return Ret;
+
+  Ret.CompilationUnits = Builder.readCUList();
+  Ret.AddressArea = Builder.readAddressArea(0);
+  for (std::pair<StringRef, uint8_t> &Pair : Builder.readPubNamesAndTypes())
+    Ret.NamesAndTypes.push_back(
+        {CachedHashStringRef(Pair.first), hash(Pair.first), Pair.second});
+  return Ret;
+}
 
+template <class ELFT>
+void GdbIndexSection<ELFT>::addChunk(GdbIndexChunk<ELFT> &Chunk) {
   size_t CuId = CompilationUnits.size();
-  std::vector<std::pair<uintX_t, uintX_t>> CuList = Builder.readCUList();
-  CompilationUnits.insert(CompilationUnits.end(), CuList.begin(), CuList.end());
+  CompilationUnits.insert(CompilationUnits.end(),
+                          Chunk.CompilationUnits.begin(),
+                          Chunk.CompilationUnits.end());
 
-  std::vector<AddressEntry<ELFT>> AddrArea = Builder.readAddressArea(CuId);
-  AddressArea.insert(AddressArea.end(), AddrArea.begin(), AddrArea.end());
-
-  std::vector<std::pair<StringRef, uint8_t>> NamesAndTypes =
-      Builder.readPubNamesAndTypes();
+  for (AddressEntry<ELFT> &E : Chunk.AddressArea) {
+    E.CuIndex += CuId;
+    AddressArea.push_back(E);
+  }
 
-  for (std::pair<StringRef, uint8_t> &Pair : NamesAndTypes) {
-    uint32_t Hash = hash(Pair.first);
-    size_t Offset = StringPool.add(Pair.first);
+  for (NameTypeEntry &Ent : Chunk.NamesAndTypes) {
+    size_t Offset = StringPool.add(Ent.Name);
 
     bool IsNew;
     GdbSymbol *Sym;
-    std::tie(IsNew, Sym) = SymbolTable.add(Hash, Offset);
+    std::tie(IsNew, Sym) = SymbolTable.add(Ent.Hash, Offset);
     if (IsNew) {
       Sym->CuVectorIndex = CuVectors.size();
-      CuVectors.push_back({{CuId, Pair.second}});
+      CuVectors.push_back({{CuId, Ent.Type}});
       continue;
     }
 
     std::vector<std::pair<uint32_t, uint8_t>> &CuVec =
         CuVectors[Sym->CuVectorIndex];
-    CuVec.push_back({CuId, Pair.second});
+    CuVec.push_back({CuId, Ent.Type});
   }
 }
 
@@ -497,7 +497,8 @@ public:
 
 private:
   void parseDebugSections();
-  void readDwarf(InputSection<ELFT> *I);
+  GdbIndexChunk<ELFT> readDwarf(InputSection<ELFT> *I);
+  void addChunk(GdbIndexChunk<ELFT> &Chunk);
 
   uint32_t CuTypesOffset;
   uint32_t SymTabOffset;
@@ -222,12 +222,9 @@ static void addThunkARM(uint32_t Reloc, SymbolBody &S, InputSection<ELFT> &IS) {
   // branch can reach the Thunk, and it makes Thunks to the PLT section easier
   Thunk<ELFT> *T = createThunkArm(Reloc, S, IS);
   IS.addThunk(T);
-  if (auto *Sym = dyn_cast<DefinedRegular<ELFT>>(&S))
-    Sym->ThunkData = T;
-  else if (auto *Sym = dyn_cast<SharedSymbol<ELFT>>(&S))
-    Sym->ThunkData = T;
-  else
+  if (!isa<DefinedRegular<ELFT>>(&S) && !isa<SharedSymbol<ELFT>>(&S))
     fatal("symbol not DefinedRegular or Shared");
+  S.setThunk(T);
 }
 
 template <class ELFT>
@@ -242,7 +239,7 @@ static void addThunkMips(uint32_t RelocType, SymbolBody &S,
   auto *Sec = cast<InputSection<ELFT>>(R->Section);
   auto *T = new (BAlloc) MipsThunk<ELFT>(S, *Sec);
   Sec->addThunk(T);
-  R->ThunkData = T;
+  R->setThunk(T);
 }
 
 template <class ELFT>
@@ -8,7 +8,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "Writer.h"
+#include "CallGraphSort.h"
 #include "Config.h"
+#include "Incremental.h"
 #include "LinkerScript.h"
 #include "Memory.h"
 #include "OutputSections.h"
@@ -17,10 +19,13 @@
 #include "SymbolTable.h"
 #include "SyntheticSections.h"
 #include "Target.h"
+#include "Threads.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/Errc.h"
 #include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include <climits>
 #include <thread>
@@ -35,6 +40,33 @@ using namespace lld;
 using namespace lld::elf;
 
 namespace {
+// An output file to which sections are written one at a time with
+// explicit writes instead of through a memory mapping of the entire
+// file. This is used for --no-mmap-output-file. Like FileOutputBuffer,
+// it creates a temporary file and renames it on commit.
+class StreamOutputFile {
+public:
+  static ErrorOr<std::unique_ptr<StreamOutputFile>> create(StringRef Path,
+                                                           uint64_t Size);
+  ~StreamOutputFile();
+
+  void write(ArrayRef<uint8_t> Data, uint64_t Offset);
+  std::unique_ptr<sys::fs::mapped_file_region> map(uint64_t Size,
+                                                   std::error_code &EC);
+  std::error_code commit();
+
+private:
+  StreamOutputFile(int FD, StringRef Path, StringRef TempPath)
+      : FD(FD), OS(FD, /*shouldClose=*/true), FinalPath(Path),
+        TempPath(TempPath) {}
+
+  int FD;
+  bool Closed = false;
+  raw_fd_ostream OS;
+  std::string FinalPath;
+  std::string TempPath;
+};
+
 // The writer writes a SymbolTable result to a file.
 template <class ELFT> class Writer {
 public:
@@ -69,12 +101,17 @@ private:
   void fixSectionAlignments();
   void fixAbsoluteSymbols();
   void openFile();
-  void writeHeader();
+  void writeHeader(uint8_t *Buf);
+  void writeSectionHeaders(uint8_t *Buf);
   void writeSections();
   void writeSectionsBinary();
+  void streamSections();
   void writeBuildId();
+  void commitFile();
 
+  // Only one of them is used depending on --[no-]mmap-output-file.
   std::unique_ptr<FileOutputBuffer> Buffer;
+  std::unique_ptr<StreamOutputFile> Stream;
 
   std::vector<OutputSectionBase *> OutputSections;
   OutputSectionFactory<ELFT> Factory;
@@ -218,8 +255,12 @@ template <class ELFT> void Writer<ELFT>::run() {
   openFile();
   if (ErrorCount)
     return;
-  if (!Config->OFormatBinary) {
-    writeHeader();
+  if (Stream) {
+    streamSections();
+  } else if (!Config->OFormatBinary) {
+    uint8_t *Buf = Buffer->getBufferStart();
+    writeHeader(Buf);
+    writeSectionHeaders(Buf + SectionHeaderOff);
     writeSections();
   } else {
     writeSectionsBinary();
@@ -231,8 +272,14 @@ template <class ELFT> void Writer<ELFT>::run() {
   if (ErrorCount)
     return;
 
-  if (auto EC = Buffer->commit())
-    error(EC, "failed to write to the output file");
+  commitFile();
+
+  // Save what the next incremental link needs to update the output.
+  if (Config->Incremental && !ErrorCount)
+    writeIncrementalState<ELFT>();
+
+  if (Config->PrintStats)
+    Symtab<ELFT>::X->printStats();
 
   // Flush the output streams and exit immediately. A full shutdown
   // is a good test that we are keeping track of all allocated memory,
@@ -763,12 +810,10 @@ template <class ELFT> static void sortCtorsDtors(OutputSectionBase *S) {
     reinterpret_cast<OutputSection<ELFT> *>(S)->sortCtorsDtors();
 }
 
-// Sort input sections using the list provided by --symbol-ordering-file.
+// Build a map from sections to their priorities using the list provided
+// by --symbol-ordering-file.
 template <class ELFT>
-static void sortBySymbolsOrder(ArrayRef<OutputSectionBase *> OutputSections) {
-  if (Config->SymbolOrderingFile.empty())
-    return;
-
+static DenseMap<InputSectionBase<ELFT> *, int> buildSectionOrder() {
   // Build a map from symbols to their priorities. Symbols that didn't
   // appear in the symbol ordering file have the lowest priority 0.
   // All explicitly mentioned symbols have negative (higher) priorities.
@@ -788,6 +833,20 @@ static void sortBySymbolsOrder(ArrayRef<OutputSectionBase *> OutputSections) {
       Priority = std::min(Priority, SymbolOrder.lookup(D->getName()));
     }
   }
+  return SectionOrder;
+}
+
+// Sort input sections using the list provided by --symbol-ordering-file
+// or the order computed from --call-graph-ordering-file.
+template <class ELFT>
+static void sortBySymbolsOrder(ArrayRef<OutputSectionBase *> OutputSections) {
+  DenseMap<InputSectionBase<ELFT> *, int> SectionOrder;
+  if (!Config->SymbolOrderingFile.empty())
+    SectionOrder = buildSectionOrder<ELFT>();
+  else if (!Config->CallGraphOrderingFile.empty())
+    SectionOrder = computeCallGraphOrder<ELFT>();
+  else
+    return;
 
   // Sort sections by priority.
   for (OutputSectionBase *Base : OutputSections)
@@ -1005,7 +1064,9 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
 
   // Scan relocations. This must be done after every symbol is declared so that
   // we can correctly decide if a dynamic relocation is needed.
-  forEachRelSec(scanRelocations<ELFT>);
+  std::vector<InputSectionBase<ELFT> *> RelSecs;
+  forEachRelSec([&](InputSectionBase<ELFT> &S) { RelSecs.push_back(&S); });
+  scanRelocations<ELFT>(RelSecs);
 
   // Now that we have defined all possible symbols including linker-
   // synthesized ones. Visit all symbols to give the finishing touches.
@@ -1555,8 +1616,7 @@ template <class ELFT> void Writer<ELFT>::fixAbsoluteSymbols() {
   }
 }
 
-template <class ELFT> void Writer<ELFT>::writeHeader() {
-  uint8_t *Buf = Buffer->getBufferStart();
+template <class ELFT> void Writer<ELFT>::writeHeader(uint8_t *Buf) {
   memcpy(Buf, "\177ELF", 4);
 
   // Write the ELF header.
@@ -1602,9 +1662,11 @@ template <class ELFT> void Writer<ELFT>::writeHeader() {
     HBuf->p_align = P.p_align;
     ++HBuf;
   }
+}
 
-  // Write the section header table. Note that the first table entry is null.
-  auto *SHdrs = reinterpret_cast<Elf_Shdr *>(Buf + EHdr->e_shoff);
+// Write the section header table. Note that the first table entry is null.
+template <class ELFT> void Writer<ELFT>::writeSectionHeaders(uint8_t *Buf) {
+  auto *SHdrs = reinterpret_cast<Elf_Shdr *>(Buf);
   for (OutputSectionBase *Sec : OutputSections)
     Sec->writeHeaderTo<ELFT>(++SHdrs);
 }
@@ -1642,9 +1704,75 @@ static void unlinkAsync(StringRef Path) {
   std::thread([=] { ::remove(TempPath.str().str().c_str()); }).detach();
 }
 
+ErrorOr<std::unique_ptr<StreamOutputFile>>
+StreamOutputFile::create(StringRef Path, uint64_t Size) {
+  if (std::error_code EC = sys::fs::remove(Path))
+    return EC;
+
+  unsigned Mode = sys::fs::all_read | sys::fs::all_write | sys::fs::all_exe;
+  SmallString<128> TempPath;
+  int FD;
+  if (std::error_code EC =
+          sys::fs::createUniqueFile(Path + ".tmp%%%%%%%", FD, TempPath, Mode))
+    return EC;
+  sys::RemoveFileOnSignal(TempPath);
+
+  // Create the file object first so that the file is removed on error.
+  std::unique_ptr<StreamOutputFile> F(new StreamOutputFile(FD, Path, TempPath));
+  if (std::error_code EC = sys::fs::resize_file(FD, Size))
+    return EC;
+  return std::move(F);
+}
+
+StreamOutputFile::~StreamOutputFile() {
+  if (!Closed)
+    OS.close();
+  OS.clear_error();
+  if (TempPath.empty())
+    return;
+  sys::fs::remove(TempPath);
+  sys::DontRemoveFileOnSignal(TempPath);
+}
+
+void StreamOutputFile::write(ArrayRef<uint8_t> Data, uint64_t Offset) {
+  OS.seek(Offset);
+  OS.write(reinterpret_cast<const char *>(Data.data()), Data.size());
+}
+
+// Maps the file to memory. This is used to backfill data that depends
+// on the file contents, such as a build-id.
+std::unique_ptr<sys::fs::mapped_file_region>
+StreamOutputFile::map(uint64_t Size, std::error_code &EC) {
+  OS.flush();
+  return llvm::make_unique<sys::fs::mapped_file_region>(
+      FD, sys::fs::mapped_file_region::readwrite, Size, 0, EC);
+}
+
+std::error_code StreamOutputFile::commit() {
+  OS.close();
+  Closed = true;
+  if (OS.has_error())
+    return make_error_code(errc::io_error);
+  std::error_code EC = sys::fs::rename(TempPath, FinalPath);
+  sys::DontRemoveFileOnSignal(TempPath);
+  if (!EC)
+    TempPath.clear();
+  return EC;
+}
+
 // Open a result file.
 template <class ELFT> void Writer<ELFT>::openFile() {
   unlinkAsync(Config->OutputFile);
+  if (!Config->MmapOutputFile) {
+    ErrorOr<std::unique_ptr<StreamOutputFile>> StreamOrErr =
+        StreamOutputFile::create(Config->OutputFile, FileSize);
+    if (auto EC = StreamOrErr.getError())
+      error(EC, "failed to open " + Config->OutputFile);
+    else
+      Stream = std::move(*StreamOrErr);
+    return;
+  }
+
   ErrorOr<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
       FileOutputBuffer::create(Config->OutputFile, FileSize,
                                FileOutputBuffer::F_executable);
@@ -1674,11 +1802,32 @@ template <class ELFT> void Writer<ELFT>::writeSections() {
     Out<ELFT>::Opd->writeTo(Buf + Out<ELFT>::Opd->Offset);
   }
 
+  // Input sections of all regular output sections are written in a
+  // single parallel loop rather than one loop per output section, so
+  // that small sections such as .symtab, .strtab or .rela.dyn are
+  // written concurrently with each other and with large ones. Output
+  // sections of other kinds use their own parallel loops.
   OutputSectionBase *EhFrameHdr =
       In<ELFT>::EhFrameHdr ? In<ELFT>::EhFrameHdr->OutSec : nullptr;
-  for (OutputSectionBase *Sec : OutputSections)
-    if (Sec != Out<ELFT>::Opd && Sec != EhFrameHdr)
+  std::vector<OutputSection<ELFT> *> Regular;
+  std::vector<InputSection<ELFT> *> Inputs;
+  for (OutputSectionBase *Sec : OutputSections) {
+    if (Sec == Out<ELFT>::Opd || Sec == EhFrameHdr)
+      continue;
+    if (auto *OS = dyn_cast<OutputSection<ELFT>>(Sec)) {
+      OS->beginWrite(Buf + OS->Offset);
+      Regular.push_back(OS);
+      Inputs.insert(Inputs.end(), OS->Sections.begin(), OS->Sections.end());
+    } else {
       Sec->writeTo(Buf + Sec->Offset);
+    }
+  }
+
+  forEach(Inputs.begin(), Inputs.end(), [](InputSection<ELFT> *IS) {
+    IS->writeTo(cast<OutputSection<ELFT>>(IS->OutSec)->Loc);
+  });
+  for (OutputSection<ELFT> *OS : Regular)
+    OS->endWrite();
 
   // The .eh_frame_hdr depends on .eh_frame section contents, therefore
   // it should be written after .eh_frame is written.
@@ -1686,14 +1835,89 @@ template <class ELFT> void Writer<ELFT>::writeSections() {
     EhFrameHdr->writeTo(Buf + EhFrameHdr->Offset);
 }
 
+// Write the output file one section at a time without mapping the
+// whole file to memory. Each section is written to a temporary buffer,
+// which is then copied to the file, so the peak memory usage is the
+// size of the largest section rather than the size of the output.
+template <class ELFT> void Writer<ELFT>::streamSections() {
+  if (!Config->OFormatBinary) {
+    std::vector<uint8_t> Buf(sizeof(Elf_Ehdr) +
+                             Phdrs.size() * sizeof(Elf_Phdr));
+    writeHeader(Buf.data());
+    Stream->write(Buf, 0);
+
+    Buf.assign((OutputSections.size() + 1) * sizeof(Elf_Shdr), 0);
+    writeSectionHeaders(Buf.data());
+    Stream->write(Buf, SectionHeaderOff);
+  }
+
+  auto Write = [&](OutputSectionBase *Sec, std::vector<uint8_t> &Buf) {
+    Buf.assign(Sec->Size, 0);
+    Sec->writeTo(Buf.data());
+    Stream->write(Buf, Sec->Offset);
+  };
+
+  // PPC64 needs to process relocations in the .opd section
+  // before processing relocations in code-containing sections,
+  // so we keep .opd contents until the end.
+  std::vector<uint8_t> OpdBuf;
+  Out<ELFT>::Opd = findSection(".opd");
+  if (Out<ELFT>::Opd) {
+    OpdBuf.resize(Out<ELFT>::Opd->Size);
+    Out<ELFT>::OpdBuf = OpdBuf.data();
+    Write(Out<ELFT>::Opd, OpdBuf);
+  }
+
+  OutputSectionBase *EhFrameHdr =
+      In<ELFT>::EhFrameHdr ? In<ELFT>::EhFrameHdr->OutSec : nullptr;
+  std::vector<uint8_t> Buf;
+  for (OutputSectionBase *Sec : OutputSections) {
+    if (Sec == Out<ELFT>::Opd || Sec == EhFrameHdr || Sec->Type == SHT_NOBITS)
+      continue;
+    if (Config->OFormatBinary && !(Sec->Flags & SHF_ALLOC))
+      continue;
+    Write(Sec, Buf);
+
+    // The buffer is reused, so forget it to not confuse error reporting.
+    if (auto *OS = dyn_cast<OutputSection<ELFT>>(Sec))
+      OS->Loc = nullptr;
+  }
+
+  if (!Out<ELFT>::EhFrame->empty() && EhFrameHdr)
+    Write(EhFrameHdr, Buf);
+  Out<ELFT>::OpdBuf = nullptr;
+}
+
 template <class ELFT> void Writer<ELFT>::writeBuildId() {
   if (!In<ELFT>::BuildId || !In<ELFT>::BuildId->OutSec)
     return;
 
-  // Compute a hash of all sections of the output file.
-  uint8_t *Start = Buffer->getBufferStart();
-  uint8_t *End = Start + FileSize;
-  In<ELFT>::BuildId->writeBuildId({Start, End});
+  if (Buffer) {
+    // Compute a hash of all sections of the output file.
+    uint8_t *Start = Buffer->getBufferStart();
+    uint8_t *End = Start + FileSize;
+    In<ELFT>::BuildId->writeBuildId({Start, End});
+    return;
+  }
+
+  // If the output was streamed, map it to memory now. The section is
+  // written again so that the build-id is written to the mapped file.
+  std::error_code EC;
+  std::unique_ptr<sys::fs::mapped_file_region> MF = Stream->map(FileSize, EC);
+  if (EC) {
+    error(EC, "failed to map the output file");
+    return;
+  }
+  uint8_t *Start = reinterpret_cast<uint8_t *>(MF->data());
+  BuildIdSection<ELFT> *BuildId = In<ELFT>::BuildId;
+  BuildId->writeTo(Start + BuildId->OutSec->Offset + BuildId->OutSecOff);
+  BuildId->writeBuildId({Start, Start + FileSize});
+}
+
+template <class ELFT> void Writer<ELFT>::commitFile() {
+  std::error_code EC = Buffer ? Buffer->commit() : Stream->commit();
+  if (EC)
+    error(EC, "failed to write to the output file");
 }
 
 template void elf::writeResult<ELF32LE>();
@@ -0,0 +1,96 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc %s -o %t.obj
+# RUN: lld-link /entry:main /out:%t.exe /subsystem:console /verbose %t.obj \
+# RUN:   > %t.log 2>&1
+# RUN: FileCheck %s < %t.log
+
+## Sections with the same contents are folded if their relocations
+## point to the same symbol or to symbols in folded sections. Sections
+## calling different symbols in a chunk that is not subject to ICF are
+## not folded, even if the symbols are at the same address.
+
+# CHECK:      Selected f1
+# CHECK-NEXT:   Removed f2
+# CHECK-NEXT: Selected f3
+# CHECK-NEXT:   Removed f7
+# CHECK-NEXT:   Removed f8
+# CHECK-NOT:  Removed
+
+.text
+.globl main
+main:
+  call f1
+  call f2
+  call f3
+  call f4
+  call f5
+  call f6
+  call f7
+  call f8
+  ret
+
+# A chunk that is not subject to ICF because it is not a COMDAT.
+.globl h1
+.globl h2
+.globl a1
+.globl a2
+h1:
+  ret
+h2:
+a1:
+a2:
+  ret
+
+.section .text,"xr",one_only,g
+.globl g
+g:
+  nop
+  ret
+
+.section .text,"xr",one_only,f1
+.globl f1
+f1:
+  call g
+  ret
+
+.section .text,"xr",one_only,f2
+.globl f2
+f2:
+  call g
+  ret
+
+.section .text,"xr",one_only,f3
+.globl f3
+f3:
+  call h1
+  ret
+
+.section .text,"xr",one_only,f4
+.globl f4
+f4:
+  call h2
+  ret
+
+.section .text,"xr",one_only,f5
+.globl f5
+f5:
+  call a1
+  ret
+
+.section .text,"xr",one_only,f6
+.globl f6
+f6:
+  call a2
+  ret
+
+.section .text,"xr",one_only,f7
+.globl f7
+f7:
+  call h1
+  ret
+
+.section .text,"xr",one_only,f8
+.globl f8
+f8:
+  call h1
+  ret
@@ -0,0 +1,3 @@
+.section .foo,"ax",@progbits,unique,9
+E:
+ .byte 0xe2
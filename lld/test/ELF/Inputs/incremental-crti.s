@@ -0,0 +1,9 @@
+.section .init,"ax",@progbits
+.globl _init
+_init:
+  push %rax
+
+.section .fini,"ax",@progbits
+.globl _fini
+_fini:
+  push %rax
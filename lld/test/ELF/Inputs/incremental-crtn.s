@@ -0,0 +1,7 @@
+.section .init,"ax",@progbits
+  pop %rax
+  ret
+
+.section .fini,"ax",@progbits
+  pop %rax
+  ret
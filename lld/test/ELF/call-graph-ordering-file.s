@@ -0,0 +1,80 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+
+# RUN: echo "A B 10" > %t.call_graph
+# RUN: echo "C D 100" >> %t.call_graph
+# RUN: echo "D E 50" >> %t.call_graph
+# RUN: echo "F G 0" >> %t.call_graph
+# RUN: echo "A missing 10" >> %t.call_graph
+# RUN: ld.lld --call-graph-ordering-file %t.call_graph %t.o -o %t.out
+# RUN: llvm-objdump -s %t.out | FileCheck %s
+
+# Functions are clustered with their most frequent callers, and clusters
+# are sorted by density. Sections not in the call graph follow them.
+# CHECK:      Contents of section .foo:
+# CHECK-NEXT:  {{[0-9a-f]+}} ccddeeaa bb0f0011 22
+
+# A name defined in more than one section is ignored.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux \
+# RUN:   %p/Inputs/call-graph-ordering-file.s -o %t2.o
+# RUN: ld.lld --call-graph-ordering-file %t.call_graph %t.o %t2.o \
+# RUN:   -o %t2.out 2>&1 | FileCheck -check-prefix=DUP %s
+# RUN: llvm-objdump -s %t2.out | FileCheck -check-prefix=DUPORDER %s
+# DUP: warning: --call-graph-ordering-file: E is defined in more than one section; ignoring it
+# DUPORDER:      Contents of section .foo:
+# DUPORDER-NEXT:  {{[0-9a-f]+}} ccddaabb ee0f0011 22e2
+
+# RUN: echo "A B" > %t.bad
+# RUN: not ld.lld --call-graph-ordering-file %t.bad %t.o -o %t.out 2>&1 \
+# RUN:   | FileCheck -check-prefix=BAD %s
+# BAD: --call-graph-ordering-file: invalid line: A B
+
+# RUN: echo "A" > %t.order
+# RUN: not ld.lld --call-graph-ordering-file %t.call_graph \
+# RUN:   --symbol-ordering-file %t.order %t.o -o %t.out 2>&1 \
+# RUN:   | FileCheck -check-prefix=BOTH %s
+# BOTH: --symbol-ordering-file and --call-graph-ordering-file may not be used together
+
+.globl _start
+_start:
+  ret
+
+.section .foo,"ax",@progbits,unique,1
+.globl A
+A:
+ .byte 0xaa
+
+.section .foo,"ax",@progbits,unique,2
+.globl B
+B:
+ .byte 0xbb
+
+.section .foo,"ax",@progbits,unique,3
+.globl C
+C:
+ .byte 0xcc
+
+.section .foo,"ax",@progbits,unique,4
+.globl D
+D:
+ .byte 0xdd
+
+# Local symbols can be used in call graph profiles.
+.section .foo,"ax",@progbits,unique,5
+E:
+ .byte 0xee
+
+.section .foo,"ax",@progbits,unique,6
+.globl F
+F:
+ .byte 0x0f
+
+.section .foo,"ax",@progbits,unique,7
+.globl G
+G:
+ .byte 0x00
+
+.section .foo,"ax",@progbits,unique,8
+.globl H
+H:
+ .byte 0x11, 0x22
@@ -0,0 +1,9 @@
+# REQUIRES: x86
+# RUN: ld.lld --gdb-index -e main %p/Inputs/gdb-index-a.elf \
+# RUN:   %p/Inputs/gdb-index-b.elf -o %t1 -threads
+# RUN: ld.lld --gdb-index -e main %p/Inputs/gdb-index-a.elf \
+# RUN:   %p/Inputs/gdb-index-b.elf -o %t2 -no-threads
+# RUN: cmp %t1 %t2
+
+## .debug_info sections are read in parallel and merged in input order.
+## Test that the .gdb_index section does not depend on the number of threads.
@@ -0,0 +1,34 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux \
+# RUN:   %p/Inputs/incremental-crti.s -o %ti.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux \
+# RUN:   %p/Inputs/incremental-crtn.s -o %tn.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: rm -f %t.exe.incremental
+# RUN: ld.lld --incremental --incremental-padding=100 %ti.o %t.o %tn.o \
+# RUN:   -o %t.exe
+# RUN: llvm-objdump -d %t.exe | FileCheck %s
+
+## The pieces of .init and .fini form the bodies of _init and _fini.
+## No space may be reserved between them.
+
+# CHECK:      _init:
+# CHECK-NEXT:   201008: 50 pushq %rax
+# CHECK-NEXT:   201009: e8 f3 ff ff ff callq -13 <foo>
+# CHECK-NEXT:   20100e: 58 popq %rax
+# CHECK-NEXT:   20100f: c3 retq
+# CHECK:      _fini:
+# CHECK-NEXT:   201010: 50 pushq %rax
+# CHECK-NEXT:   201011: 58 popq %rax
+# CHECK-NEXT:   201012: c3 retq
+
+.section .init,"ax",@progbits
+  call foo
+
+.text
+.globl _start
+_start:
+  ret
+
+foo:
+  ret
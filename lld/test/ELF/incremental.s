@@ -0,0 +1,88 @@
+# REQUIRES: x86
+# RUN: rm -f %t.o %t.exe %t.exe.incremental
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux -defsym .LVAL=1 %s -o %t.o
+# RUN: ld.lld --incremental --incremental-padding=100 %t.o -o %t.exe
+# RUN: ls %t.exe.incremental
+
+## Nothing has changed.
+# RUN: ld.lld --incremental --incremental-padding=100 %t.o -o %t.exe \
+# RUN:   --verbose 2>&1 | FileCheck -check-prefix=UPTODATE %s
+# UPTODATE: incremental: output is up to date
+
+## Only section contents have changed. The output is patched in place
+## and must be the same as the result of a full link.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux -defsym .LVAL=2 %s -o %t.o
+# RUN: ld.lld --incremental --incremental-padding=100 %t.o -o %t.exe \
+# RUN:   --verbose 2>&1 | FileCheck -check-prefix=PATCH %s
+# RUN: rm -f %t2.exe.incremental
+# RUN: ld.lld --incremental --incremental-padding=100 %t.o -o %t2.exe
+# RUN: cmp %t.exe %t2.exe
+# PATCH: incremental: patched 2 sections
+
+## _start has grown and has a new relocation, but it still fits in the
+## space reserved after it. Its FDE and its symbol size are updated too.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux -defsym .LVAL=3 \
+# RUN:   -defsym .LGROW=1 %s -o %t.o
+# RUN: ld.lld --incremental --incremental-padding=100 %t.o -o %t.exe \
+# RUN:   --verbose 2>&1 | FileCheck -check-prefix=GROW %s
+# RUN: llvm-objdump -s -j .eh_frame %t.exe \
+# RUN:   | FileCheck -check-prefix=GROWEH %s
+# RUN: llvm-objdump -d %t.exe | FileCheck -check-prefix=GROWDIS %s
+# RUN: llvm-nm -S %t.exe | FileCheck -check-prefix=GROWSYM %s
+# GROW: incremental: patched 3 sections
+# GROWEH:      Contents of section .eh_frame:
+# GROWEH-NEXT:  200158 14000000 00000000 017a5200 01781001
+# GROWEH-NEXT:  200168 1b0c0708 90010000 14000000 1c000000
+# GROWEH-NEXT:  200178 880e0000 18000000 00000000 00000000
+# GROWDIS:      _start:
+# GROWDIS-NEXT:   201000: b8 03 00 00 00 movl $3, %eax
+# GROWDIS-NEXT:   201005: e8 1a 00 00 00 callq 26 <foo>
+# GROWDIS-NEXT:   20100a: 48 c7 c1 00 20 20 00 movq $2105344, %rcx
+# GROWDIS-NEXT:   201011: e8 0e 00 00 00 callq 14 <foo>
+# GROWDIS-NEXT:   201016: 90 nop
+# GROWDIS-NEXT:   201017: c3 retq
+# GROWDIS:      foo:
+# GROWDIS-NEXT:   201024: c3 retq
+# GROWSYM: 0000000000201000 0000000000000018 T _start
+
+## _start has grown beyond the reserved space. We need a full link.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux -defsym .LVAL=3 \
+# RUN:   -defsym .LGROW=1 -defsym .LBIG=1 %s -o %t.o
+# RUN: ld.lld --incremental --incremental-padding=100 %t.o -o %t.exe \
+# RUN:   --verbose 2>&1 | FileCheck -check-prefix=FULL %s
+# RUN: rm -f %t2.exe.incremental
+# RUN: ld.lld --incremental --incremental-padding=100 %t.o -o %t2.exe
+# RUN: cmp %t.exe %t2.exe
+# FULL: incremental: cannot patch the output; doing a full link
+
+# RUN: not ld.lld --incremental -r %t.o -o %t3.o 2>&1 \
+# RUN:   | FileCheck -check-prefix=ERR %s
+# ERR: -r and --incremental may not be used together
+
+.section .text._start,"ax",@progbits
+.globl _start
+.type _start, @function
+_start:
+  .cfi_startproc
+  movl $.LVAL, %eax
+  call foo
+  movq $data, %rcx
+.ifdef .LGROW
+  call foo
+  nop
+.endif
+.ifdef .LBIG
+  .fill 64, 1, 0x90
+.endif
+  ret
+  .cfi_endproc
+.size _start, . - _start
+
+.section .text.foo,"ax",@progbits
+foo:
+  ret
+
+.data
+data:
+  .quad .LVAL
+  .quad foo
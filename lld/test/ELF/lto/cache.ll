@@ -0,0 +1,40 @@
+; REQUIRES: x86
+; RUN: opt -module-hash -module-summary %s -o %t.o
+; RUN: opt -module-hash -module-summary %p/Inputs/thinlto.ll -o %t2.o
+
+; RUN: rm -Rf %t.cache && mkdir %t.cache
+; RUN: ld.lld --thinlto-cache-dir=%t.cache --stats -shared %t.o %t2.o -o %t3 \
+; RUN:   | FileCheck -check-prefix=MISS %s
+; RUN: ls %t.cache | count 3
+; RUN: ld.lld --thinlto-cache-dir=%t.cache --stats -shared %t.o %t2.o -o %t4 \
+; RUN:   | FileCheck -check-prefix=HIT %s
+; RUN: cmp %t3 %t4
+
+; MISS:      LTO cache hits:     0
+; MISS-NEXT: LTO cache misses:   2
+; HIT:       LTO cache hits:     2
+; HIT-NEXT:  LTO cache misses:   0
+
+; Files that have not been accessed for longer than prune_after are removed.
+; RUN: touch -t 197001011200 %t.cache/old
+; RUN: ld.lld --thinlto-cache-dir=%t.cache \
+; RUN:   --thinlto-cache-policy=prune_interval=1s:prune_after=1h:cache_size=100% \
+; RUN:   -shared %t.o %t2.o -o %t5
+; RUN: not ls %t.cache/old
+; RUN: ls %t.cache | count 3
+
+; RUN: not ld.lld --thinlto-cache-policy=foo=1:prune_after=1x \
+; RUN:   -shared %t2.o -o %t5 2>&1 | FileCheck -check-prefix=ERR %s
+; ERR: --thinlto-cache-policy: unknown key: foo
+; ERR: --thinlto-cache-policy: invalid value for prune_after: 1x
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @g(...)
+
+define void @f() {
+entry:
+  call void (...) @g()
+  ret void
+}
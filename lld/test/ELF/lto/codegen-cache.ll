@@ -0,0 +1,33 @@
+; REQUIRES: x86
+; RUN: llvm-as %s -o %t.o
+
+; --thinlto-cache-dir doesn't cache the regular LTO code generation, the cache
+; only has its pruning timestamp.
+; RUN: rm -Rf %t.cache && mkdir %t.cache
+; RUN: ld.lld --thinlto-cache-dir=%t.cache --lto-partitions=2 -shared %t.o \
+; RUN:   -o %t1
+; RUN: ls %t.cache | count 1
+
+; --lto-cache-dir caches each code generation partition.
+; RUN: ld.lld --lto-cache-dir=%t.cache --lto-partitions=2 --stats -shared \
+; RUN:   %t.o -o %t2 | FileCheck -check-prefix=MISS %s
+; RUN: ls %t.cache | count 3
+; RUN: ld.lld --lto-cache-dir=%t.cache --lto-partitions=2 --stats -shared \
+; RUN:   %t.o -o %t3 | FileCheck -check-prefix=HIT %s
+; RUN: cmp %t2 %t3
+
+; MISS:      LTO cache hits:     0
+; MISS-NEXT: LTO cache misses:   2
+; HIT:       LTO cache hits:     2
+; HIT-NEXT:  LTO cache misses:   0
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @f() {
+  ret void
+}
+
+define void @g() {
+  ret void
+}
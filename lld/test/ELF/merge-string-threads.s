@@ -0,0 +1,41 @@
+// REQUIRES: x86
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+// RUN: ld.lld -O1 %t.o %t.o -o %t1.so -shared -threads
+// RUN: ld.lld -O1 %t.o %t.o -o %t2.so -shared -no-threads
+// RUN: cmp %t1.so %t2.so
+// RUN: llvm-readobj -s %t1.so | FileCheck %s
+
+// Strings are merged by multiple threads into shards keyed by their hash
+// values. Output must be the same regardless of the number of threads, and
+// duplicates must be merged even if they come from different input files.
+
+        .section .rodata.str1.1,"aMS",@progbits,1
+        .asciz "aaaa"
+        .asciz "bbbb"
+        .asciz "cccc"
+        .asciz "dddd"
+        .asciz "eeee"
+        .asciz "ffff"
+        .asciz "gggg"
+        .asciz "hhhh"
+        .asciz "iiii"
+        .asciz "jjjj"
+        .asciz "kkkk"
+        .asciz "llll"
+        .asciz "mmmm"
+        .asciz "nnnn"
+        .asciz "oooo"
+        .asciz "pppp"
+        .asciz "aaaa"
+        .asciz "bbbb"
+
+// CHECK:      Name: .rodata
+// CHECK-NEXT: Type: SHT_PROGBITS
+// CHECK-NEXT: Flags [
+// CHECK-NEXT:   SHF_ALLOC
+// CHECK-NEXT:   SHF_MERGE
+// CHECK-NEXT:   SHF_STRINGS
+// CHECK-NEXT: ]
+// CHECK-NEXT: Address:
+// CHECK-NEXT: Offset:
+// CHECK-NEXT: Size: 80
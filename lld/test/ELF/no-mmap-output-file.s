@@ -0,0 +1,38 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t1 --eh-frame-hdr -threads
+# RUN: ld.lld %t.o -o %t2 --eh-frame-hdr -no-threads
+# RUN: cmp %t1 %t2
+# RUN: ld.lld %t.o -o %t3 --eh-frame-hdr --no-mmap-output-file
+# RUN: cmp %t1 %t3
+
+## The build-id is computed over the output file after it is written.
+# RUN: ld.lld %t.o -o %t4 --build-id
+# RUN: ld.lld %t.o -o %t5 --build-id --no-mmap-output-file
+# RUN: cmp %t4 %t5
+
+# RUN: ld.lld %t.o -o %t6 --oformat binary
+# RUN: ld.lld %t.o -o %t7 --oformat binary --no-mmap-output-file
+# RUN: cmp %t6 %t7
+
+# RUN: ld.lld %t.o -o %t8.o -r
+# RUN: ld.lld %t.o -o %t9.o -r --no-mmap-output-file
+# RUN: cmp %t8.o %t9.o
+
+.globl _start
+_start:
+  .cfi_startproc
+  call foo
+  movq $bar, %rax
+  .cfi_endproc
+
+foo:
+  ret
+
+.data
+bar:
+  .quad foo
+  .quad _start
+
+.bss
+  .zero 16
@@ -0,0 +1,25 @@
+// REQUIRES: x86
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %p/Inputs/comdat.s -o %t2.o
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %p/Inputs/shared.s -o %t3.o
+// RUN: rm -f %t.a
+// RUN: llvm-ar rcs %t.a %t2.o %t3.o
+// RUN: ld.lld -shared %t.o %t2.o --whole-archive %t.a -o %t1.so -threads
+// RUN: ld.lld -shared %t.o %t2.o --whole-archive %t.a -o %t4.so -no-threads
+// RUN: cmp %t1.so %t4.so
+// RUN: llvm-readobj -s -t %t1.so | FileCheck %s
+
+// Section and symbol tables of input files are read in parallel, and
+// symbols are added to the symbol table in input order. Test that the
+// result doesn't depend on the number of threads and that only the first
+// instance of a comdat group is kept.
+
+// CHECK:     Name: .text3
+// CHECK-NOT: Name: .text3
+// CHECK:     Name: abc
+// CHECK-NOT: Name: abc
+
+        .section .text3,"axG",@progbits,zed,comdat,unique,0
+        .global abc
+abc:
+        call bar@PLT
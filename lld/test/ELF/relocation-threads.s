@@ -0,0 +1,40 @@
+// REQUIRES: x86
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %p/Inputs/shared.s -o %t2.o
+// RUN: ld.lld -shared %t2.o -o %t2.so
+// RUN: ld.lld -shared %t.o %t.o %t2.so -o %t1.so -threads
+// RUN: ld.lld -shared %t.o %t.o %t2.so -o %t3.so -no-threads
+// RUN: cmp %t1.so %t3.so
+// RUN: llvm-readobj -r %t1.so | FileCheck %s
+
+// Relocations that don't need GOT, PLT or dynamic relocations are scanned
+// in parallel, and the others are handled later in input order. Test that
+// the result doesn't depend on the number of threads.
+
+// CHECK:      Relocations [
+// CHECK-NEXT:   Section ({{.*}}) .rela.dyn {
+// CHECK-NEXT:     R_X86_64_RELATIVE - 0x{{[0-9A-F]+}}
+// CHECK-NEXT:     R_X86_64_RELATIVE - 0x{{[0-9A-F]+}}
+// CHECK-DAG:      R_X86_64_64 zed 0x0
+// CHECK-DAG:      R_X86_64_64 zed 0x0
+// CHECK-DAG:      R_X86_64_GLOB_DAT bar2 0x0
+// CHECK:        }
+// CHECK-NEXT:   Section ({{.*}}) .rela.plt {
+// CHECK-NEXT:     R_X86_64_JUMP_SLOT bar 0x0
+// CHECK-NEXT:   }
+// CHECK-NEXT: ]
+
+        .text
+        .cfi_startproc
+        call local
+        call bar@PLT
+        movq bar2@GOTPCREL(%rip), %rax
+        leaq local(%rip), %rax
+        .cfi_endproc
+
+local:
+        ret
+
+        .data
+        .quad local
+        .quad zed
@@ -0,0 +1,19 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: ld.lld --stats %t.o -o %t | FileCheck %s
+
+# CHECK:      global symbols:     2 ({{[0-9]+}} bytes each)
+# CHECK-NEXT: local symbols:      2 ({{[0-9]+}} bytes each)
+# CHECK-NEXT: symbol objects:     {{[0-9]+}} bytes
+# CHECK-NEXT: symbol table:       {{[0-9]+}} bytes
+# CHECK-NEXT: symbol side tables: {{[0-9]+}} bytes
+# CHECK-NEXT: arena:              {{[0-9]+}} bytes
+# CHECK-NEXT: malloc:             {{[0-9]+}} bytes
+
+.globl _start, foo
+_start:
+  call foo
+foo:
+  ret
+local1:
+local2:
@@ -21,6 +21,16 @@
 # AFTER:      Contents of section .foo:
 # AFTER-NEXT:  201000 44335566 2211
 
+## Sections of the listed symbols have negative priorities and must come
+## before the sections of unlisted symbols, which keep their order.
+# RUN: echo "_bar1" > %t_order2.txt
+# RUN: echo "_foo3" >> %t_order2.txt
+# RUN: ld.lld --symbol-ordering-file %t_order2.txt %t.o -o %t3.out
+# RUN: llvm-objdump -s %t3.out| FileCheck %s --check-prefix=PARTIAL
+
+# PARTIAL:      Contents of section .foo:
+# PARTIAL-NEXT:  201000 55663311 2244
+
 .section .foo,"ax",@progbits,unique,1
 _foo1:
  .byte 0x11
@@ -30,6 +30,9 @@
 #include "llvm/Support/Compiler.h"
 #include <atomic>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace llvm {
 
@@ -165,6 +168,10 @@ void PrintStatistics();
 /// \brief Print statistics to the given output stream.
 void PrintStatistics(raw_ostream &OS);
 
+/// \brief Return the name and value of the registered statistics. The names
+/// are formed as in the JSON output, by joining the debug type and the name.
+std::vector<std::pair<std::string, unsigned>> GetStatistics();
+
 /// Print statistics in JSON format. This does include all global timers (\see
 /// Timer, TimerGroup). Note that the timers are cleared after printing and will
 /// not be printed in human readable form or in a second call of
@@ -148,6 +148,15 @@ public:
     }
   }
 
+  /// Append \p Words, whole 32-bit words written by another BitstreamWriter,
+  /// e.g. complete blocks. The stream must be at a word boundary, from where
+  /// the encoding of a block doesn't depend on the bits before it.
+  void AppendWords(ArrayRef<char> Words) {
+    assert(CurBit == 0 && "Not 32-bit aligned");
+    assert((Words.size() & 3) == 0 && "Not a whole number of words");
+    Out.append(Words.begin(), Words.end());
+  }
+
   void EmitVBR(uint32_t Val, unsigned NumBits) {
     assert(NumBits <= 32 && "Too many bits to emit!");
     uint32_t Threshold = 1U << (NumBits-1);
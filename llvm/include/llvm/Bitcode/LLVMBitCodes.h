@@ -255,6 +255,8 @@ enum MetadataCodes {
   METADATA_STRINGS = 35,         // [count, offset] blob([lengths][chars])
   METADATA_GLOBAL_DECL_ATTACHMENT = 36, // [valueid, n x [id, mdnode]]
   METADATA_GLOBAL_VAR_EXPR = 37, // [distinct, var, expr]
+  METADATA_INDEX_OFFSET = 38,    // [offset]
+  METADATA_INDEX = 39,           // [bitpos]
 };
 
 // The constants block (CONSTANTS_BLOCK_ID) describes emission for each
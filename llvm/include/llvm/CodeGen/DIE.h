@@ -14,6 +14,7 @@
 #ifndef LLVM_LIB_CODEGEN_ASMPRINTER_DIE_H
 #define LLVM_LIB_CODEGEN_ASMPRINTER_DIE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/PointerUnion.h"
@@ -139,6 +140,13 @@ public:
   /// owned by this class.
   DIEAbbrev &uniqueAbbreviation(DIE &Die);
 
+  /// Unique a copy of \p Abbrev, e.g. from another set, and return the
+  /// abbreviation owned by this class.
+  DIEAbbrev &uniqueAbbreviation(const DIEAbbrev &Abbrev);
+
+  /// The unique abbreviations in the order of their numbers.
+  ArrayRef<DIEAbbrev *> getAbbreviations() const { return Abbreviations; }
+
   /// Print all abbreviations using the specified asm printer.
   void Emit(const AsmPrinter *AP, MCSection *Section) const;
 };
@@ -871,6 +879,13 @@ public:
   void print(raw_ostream &O) const;
 };
 
+// DIEs, their values and the blocks are allocated from a BumpPtrAllocator and
+// are never destroyed: the memory is released with the allocator.
+static_assert(std::is_trivially_destructible<DIE>::value &&
+                  std::is_trivially_destructible<DIELoc>::value &&
+                  std::is_trivially_destructible<DIEBlock>::value,
+              "Expected DIEs and blocks to be trivially destructible");
+
 } // end namespace llvm
 
 #endif // LLVM_LIB_CODEGEN_ASMPRINTER_DIE_H
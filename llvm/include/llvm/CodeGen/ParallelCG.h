@@ -35,6 +35,13 @@ class raw_pwrite_stream;
 /// Writes bitcode for individual partitions into output streams in BCOSs, if
 /// BCOSs is not empty.
 ///
+/// Splitting the module is the only way to generate code on several threads.
+/// The MachineFunction pipeline of a single module can't run concurrently on
+/// its functions: symbol creation in MCContext, MachineFunction creation in
+/// MachineModuleInfo and the subtarget cache of the TargetMachine aren't
+/// thread-safe, and the AsmPrinter can't merge the output of several functions
+/// into one streamer in their original order.
+///
 /// \returns M if OSs.size() == 1, otherwise returns std::unique_ptr<Module>().
 std::unique_ptr<Module>
 splitCodeGen(std::unique_ptr<Module> M, ArrayRef<raw_pwrite_stream *> OSs,
@@ -76,6 +76,11 @@ public:
   BasicBlock &operator=(const BasicBlock &) = delete;
   ~BasicBlock() override;
 
+  /// Allocate basic blocks from the IR arena of the context, when it is
+  /// enabled. \see LLVMContext::enableIRArena().
+  void *operator new(size_t Size);
+  void operator delete(void *Ptr);
+
   /// \brief Get the context in which this basic block lives.
   LLVMContext &getContext() const;
 
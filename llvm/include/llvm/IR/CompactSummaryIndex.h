@@ -0,0 +1,203 @@
+//===- llvm/IR/CompactSummaryIndex.h - Flat summary index format -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// @file
+/// This file declares a compact, memory-mappable representation of a combined
+/// ModuleSummaryIndex.
+///
+/// The index is made of flat little-endian arrays which are used in place, so
+/// opening an index doesn't deserialize anything. GUIDs are interned in a
+/// sorted table and everything else refers to GUIDs by their position in that
+/// table. The summaries of each GUID, the summaries of each module and the
+/// call, reference and type test edges of each summary are stored in
+/// compressed sparse row form: an array of begin offsets, one per row plus a
+/// final end offset, indexes into a flat array of elements.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_COMPACTSUMMARYINDEX_H
+#define LLVM_IR_COMPACTSUMMARYINDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace llvm {
+class raw_ostream;
+
+namespace csi {
+using support::ulittle32_t;
+using support::ulittle64_t;
+
+const char Magic[8] = {'L', 'L', 'V', 'M', 'C', 'S', 'I', '\0'};
+const uint32_t Version = 1;
+
+/// The file header. It is followed by the arrays of the index in the order of
+/// the fields of CompactSummaryIndex, each one aligned to 8 bytes.
+struct Header {
+  char Magic[8];
+  ulittle32_t Version;
+  ulittle32_t NumModules;
+  ulittle32_t NumGUIDs;
+  ulittle32_t NumSummaries;
+  ulittle32_t NumCalls;
+  ulittle32_t NumRefs;
+  ulittle32_t NumTypeTests;
+  ulittle32_t StringTableSize;
+};
+
+struct Module {
+  ulittle32_t NameOffset;
+  ulittle32_t NameSize;
+  ulittle64_t Id;
+  ulittle32_t Hash[5];
+  ulittle32_t Padding;
+};
+
+struct Summary {
+  /// The summary kind in bits 0-1, the linkage in bits 2-5, then the NoRename,
+  /// HasInlineAsmMaybeReferencingInternal and IsNotViableToInline flags.
+  ulittle32_t Flags;
+  ulittle32_t Module;
+  ulittle32_t InstCount;
+  /// The index of the aliasee summary for an alias, ~0U otherwise.
+  ulittle32_t Aliasee;
+  ulittle64_t OriginalName;
+};
+
+/// A call edge: the GUID index of the callee shifted left by two, or'ed with
+/// the hotness of the call.
+typedef ulittle32_t Call;
+
+/// The maximum number of GUIDs of an index, so that GUID indices fit in the
+/// call edges.
+const uint32_t MaxGUIDs = 1U << 30;
+} // end namespace csi
+
+/// A read-only view of a summary index in the compact format.
+///
+/// The accessors work on indices: GUID indices in [0, getNumGUIDs()), summary
+/// indices in [0, getNumSummaries()) and module indices in
+/// [0, getNumModules()). create() only checks that the arrays fit in the
+/// buffer, call verify() to check the contents of an untrusted file.
+class CompactSummaryIndex {
+public:
+  /// Opens the index in \p Buffer, which must outlive the returned object.
+  static Expected<CompactSummaryIndex> create(MemoryBufferRef Buffer);
+
+  /// Returns true if \p Buffer starts with the magic of the compact format.
+  static bool isCompactSummaryIndex(MemoryBufferRef Buffer);
+
+  /// Checks the consistency of the offsets and indices of the index.
+  Error verify() const;
+
+  unsigned getNumModules() const { return Modules.size(); }
+  unsigned getNumGUIDs() const { return GUIDs.size(); }
+  unsigned getNumSummaries() const { return Summaries.size(); }
+  unsigned getNumCalls() const { return Calls.size(); }
+  unsigned getNumRefs() const { return Refs.size(); }
+
+  StringRef getModulePath(unsigned M) const {
+    return StringTable.substr(Modules[M].NameOffset, Modules[M].NameSize);
+  }
+  uint64_t getModuleId(unsigned M) const { return Modules[M].Id; }
+  ModuleHash getModuleHash(unsigned M) const;
+
+  GlobalValue::GUID getGUID(unsigned G) const { return GUIDs[G]; }
+  /// Returns the index of \p GUID in the GUID table, if it is there.
+  Optional<unsigned> findGUID(GlobalValue::GUID GUID) const;
+
+  /// The summaries of the GUID at index \p G are the summary indices in
+  /// [summary_begin(G), summary_end(G)).
+  unsigned summary_begin(unsigned G) const { return SummaryBegin[G]; }
+  unsigned summary_end(unsigned G) const { return SummaryBegin[G + 1]; }
+  /// Returns the GUID index of summary \p S.
+  unsigned getGUIDIndex(unsigned S) const;
+
+  /// The summaries defined in module \p M are the elements
+  /// [module_summary_begin(M), module_summary_end(M)) of getModuleSummary().
+  unsigned module_summary_begin(unsigned M) const {
+    return ModuleSummaryBegin[M];
+  }
+  unsigned module_summary_end(unsigned M) const {
+    return ModuleSummaryBegin[M + 1];
+  }
+  unsigned getModuleSummary(unsigned I) const { return ModuleSummaries[I]; }
+
+  GlobalValueSummary::SummaryKind getSummaryKind(unsigned S) const {
+    return GlobalValueSummary::SummaryKind(Summaries[S].Flags & 3);
+  }
+  GlobalValueSummary::GVFlags getFlags(unsigned S) const;
+  GlobalValue::LinkageTypes getLinkage(unsigned S) const {
+    return GlobalValue::LinkageTypes((Summaries[S].Flags >> 2) & 15);
+  }
+  unsigned getModule(unsigned S) const { return Summaries[S].Module; }
+  unsigned getInstCount(unsigned S) const { return Summaries[S].InstCount; }
+  GlobalValue::GUID getOriginalName(unsigned S) const {
+    return Summaries[S].OriginalName;
+  }
+  /// Returns the summary index of the aliasee of the alias summary \p S.
+  unsigned getAliasee(unsigned S) const {
+    assert(getSummaryKind(S) == GlobalValueSummary::AliasKind);
+    return Summaries[S].Aliasee;
+  }
+
+  /// The call edges of summary \p S are [call_begin(S), call_end(S)).
+  unsigned call_begin(unsigned S) const { return CallBegin[S]; }
+  unsigned call_end(unsigned S) const { return CallBegin[S + 1]; }
+  /// Returns the GUID index of the callee of call edge \p E.
+  unsigned getCallee(unsigned E) const { return Calls[E] >> 2; }
+  CalleeInfo::HotnessType getHotness(unsigned E) const {
+    return CalleeInfo::HotnessType(Calls[E] & 3);
+  }
+
+  /// The reference edges of summary \p S are [ref_begin(S), ref_end(S)).
+  unsigned ref_begin(unsigned S) const { return RefBegin[S]; }
+  unsigned ref_end(unsigned S) const { return RefBegin[S + 1]; }
+  /// Returns the GUID index of the value referenced by edge \p E.
+  unsigned getRef(unsigned E) const { return Refs[E]; }
+
+  /// Returns the type identifiers tested by summary \p S.
+  ArrayRef<csi::ulittle64_t> type_tests(unsigned S) const {
+    return TypeTests.slice(TypeTestBegin[S],
+                           TypeTestBegin[S + 1] - TypeTestBegin[S]);
+  }
+
+private:
+  CompactSummaryIndex() = default;
+
+  ArrayRef<csi::Module> Modules;
+  ArrayRef<csi::ulittle64_t> GUIDs;
+  ArrayRef<csi::ulittle32_t> SummaryBegin;
+  ArrayRef<csi::Summary> Summaries;
+  ArrayRef<csi::ulittle32_t> ModuleSummaryBegin;
+  ArrayRef<csi::ulittle32_t> ModuleSummaries;
+  ArrayRef<csi::ulittle32_t> CallBegin;
+  ArrayRef<csi::Call> Calls;
+  ArrayRef<csi::ulittle32_t> RefBegin;
+  ArrayRef<csi::ulittle32_t> Refs;
+  ArrayRef<csi::ulittle32_t> TypeTestBegin;
+  ArrayRef<csi::ulittle64_t> TypeTests;
+  StringRef StringTable;
+};
+
+/// Writes \p Index to \p OS in the compact format. Nothing is written if
+/// \p Index can't be represented: if it has more than csi::MaxGUIDs GUIDs, if
+/// one of its counts of summaries, call edges, references or type tests, or
+/// the total size of its module paths doesn't fit in 32 bits, or if the
+/// aliasee of an alias has no summary in \p Index or is not a function.
+Error writeCompactSummaryIndex(const ModuleSummaryIndex &Index,
+                               raw_ostream &OS);
+
+} // end namespace llvm
+
+#endif // LLVM_IR_COMPACTSUMMARYINDEX_H
@@ -133,6 +133,22 @@ public:
   void enableDebugTypeODRUniquing();
   void disableDebugTypeODRUniquing();
 
+  /// Allocate the instructions, constants, global values and basic blocks
+  /// created on the calling thread from a bump allocator owned by this
+  /// context. Deleting one of them doesn't release its memory, which is only
+  /// released, at once, when the context is destroyed. This cuts the cost of
+  /// creating IR for clients which keep most of it until the end, like -O0
+  /// compilations, at the cost of never reusing the memory of deleted IR.
+  ///
+  /// The arena is used until disableIRArena() is called on the same thread or
+  /// the context is destroyed. In the meantime, IR of other contexts must not
+  /// be created on the calling thread.
+  void enableIRArena();
+  void disableIRArena();
+
+  /// Returns the number of bytes allocated from the IR arena.
+  size_t getIRArenaSize() const;
+
   typedef void (*InlineAsmDiagHandlerTy)(const SMDiagnostic&, void *Context,
                                          unsigned LocCookie);
 
@@ -16,6 +16,7 @@
 
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
@@ -316,8 +317,10 @@ public:
   /// verifyPreservedAnalysis -- Verify analysis presreved by pass P.
   void verifyPreservedAnalysis(Pass *P);
 
-  /// Remove Analysis that is not preserved by the pass
-  void removeNotPreservedAnalysis(Pass *P);
+  /// Remove Analysis that is not preserved by the pass. \p IRName is the name
+  /// of the IR unit the pass ran on, or None if the pass is being scheduled,
+  /// in which case no trace event is recorded.
+  void removeNotPreservedAnalysis(Pass *P, Optional<StringRef> IRName);
 
   /// Remove dead passes used by P.
   void removeDeadPasses(Pass *P, StringRef Msg,
@@ -46,6 +46,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManagerInternal.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TraceEvents.h"
 #include "llvm/Support/TypeName.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/type_traits.h"
@@ -419,7 +420,13 @@ public:
         dbgs() << "Running pass: " << Passes[Idx]->name() << " on "
                << IR.getName() << "\n";
 
-      PreservedAnalyses PassPA = Passes[Idx]->run(IR, AM, ExtraArgs...);
+      PreservedAnalyses PassPA;
+      {
+        trace::Scope TraceScope;
+        if (trace::isEnabled())
+          TraceScope.begin("pass", Passes[Idx]->name(), IR.getName());
+        PassPA = Passes[Idx]->run(IR, AM, ExtraArgs...);
+      }
 
       // Update the analysis manager as each pass runs and potentially
       // invalidates analyses.
@@ -781,6 +788,9 @@ public:
         if (DebugLogging)
           dbgs() << "Invalidating analysis: " << this->lookUpPass(ID).name()
                  << "\n";
+        if (trace::isEnabled())
+          trace::recordInstant("invalidation", this->lookUpPass(ID).name(),
+                               IR.getName());
 
         I = ResultsList.erase(I);
         AnalysisResults.erase({ID, &IR});
@@ -823,7 +833,12 @@ private:
       if (DebugLogging)
         dbgs() << "Running analysis: " << P.name() << "\n";
       AnalysisResultListT &ResultList = AnalysisResultLists[&IR];
-      ResultList.emplace_back(ID, P.run(IR, *this, ExtraArgs...));
+      {
+        trace::Scope TraceScope;
+        if (trace::isEnabled())
+          TraceScope.begin("analysis", P.name(), IR.getName());
+        ResultList.emplace_back(ID, P.run(IR, *this, ExtraArgs...));
+      }
 
       // P.run may have inserted elements into AnalysisResults and invalidated
       // RI.
@@ -853,6 +868,9 @@ private:
     if (DebugLogging)
       dbgs() << "Invalidating analysis: " << this->lookUpPass(ID).name()
              << "\n";
+    if (trace::isEnabled())
+      trace::recordInstant("invalidation", this->lookUpPass(ID).name(),
+                           IR.getName());
     AnalysisResultLists[&IR].erase(RI->second);
     AnalysisResults.erase(RI);
   }
@@ -107,7 +107,7 @@ protected:
   ///
   /// Note, this should *NOT* be used directly by any class other than User.
   /// User uses this value to find the Use list.
-  enum : unsigned { NumUserOperandsBits = 28 };
+  enum : unsigned { NumUserOperandsBits = 27 };
   unsigned NumUserOperands : NumUserOperandsBits;
 
   // Use the same type as the bitfield above so that MSVC will pack them.
@@ -115,6 +115,9 @@ protected:
   unsigned HasName : 1;
   unsigned HasHungOffUses : 1;
   unsigned HasDescriptor : 1;
+  /// Set by the operator new of User and BasicBlock, which are the only ones
+  /// to read it, when the storage comes from the IR arena of the context.
+  unsigned IsArenaAllocated : 1;
 
 private:
   template <typename UseT> // UseT == 'Use' or 'const Use'
@@ -47,6 +47,10 @@ struct Config {
   /// Disable entirely the optimizer, including importing for ThinLTO
   bool CodeGenOnly = false;
 
+  /// The number of threads used by the index-wide analyses of the ThinLTO
+  /// thin link. Zero means heavyweight_hardware_concurrency().
+  unsigned ThinLinkThreads = 0;
+
   /// If this field is set, the set of passes run in the middle-end optimizer
   /// will be the one specified by the string. Only works with the new pass
   /// manager as the old one doesn't have this ability.
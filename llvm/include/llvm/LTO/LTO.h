@@ -37,6 +37,7 @@ class LLVMContext;
 class MemoryBufferRef;
 class Module;
 class Target;
+class ThreadPool;
 class raw_pwrite_stream;
 
 /// Resolve Weak and LinkOnce values in the \p Index. Linkage changes recorded
@@ -45,19 +46,29 @@ class raw_pwrite_stream;
 ///
 /// This is done for correctness (if value exported, ensure we always
 /// emit a copy), and compile-time optimization (allow drop of duplicates).
+///
+/// The index is processed on the threads of \p Pool and the calling thread,
+/// or serially if \p Pool is null, so \p isPrevailing must be thread-safe.
+/// \p recordNewLinkage is only called from the calling thread, in the order of
+/// the index.
 void thinLTOResolveWeakForLinkerInIndex(
     ModuleSummaryIndex &Index,
     function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
         isPrevailing,
     function_ref<void(StringRef, GlobalValue::GUID, GlobalValue::LinkageTypes)>
-        recordNewLinkage);
+        recordNewLinkage,
+    ThreadPool *Pool = nullptr);
 
 /// Update the linkages in the given \p Index to mark exported values
 /// as external and non-exported values as internal. The ThinLTO backends
 /// must apply the changes to the Module via thinLTOInternalizeModule.
+///
+/// The index is processed on the threads of \p Pool and the calling thread,
+/// or serially if \p Pool is null, so \p isExported must be thread-safe.
 void thinLTOInternalizeAndPromoteInIndex(
     ModuleSummaryIndex &Index,
-    function_ref<bool(StringRef, GlobalValue::GUID)> isExported);
+    function_ref<bool(StringRef, GlobalValue::GUID)> isExported,
+    ThreadPool *Pool = nullptr);
 
 namespace lto {
 
@@ -336,11 +347,17 @@ public:
   /// function to add native object files to the link.
   ///
   /// The Cache parameter is optional. If supplied, it will be used to cache
-  /// native object files and add them to the link.
+  /// the native object files of the ThinLTO backends, per module, and add them
+  /// to the link.
+  ///
+  /// The RegularLTOCache parameter is optional. If supplied, it will be used
+  /// to cache the native object files of the regular LTO backend, per code
+  /// generation partition, keyed on the optimized IR of the partition.
   ///
-  /// The client will receive at most one callback (via either AddStream or
-  /// Cache) for each task identifier.
-  Error run(AddStreamFn AddStream, NativeObjectCache Cache = nullptr);
+  /// The client will receive at most one callback (via either AddStream,
+  /// Cache or RegularLTOCache) for each task identifier.
+  Error run(AddStreamFn AddStream, NativeObjectCache Cache = nullptr,
+            NativeObjectCache RegularLTOCache = nullptr);
 
 private:
   Config Conf;
@@ -427,7 +444,7 @@ private:
                    iterator_range<InputFile::symbol_iterator> Syms,
                    const SymbolResolution *&ResI, const SymbolResolution *ResE);
 
-  Error runRegularLTO(AddStreamFn AddStream);
+  Error runRegularLTO(AddStreamFn AddStream, NativeObjectCache Cache);
   Error runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache,
                    bool HasRegularLTO);
 
@@ -30,14 +30,18 @@ namespace llvm {
 class BitcodeModule;
 class Error;
 class Module;
+class SHA1;
 class Target;
 
 namespace lto {
 
-/// Runs a regular LTO backend.
+/// Runs a regular LTO backend. If \p Cache is given, the object of each code
+/// generation partition is looked up in \p Cache, keyed on the optimized IR of
+/// the partition, so that only the partitions whose functions changed need to
+/// be generated again.
 Error backend(Config &C, AddStreamFn AddStream,
               unsigned ParallelCodeGenParallelismLevel,
-              std::unique_ptr<Module> M);
+              std::unique_ptr<Module> M, NativeObjectCache Cache = nullptr);
 
 /// Runs a ThinLTO backend.
 Error thinBackend(Config &C, unsigned Task, AddStreamFn AddStream, Module &M,
@@ -45,6 +49,14 @@ Error thinBackend(Config &C, unsigned Task, AddStreamFn AddStream, Module &M,
                   const FunctionImporter::ImportMapTy &ImportList,
                   const GVSummaryMapTy &DefinedGlobals,
                   MapVector<StringRef, BitcodeModule> &ModuleMap);
+
+/// Adds the compiler version and the parts of \p Conf that affect code
+/// generation to \p Hasher, for the keys of the native object cache.
+void hashCodeGenConfig(SHA1 &Hasher, const Config &Conf);
+
+/// Prints the memory usage of the process at the end of \p Phase of the
+/// regular LTO link if -lto-memory-report is given.
+void reportMemoryUsage(StringRef Phase);
 }
 }
 
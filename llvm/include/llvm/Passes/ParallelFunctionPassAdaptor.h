@@ -0,0 +1,66 @@
+//===- ParallelFunctionPassAdaptor.h ----------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file provides a module pass adaptor which runs a function pass
+/// pipeline over the functions of a module on several threads.
+///
+/// An \c LLVMContext is not thread-safe, so function passes cannot simply be
+/// run concurrently over the functions of one module. Instead, the defined
+/// functions are split into partitions balanced by instruction count. Each
+/// partition is optimized on its own thread in a private context, using a
+/// copy of the module in which the bodies of all functions outside of the
+/// partition are replaced with a single unreachable instruction. The
+/// optimized function bodies are then moved back into the original module in
+/// partition order, so the result doesn't depend on the number of threads.
+/// The partitions are read back into the original context one after
+/// another on the calling thread.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PASSES_PARALLELFUNCTIONPASSADAPTOR_H
+#define LLVM_PASSES_PARALLELFUNCTIONPASSADAPTOR_H
+
+#include "llvm/IR/PassManager.h"
+#include <functional>
+
+namespace llvm {
+class PassBuilder;
+class TargetMachine;
+
+/// \brief A module pass which runs a function pass pipeline over the
+/// functions of the module on several threads.
+///
+/// The pipeline is created by \c BuildPipeline once per thread so that no
+/// pass state is shared between threads. \c BuildPipeline returns false if
+/// the pipeline couldn't be built.
+class ParallelModuleToFunctionPassAdaptor
+    : public PassInfoMixin<ParallelModuleToFunctionPassAdaptor> {
+public:
+  typedef std::function<bool(PassBuilder &, FunctionPassManager &)>
+      PipelineBuilderT;
+
+  ParallelModuleToFunctionPassAdaptor(TargetMachine *TM,
+                                      PipelineBuilderT BuildPipeline,
+                                      bool DebugLogging = false)
+      : TM(TM), BuildPipeline(std::move(BuildPipeline)),
+        DebugLogging(DebugLogging) {}
+
+  /// \brief Runs the function pipeline across the module.
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+  TargetMachine *TM;
+  PipelineBuilderT BuildPipeline;
+  bool DebugLogging;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_PASSES_PARALLELFUNCTIONPASSADAPTOR_H
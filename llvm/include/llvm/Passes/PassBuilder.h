@@ -285,6 +285,7 @@ private:
 
   static Optional<std::vector<PipelineElement>>
   parsePipelineText(StringRef Text);
+  static std::string printPipelineText(ArrayRef<PipelineElement> Pipeline);
 
   bool parseModulePass(ModulePassManager &MPM, const PipelineElement &E,
                        bool VerifyEachPass, bool DebugLogging);
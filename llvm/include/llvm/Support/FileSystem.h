@@ -653,6 +653,11 @@ inline OpenFlags &operator|=(OpenFlags &A, OpenFlags B) {
 std::error_code openFileForWrite(const Twine &Name, int &ResultFD,
                                  OpenFlags Flags, unsigned Mode = 0666);
 
+/// @brief Opens an existing file for reading and writing. Unlike
+/// openFileForWrite, the file is neither created nor truncated, so that
+/// parts of it can be updated in place.
+std::error_code openFileForReadWrite(const Twine &Name, int &ResultFD);
+
 std::error_code openFileForRead(const Twine &Name, int &ResultFD,
                                 SmallVectorImpl<char> *RealPath = nullptr);
 
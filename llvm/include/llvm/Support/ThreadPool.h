@@ -7,7 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file defines a crude C++11 based thread pool.
+// This file defines a C++11 based work-stealing thread pool.
 //
 //===----------------------------------------------------------------------===//
 
@@ -33,21 +33,125 @@
 #pragma warning(pop)
 #endif
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 
+/// A move-only type-erased nullary callable. Callables of up to
+/// \c InlineSize bytes are stored in the object itself, so queueing a small
+/// task doesn't allocate.
+class ThreadPoolTask {
+  static const size_t InlineSize = 4 * sizeof(void *);
+
+  struct Operations {
+    void (*Call)(void *Storage);
+    void (*Move)(void *Dst, void *Src);
+    void (*Destroy)(void *Storage);
+  };
+
+  template <typename Callable> struct InlineOperations {
+    static void call(void *S) { (*static_cast<Callable *>(S))(); }
+    static void move(void *Dst, void *Src) {
+      new (Dst) Callable(std::move(*static_cast<Callable *>(Src)));
+      static_cast<Callable *>(Src)->~Callable();
+    }
+    static void destroy(void *S) { static_cast<Callable *>(S)->~Callable(); }
+    static const Operations Ops;
+  };
+
+  template <typename Callable> struct OutOfLineOperations {
+    static Callable *&get(void *S) { return *static_cast<Callable **>(S); }
+    static void call(void *S) { (*get(S))(); }
+    static void move(void *Dst, void *Src) {
+      new (Dst) Callable *(get(Src));
+    }
+    static void destroy(void *S) { delete get(S); }
+    static const Operations Ops;
+  };
+
+public:
+  ThreadPoolTask() : Ops(nullptr) {}
+
+  template <typename Callable,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<Callable>::type,
+                ThreadPoolTask>::value>::type>
+  ThreadPoolTask(Callable &&F) {
+    typedef typename std::decay<Callable>::type T;
+    if (sizeof(T) <= InlineSize && alignof(T) <= alignof(StorageT) &&
+        std::is_nothrow_move_constructible<T>::value) {
+      new (&Storage) T(std::forward<Callable>(F));
+      Ops = &InlineOperations<T>::Ops;
+    } else {
+      new (&Storage) T *(new T(std::forward<Callable>(F)));
+      Ops = &OutOfLineOperations<T>::Ops;
+    }
+  }
+
+  ThreadPoolTask(ThreadPoolTask &&Other) : Ops(Other.Ops) {
+    if (Ops)
+      Ops->Move(&Storage, &Other.Storage);
+    Other.Ops = nullptr;
+  }
+
+  ThreadPoolTask &operator=(ThreadPoolTask &&Other) {
+    if (this != &Other) {
+      this->~ThreadPoolTask();
+      new (this) ThreadPoolTask(std::move(Other));
+    }
+    return *this;
+  }
+
+  ThreadPoolTask(const ThreadPoolTask &) = delete;
+  ThreadPoolTask &operator=(const ThreadPoolTask &) = delete;
+
+  ~ThreadPoolTask() {
+    if (Ops)
+      Ops->Destroy(&Storage);
+  }
+
+  explicit operator bool() const { return Ops != nullptr; }
+
+  void operator()() { Ops->Call(&Storage); }
+
+private:
+  typedef std::aligned_storage<InlineSize, alignof(void *)>::type StorageT;
+  StorageT Storage;
+  const Operations *Ops;
+};
+
+template <typename Callable>
+const ThreadPoolTask::Operations
+    ThreadPoolTask::InlineOperations<Callable>::Ops = {
+        &InlineOperations<Callable>::call, &InlineOperations<Callable>::move,
+        &InlineOperations<Callable>::destroy};
+
+template <typename Callable>
+const ThreadPoolTask::Operations
+    ThreadPoolTask::OutOfLineOperations<Callable>::Ops = {
+        &OutOfLineOperations<Callable>::call,
+        &OutOfLineOperations<Callable>::move,
+        &OutOfLineOperations<Callable>::destroy};
+
 /// A ThreadPool for asynchronous parallel execution on a defined number of
 /// threads.
 ///
-/// The pool keeps a vector of threads alive, waiting on a condition variable
-/// for some work to become available.
+/// Each thread owns a double-ended queue of tasks. Tasks queued by a thread
+/// of the pool go to the back of that thread's queue, and the thread takes
+/// its own work from the back, which keeps recently touched data in its
+/// cache. Tasks queued from outside of the pool go to a shared queue in FIFO
+/// order. A thread without work takes tasks from the shared queue and then
+/// steals from the front of the queues of the other threads. Threads without
+/// any work to do wait on a condition variable.
 class ThreadPool {
 public:
 #ifndef _MSC_VER
@@ -102,36 +206,156 @@ public:
   }
 
   /// Blocking wait for all the threads to complete and the queue to be empty.
-  /// It is an error to try to add new tasks while blocking on this call.
+  /// It is an error to try to add new tasks while blocking on this call, or
+  /// to call it from a thread of the pool. Use a \c TaskGroup to wait for a
+  /// subset of the tasks from a thread of the pool.
   void wait();
 
+  /// The number of threads of the pool, which doesn't count the threads
+  /// outside of the pool which wait for and run its tasks.
+  unsigned getThreadCount() const { return Threads.size(); }
+
 private:
+  friend class TaskGroup;
+
+  struct WorkQueue {
+    std::mutex Lock;
+    std::deque<ThreadPoolTask> Tasks;
+  };
+
   /// Asynchronous submission of a task to the pool. The returned future can be
   /// used to wait for the task to finish and is *non-blocking* on destruction.
   std::shared_future<VoidTy> asyncImpl(TaskTy F);
 
+  /// Queue a task without creating a future for it.
+  void push(ThreadPoolTask Task);
+
+  /// Take a task for the thread with the given queue index, or for a thread
+  /// outside of the pool if \p Index is the number of threads.
+  bool pop(unsigned Index, ThreadPoolTask &Task);
+
+  /// Run one queued task on the calling thread. Returns false if there was
+  /// nothing to run.
+  bool runPendingTask();
+
+  void runTask(ThreadPoolTask &Task);
+
   /// Threads in flight
   std::vector<llvm::thread> Threads;
 
-  /// Tasks waiting for execution in the pool.
-  std::queue<PackagedTaskTy> Tasks;
-
-  /// Locking and signaling for accessing the Tasks queue.
-  std::mutex QueueLock;
-  std::condition_variable QueueCondition;
+  /// Tasks queued by each thread of the pool, and a last queue for tasks
+  /// queued from outside of the pool.
+  std::vector<std::unique_ptr<WorkQueue>> Queues;
 
-  /// Locking and signaling for job completion
-  std::mutex CompletionLock;
+  /// Signaling for idle threads and for job completion. The counters below
+  /// are updated without the lock, which is only taken to wait and before
+  /// signaling a thread that may be waiting.
+  std::mutex Lock;
+  std::condition_variable WorkCondition;
   std::condition_variable CompletionCondition;
 
+  /// Number of queued tasks that no thread has taken yet.
+  std::atomic<unsigned> PendingTasks;
+
   /// Keep track of the number of thread actually busy
   std::atomic<unsigned> ActiveThreads;
 
+  /// Number of threads of the pool waiting for work.
+  std::atomic<unsigned> IdleThreads;
+
+  /// Number of threads waiting in wait() or TaskGroup::wait().
+  std::atomic<unsigned> CompletionWaiters;
+
+  /// Number of threads waiting in TaskGroup::wait().
+  std::atomic<unsigned> GroupWaiters;
+
 #if LLVM_ENABLE_THREADS // avoids warning for unused variable
   /// Signal for the destruction of the pool, asking thread to exit.
   bool EnableFlag;
 #endif
 };
+
+/// A set of tasks running on a ThreadPool which can be waited for as a
+/// group. Unlike ThreadPool::wait(), TaskGroup::wait() may be called from a
+/// thread of the pool, so tasks can fork and join nested groups. The
+/// waiting thread runs queued tasks of the pool until the group is done
+/// instead of blocking.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &Pool) : Pool(Pool), Pending(0) {}
+
+  /// Waits for the tasks of the group.
+  ~TaskGroup() { wait(); }
+
+  /// Queue \p F as a task of this group.
+  template <typename Function> void spawn(Function &&F) {
+    ++Pending;
+    Pool.push(GroupTask<typename std::decay<Function>::type>(
+        *this, std::forward<Function>(F)));
+  }
+
+  /// Wait for all the tasks spawned in this group so far.
+  void wait();
+
+private:
+  template <typename Function> struct GroupTask {
+    GroupTask(TaskGroup &G, Function F) : G(G), F(std::move(F)) {}
+    void operator()() {
+      F();
+      --G.Pending;
+    }
+    TaskGroup &G;
+    Function F;
+  };
+
+  ThreadPool &Pool;
+  std::atomic<unsigned> Pending;
+};
+
+/// Calls \p Fn on every index of [\p Begin, \p End) using the threads of
+/// \p Pool and the calling thread, and waits for all the calls. The range is
+/// split in chunks so that the cost of a task is amortized over several
+/// indices. Runs serially if \p Pool is null or has no threads. Unlike the
+/// overload below, this lets the caller reuse the threads of a pool across
+/// several loops.
+template <typename FuncTy>
+void parallelFor(ThreadPool *Pool, size_t Begin, size_t End, FuncTy Fn) {
+  unsigned ThreadCount = Pool ? Pool->getThreadCount() + 1 : 1;
+  if (ThreadCount > 1 && End - Begin > 1) {
+    // A few chunks per thread so that the threads stay balanced when the cost
+    // of the indices varies.
+    size_t ChunkSize = std::max<size_t>(1, (End - Begin) / (ThreadCount * 8));
+    TaskGroup Group(*Pool);
+    for (size_t I = Begin; I < End; I += ChunkSize) {
+      size_t ChunkEnd = std::min(End, I + ChunkSize);
+      Group.spawn([=, &Fn] {
+        for (size_t J = I; J != ChunkEnd; ++J)
+          Fn(J);
+      });
+    }
+    Group.wait();
+    return;
+  }
+  for (size_t I = Begin; I != End; ++I)
+    Fn(I);
+}
+
+/// Calls \p Fn on every index of [\p Begin, \p End) using \p ThreadCount
+/// threads, including the calling one, and waits for all the calls. The
+/// threads are created for this call only. Runs serially if \p ThreadCount is
+/// at most one.
+template <typename FuncTy>
+void parallelFor(unsigned ThreadCount, size_t Begin, size_t End, FuncTy Fn) {
+#if LLVM_ENABLE_THREADS
+  if (ThreadCount > 1 && End - Begin > 1) {
+    ThreadPool Pool(ThreadCount - 1);
+    parallelFor(&Pool, Begin, End, std::move(Fn));
+    return;
+  }
+#endif
+  for (size_t I = Begin; I != End; ++I)
+    Fn(I);
+}
 }
 
 #endif // LLVM_SUPPORT_THREAD_POOL_H
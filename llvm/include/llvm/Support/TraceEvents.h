@@ -0,0 +1,102 @@
+//===-- llvm/Support/TraceEvents.h - Trace event recording ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// \file
+/// This file declares a low overhead recorder of trace events, which are
+/// written in the Chrome trace event JSON format.
+///
+/// Recording is enabled with -trace-events-file=<file>; the events are
+/// written to that file by llvm_shutdown(). When recording is disabled,
+/// each instrumentation point only tests a global flag. The
+/// -trace-events-sample-rate and -trace-events-min-us options keep the
+/// overhead and the size of the traces low enough to leave recording on in
+/// production: the former only records one process out of N, and the latter
+/// drops the scopes that are shorter than the given duration.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TRACEEVENTS_H
+#define LLVM_SUPPORT_TRACEEVENTS_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include <atomic>
+#include <string>
+
+namespace llvm {
+class raw_ostream;
+
+namespace trace {
+
+namespace detail {
+enum StateTy { Uninitialized, Disabled, Enabled };
+extern std::atomic<StateTy> State;
+bool initialize();
+} // end namespace detail
+
+/// Returns true if trace events are being recorded.
+inline bool isEnabled() {
+  detail::StateTy S = detail::State.load(std::memory_order_relaxed);
+  if (LLVM_LIKELY(S == detail::Disabled))
+    return false;
+  if (S == detail::Enabled)
+    return true;
+  return detail::initialize();
+}
+
+/// Records a complete event for the lifetime of the scope, e.g. the run of a
+/// pass. \p Category is a string literal, \p Detail describes the unit of IR
+/// the event applies to and is copied.
+///
+/// The default constructor creates an inactive scope, which is started with
+/// begin() when the name or the detail of the event are costly to compute:
+/// \code
+///   trace::Scope TraceScope;
+///   if (trace::isEnabled())
+///     TraceScope.begin("pass", P->getPassName(), F.getName());
+/// \endcode
+class Scope {
+public:
+  Scope() = default;
+  Scope(const char *Category, StringRef Name, StringRef Detail) {
+    if (LLVM_UNLIKELY(isEnabled()))
+      begin(Category, Name, Detail);
+  }
+  ~Scope() {
+    if (LLVM_UNLIKELY(Category != nullptr))
+      end();
+  }
+
+  /// Starts the scope. Recording must be enabled.
+  void begin(const char *Category, StringRef Name, StringRef Detail);
+
+private:
+  Scope(const Scope &) = delete;
+  void operator=(const Scope &) = delete;
+
+  void end();
+
+  const char *Category = nullptr;
+  std::string Name;
+  std::string Detail;
+  uint64_t Start = 0;
+};
+
+/// Records an instant event, e.g. the invalidation of an analysis.
+void recordInstant(const char *Category, StringRef Name, StringRef Detail);
+
+/// Writes the events recorded so far and the value of the statistics as a
+/// Chrome trace event JSON object. Events must not be recorded concurrently.
+void write(raw_ostream &OS);
+
+} // end namespace trace
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_TRACEEVENTS_H
@@ -22,9 +22,11 @@
 #include <utility>
 
 namespace llvm {
+class CompactSummaryIndex;
 class LLVMContext;
 class GlobalValueSummary;
 class Module;
+class ThreadPool;
 
 /// The function importer is automatically importing function from other modules
 /// based on the provided summary informations.
@@ -86,11 +88,26 @@ public:
 /// \p ExportLists contains for each Module the set of globals (GUID) that will
 /// be imported by another module, or referenced by such a function. I.e. this
 /// is the set of globals that need to be promoted/renamed appropriately.
+///
+/// The modules are processed on the threads of \p Pool and the calling
+/// thread, or serially if \p Pool is null. The result doesn't depend on the
+/// number of threads.
 void ComputeCrossModuleImport(
     const ModuleSummaryIndex &Index,
     const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
-    StringMap<FunctionImporter::ExportSetTy> &ExportLists);
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    ThreadPool *Pool = nullptr);
+
+/// Compute all the imports and exports for every module in the compact
+/// \p Index, with the same result as for the ModuleSummaryIndex it was written
+/// from.
+/// Every module which defines a summary gets an entry in \p ImportLists.
+void ComputeCrossModuleImport(
+    const CompactSummaryIndex &Index,
+    StringMap<FunctionImporter::ImportMapTy> &ImportLists,
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    ThreadPool *Pool = nullptr);
 
 /// Compute all the imports for the given module using the Index.
 ///
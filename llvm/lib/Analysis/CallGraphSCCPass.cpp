@@ -27,6 +27,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Timer.h"
+#include "llvm/Support/TraceEvents.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
@@ -122,6 +123,12 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      trace::Scope TraceScope;
+      if (trace::isEnabled()) {
+        Function *F = (*CurSCC.begin())->getFunction();
+        TraceScope.begin("pass", CGSP->getPassName(),
+                         F ? F->getName() : "<external node>");
+      }
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
@@ -146,6 +153,9 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
       dumpPassInfo(P, EXECUTION_MSG, ON_FUNCTION_MSG, F->getName());
       {
         TimeRegion PassTimer(getPassTimer(FPP));
+        trace::Scope TraceScope;
+        if (trace::isEnabled())
+          TraceScope.begin("pass", FPP->getPassName(), F->getName());
         Changed |= FPP->runOnFunction(*F);
       }
       F->getContext().yield();
@@ -422,7 +432,8 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
     dumpPreservedSet(P);
     
     verifyPreservedAnalysis(P);      
-    removeNotPreservedAnalysis(P);
+    Function *F = (*CurSCC.begin())->getFunction();
+    removeNotPreservedAnalysis(P, F ? F->getName() : "<external node>");
     recordAvailableAnalysis(P);
     removeDeadPasses(P, "", ON_CG_MSG);
   }
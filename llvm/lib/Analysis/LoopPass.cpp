@@ -22,6 +22,7 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Timer.h"
+#include "llvm/Support/TraceEvents.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
@@ -197,6 +198,10 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        trace::Scope TraceScope;
+        if (trace::isEnabled())
+          TraceScope.begin("pass", P->getPassName(),
+                           CurrentLoop->getHeader()->getName());
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
@@ -234,7 +239,9 @@ bool LPPassManager::runOnFunction(Function &F) {
         F.getContext().yield();
       }
 
-      removeNotPreservedAnalysis(P);
+      removeNotPreservedAnalysis(P, LoopWasDeleted
+                                        ? "<deleted>"
+                                        : CurrentLoop->getHeader()->getName());
       recordAvailableAnalysis(P);
       removeDeadPasses(P, LoopWasDeleted ? "<deleted>"
                                          : CurrentLoop->getHeader()->getName(),
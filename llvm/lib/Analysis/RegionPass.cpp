@@ -17,6 +17,7 @@
 #include "llvm/Analysis/RegionIterator.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Timer.h"
+#include "llvm/Support/TraceEvents.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
@@ -94,6 +95,10 @@ bool RGPassManager::runOnFunction(Function &F) {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
         TimeRegion PassTimer(getPassTimer(P));
+        trace::Scope TraceScope;
+        if (trace::isEnabled())
+          TraceScope.begin("pass", P->getPassName(),
+                           CurrentRegion->getNameStr());
         Changed |= P->runOnRegion(CurrentRegion, *this);
       }
 
@@ -120,7 +125,9 @@ bool RGPassManager::runOnFunction(Function &F) {
         verifyPreservedAnalysis(P);
       }
 
-      removeNotPreservedAnalysis(P);
+      removeNotPreservedAnalysis(P, StringRef(
+          (!trace::isEnabled() || skipThisRegion) ?
+          "<deleted>" : CurrentRegion->getNameStr()));
       recordAvailableAnalysis(P);
       removeDeadPasses(P,
                        (!isPassDebuggingExecutionsOrMore() || skipThisRegion) ?
@@ -18,6 +18,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ADT/Twine.h"
@@ -86,12 +87,22 @@
 
 using namespace llvm;
 
+#define DEBUG_TYPE "bitcode-reader"
+
+STATISTIC(NumMDStringLoaded, "Number of MDStrings loaded");
+STATISTIC(NumMDRecordLoaded, "Number of Metadata records loaded");
+
 /// Flag whether we need to import full type definitions for ThinLTO.
 /// Currently needed for Darwin and LLDB.
 static cl::opt<bool> ImportFullTypeDefinitions(
     "import-full-type-definitions", cl::init(false), cl::Hidden,
     cl::desc("Import full type definitions for ThinLTO."));
 
+static cl::opt<bool> DisableLazyLoading(
+    "disable-ondemand-mds-loading", cl::init(false), cl::Hidden,
+    cl::desc("Force disable the lazy-loading on-demand of metadata when "
+             "loading bitcode for importing."));
+
 namespace {
 
 static int64_t unrotateSign(uint64_t U) { return U & 1 ? ~(U >> 1) : U >> 1; }
@@ -119,6 +130,17 @@ class BitcodeReaderMetadataList {
     SmallVector<std::pair<TrackingMDRef, TempMDTuple>, 1> Arrays;
   } OldTypeRefs;
 
+  /// The strings of METADATA_STRINGS records whose MDStrings haven't been
+  /// created yet. The strings point into the bitcode buffer, and an MDString
+  /// is created when a string is first referenced, so strings that are never
+  /// used (for example those of functions that are never materialized) cost
+  /// neither an allocation nor a hash table lookup.
+  struct LazyStringRange {
+    unsigned Begin;
+    std::vector<StringRef> Strings;
+  };
+  std::vector<LazyStringRange> LazyStrings;
+
   LLVMContext &Context;
 
 public:
@@ -128,19 +150,22 @@ public:
   unsigned size() const { return MetadataPtrs.size(); }
   void resize(unsigned N) { MetadataPtrs.resize(N); }
   void push_back(Metadata *MD) { MetadataPtrs.emplace_back(MD); }
-  void clear() { MetadataPtrs.clear(); }
-  Metadata *back() const { return MetadataPtrs.back(); }
-  void pop_back() { MetadataPtrs.pop_back(); }
+  void clear() {
+    MetadataPtrs.clear();
+    LazyStrings.clear();
+  }
   bool empty() const { return MetadataPtrs.empty(); }
 
-  Metadata *operator[](unsigned i) const {
+  Metadata *operator[](unsigned i) {
     assert(i < MetadataPtrs.size());
-    return MetadataPtrs[i];
+    if (Metadata *MD = MetadataPtrs[i])
+      return MD;
+    return materializeString(i);
   }
 
-  Metadata *lookup(unsigned I) const {
+  Metadata *lookup(unsigned I) {
     if (I < MetadataPtrs.size())
-      return MetadataPtrs[I];
+      return (*this)[I];
     return nullptr;
   }
 
@@ -149,8 +174,14 @@ public:
     assert(ForwardReference.empty() && "Unexpected forward refs");
     assert(UnresolvedNodes.empty() && "Unexpected unresolved node");
     MetadataPtrs.resize(N);
+    while (!LazyStrings.empty() && LazyStrings.back().Begin >= N)
+      LazyStrings.pop_back();
   }
 
+  /// Reserve IDs starting at \p Begin for \p Strings, whose MDStrings are
+  /// created on first use.
+  void addLazyStrings(unsigned Begin, std::vector<StringRef> Strings);
+
   /// Return the given metadata, creating a replaceable forward reference if
   /// necessary.
   Metadata *getMetadataFwdRef(unsigned Idx);
@@ -165,6 +196,9 @@ public:
   void assignValue(Metadata *MD, unsigned Idx);
   void tryToResolveCycles();
   bool hasFwdRefs() const { return !ForwardReference.empty(); }
+  const SmallDenseSet<unsigned, 1> &getForwardReferences() const {
+    return ForwardReference;
+  }
 
   /// Upgrade a type that had an MDString reference.
   void addTypeRef(MDString &UUID, DICompositeType &CT);
@@ -177,8 +211,42 @@ public:
 
 private:
   Metadata *resolveTypeRefArray(Metadata *MaybeTuple);
+
+  /// Create the MDString for ID \p Idx if it is a lazily read string.
+  Metadata *materializeString(unsigned Idx);
 };
 
+void BitcodeReaderMetadataList::addLazyStrings(unsigned Begin,
+                                               std::vector<StringRef> Strings) {
+  assert((LazyStrings.empty() || LazyStrings.back().Begin < Begin) &&
+         "Strings must be added in order");
+  unsigned End = Begin + Strings.size();
+  if (size() < End)
+    resize(End);
+
+  // Strings can't be forward referenced, but replace placeholders created
+  // by invalid references anyway.
+  for (unsigned I = Begin; I != End; ++I)
+    if (MetadataPtrs[I])
+      assignValue(MDString::get(Context, Strings[I - Begin]), I);
+  LazyStrings.push_back({Begin, std::move(Strings)});
+}
+
+Metadata *BitcodeReaderMetadataList::materializeString(unsigned Idx) {
+  auto I = std::upper_bound(
+      LazyStrings.begin(), LazyStrings.end(), Idx,
+      [](unsigned Idx, const LazyStringRange &R) { return Idx < R.Begin; });
+  if (I == LazyStrings.begin())
+    return nullptr;
+  --I;
+  if (Idx - I->Begin >= I->Strings.size())
+    return nullptr;
+  MDString *MDS = MDString::get(Context, I->Strings[Idx - I->Begin]);
+  MetadataPtrs[Idx].reset(MDS);
+  ++NumMDStringLoaded;
+  return MDS;
+}
+
 void BitcodeReaderMetadataList::assignValue(Metadata *MD, unsigned Idx) {
   if (auto *MDN = dyn_cast<MDNode>(MD))
     if (!MDN->isResolved())
@@ -208,7 +276,7 @@ Metadata *BitcodeReaderMetadataList::getMetadataFwdRef(unsigned Idx) {
   if (Idx >= size())
     resize(Idx + 1);
 
-  if (Metadata *MD = MetadataPtrs[Idx])
+  if (Metadata *MD = (*this)[Idx])
     return MD;
 
   // Track forward refs to be resolved later.
@@ -342,6 +410,11 @@ class PlaceholderQueue {
 public:
   DistinctMDOperandPlaceholder &getPlaceholderOp(unsigned ID);
   void flush(BitcodeReaderMetadataList &MetadataList);
+
+  /// Add the IDs of the placeholders whose metadata hasn't been loaded yet,
+  /// or is still a forward reference, to \p Temporaries.
+  void getTemporaries(BitcodeReaderMetadataList &MetadataList,
+                      SmallVectorImpl<unsigned> &Temporaries);
 };
 
 } // end anonymous namespace
@@ -365,6 +438,16 @@ void PlaceholderQueue::flush(BitcodeReaderMetadataList &MetadataList) {
   }
 }
 
+void PlaceholderQueue::getTemporaries(BitcodeReaderMetadataList &MetadataList,
+                                      SmallVectorImpl<unsigned> &Temporaries) {
+  for (auto &PH : PHs) {
+    unsigned ID = PH.getID();
+    auto *MD = MetadataList.lookup(ID);
+    if (!MD || (isa<MDNode>(MD) && cast<MDNode>(MD)->isTemporary()))
+      Temporaries.push_back(ID);
+  }
+}
+
 } // anonynous namespace
 
 class MetadataLoader::MetadataLoaderImpl {
@@ -375,6 +458,17 @@ class MetadataLoader::MetadataLoaderImpl {
   Module &TheModule;
   std::function<Type *(unsigned)> getTypeByID;
 
+  /// Cursor used to load module-level metadata records on demand.
+  BitstreamCursor IndexCursor;
+
+  /// The ID of the first record of the index below.
+  unsigned GlobalMetadataBegin = 0;
+
+  /// The bit position in the stream of each module-level metadata record,
+  /// read from the METADATA_INDEX record when importing. The records are
+  /// only loaded when they are referenced.
+  std::vector<uint64_t> GlobalMetadataBitPosIndex;
+
   // Keep mapping of seens pair of old-style CU <-> SP, and update pointers to
   // point from SP to CU after a block is completly parsed.
   std::vector<std::pair<DICompileUnit *, Metadata *>> CUSubprograms;
@@ -401,6 +495,31 @@ class MetadataLoader::MetadataLoaderImpl {
                                     ArrayRef<uint64_t> Record);
   Error parseMetadataKindRecord(SmallVectorImpl<uint64_t> &Record);
 
+  /// Read the strings and the index of the module-level metadata block,
+  /// and load the named metadata and the global attachments along with the
+  /// metadata they reference. Return false if the block has no index, in
+  /// which case nothing was loaded.
+  Expected<bool> lazyLoadModuleMetadataBlock(unsigned &NextMetadataNo);
+
+  /// Return true if \p ID is a module-level record that can be loaded on
+  /// demand.
+  bool isLazyLoadable(unsigned ID) const {
+    return ID >= GlobalMetadataBegin &&
+           ID - GlobalMetadataBegin < GlobalMetadataBitPosIndex.size();
+  }
+
+  /// Load the module-level record \p ID, and recursively the uniqued nodes
+  /// it refers to. References to distinct nodes go through \p Placeholders.
+  Error lazyLoadOneMetadata(unsigned ID, PlaceholderQueue &Placeholders);
+
+  /// Load the records that are still forward referenced or that placeholders
+  /// are waiting for, then resolve the cycles and the placeholders.
+  Error resolveForwardRefsAndPlaceholders(PlaceholderQueue &Placeholders);
+
+  /// Return the given metadata, loading it if it is a module-level record
+  /// that hasn't been loaded yet, and creating a forward reference otherwise.
+  Metadata *getMetadataFwdRefOrLoad(unsigned ID);
+
 public:
   MetadataLoaderImpl(BitstreamCursor &Stream, Module &TheModule,
                      BitcodeReaderValueList &ValueList,
@@ -414,11 +533,11 @@ public:
 
   bool hasFwdRefs() const { return MetadataList.hasFwdRefs(); }
   Metadata *getMetadataFwdRef(unsigned Idx) {
-    return MetadataList.getMetadataFwdRef(Idx);
+    return getMetadataFwdRefOrLoad(Idx);
   }
 
   MDNode *getMDNodeFwdRefOrNull(unsigned Idx) {
-    return MetadataList.getMDNodeFwdRefOrNull(Idx);
+    return dyn_cast_or_null<MDNode>(getMetadataFwdRefOrLoad(Idx));
   }
 
   DISubprogram *lookupSubprogramForFunction(Function *F) {
@@ -450,6 +569,10 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadata(bool ModuleLevel) {
   if (!ModuleLevel && MetadataList.hasFwdRefs())
     return error("Invalid metadata: fwd refs into function blocks");
 
+  // Remember where the block starts so that it can be skipped in one go once
+  // it has been indexed.
+  uint64_t EntryPos = Stream.GetCurrentBitNo();
+
   if (Stream.EnterSubBlock(bitc::METADATA_BLOCK_ID))
     return error("Invalid record");
 
@@ -458,6 +581,27 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadata(bool ModuleLevel) {
 
   PlaceholderQueue Placeholders;
 
+  // When importing, only a few functions are materialized, and they need
+  // only a fraction of the module-level metadata. If the block has an index,
+  // load the records on demand instead of parsing all of them.
+  if (ModuleLevel && IsImporting && MetadataList.empty() &&
+      !DisableLazyLoading) {
+    Expected<bool> Indexed = lazyLoadModuleMetadataBlock(NextMetadataNo);
+    if (!Indexed)
+      return Indexed.takeError();
+    if (*Indexed) {
+      if (Error Err = resolveForwardRefsAndPlaceholders(Placeholders))
+        return Err;
+      // Pop the block scope and skip the whole block.
+      Stream.ReadBlockEnd();
+      Stream.JumpToBit(EntryPos);
+      if (Stream.SkipBlock())
+        return error("Invalid record");
+      return Error::success();
+    }
+    // No index: fall back to parsing the whole block.
+  }
+
   // Read all the records.
   while (true) {
     BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
@@ -475,9 +619,7 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadata(bool ModuleLevel) {
               SP->replaceOperandWith(7, CU_SP.first);
       CUSubprograms.clear();
 
-      MetadataList.tryToResolveCycles();
-      Placeholders.flush(MetadataList);
-      return Error::success();
+      return resolveForwardRefsAndPlaceholders(Placeholders);
     case BitstreamEntry::Record:
       // The interesting case.
       break;
@@ -487,12 +629,193 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadata(bool ModuleLevel) {
     Record.clear();
     StringRef Blob;
     unsigned Code = Stream.readRecord(Entry.ID, Record, &Blob);
+    ++NumMDRecordLoaded;
     if (Error Err = parseOneMetadata(Record, Code, Placeholders, Blob,
                                      ModuleLevel, NextMetadataNo))
       return Err;
   }
 }
 
+Expected<bool> MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock(
+    unsigned &NextMetadataNo) {
+  // Scan the block with a copy of the stream, which is left alone so that the
+  // caller can skip the block.
+  BitstreamCursor Cursor = Stream;
+  SmallVector<uint64_t, 64> Record;
+
+  // Only the strings and the index may come before the records. Anything
+  // else means the block was written without an index.
+  auto HasIndex = [&] { return !GlobalMetadataBitPosIndex.empty(); };
+  auto NoIndex = [&] {
+    MetadataList.clear();
+    GlobalMetadataBitPosIndex.clear();
+    NextMetadataNo = 0;
+    return false;
+  };
+
+  while (true) {
+    BitstreamEntry Entry = Cursor.advanceSkippingSubblocks(
+        BitstreamCursor::AF_DontPopBlockAtEnd);
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return HasIndex() ? true : NoIndex();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    Record.clear();
+    StringRef Blob;
+    unsigned Code = Cursor.readRecord(Entry.ID, Record, &Blob);
+    switch (Code) {
+    default:
+      return NoIndex();
+    case bitc::METADATA_STRINGS:
+      if (HasIndex())
+        return error("Invalid record");
+      if (Error Err = parseMetadataStrings(Record, Blob, NextMetadataNo))
+        return std::move(Err);
+      break;
+    case bitc::METADATA_INDEX_OFFSET: {
+      if (Record.size() != 2 || HasIndex())
+        return error("Invalid record");
+      uint64_t Offset = Record[0] | (Record[1] << 32);
+      uint64_t BeginPos = Cursor.GetCurrentBitNo();
+      Cursor.JumpToBit(BeginPos + Offset);
+      Entry = Cursor.advanceSkippingSubblocks(
+          BitstreamCursor::AF_DontPopBlockAtEnd);
+      if (Entry.Kind != BitstreamEntry::Record)
+        return error("Invalid metadata index");
+      Record.clear();
+      if (Cursor.readRecord(Entry.ID, Record) != bitc::METADATA_INDEX ||
+          Record.empty())
+        return error("Invalid metadata index");
+
+      // The positions are delta encoded, starting from the end of the offset
+      // record.
+      uint64_t Pos = BeginPos;
+      GlobalMetadataBitPosIndex.reserve(Record.size());
+      for (uint64_t Delta : Record) {
+        Pos += Delta;
+        GlobalMetadataBitPosIndex.push_back(Pos);
+      }
+      // Loading a record moves the cursor, so use another one that knows
+      // about the abbreviations of the records.
+      IndexCursor = Cursor;
+      GlobalMetadataBegin = NextMetadataNo;
+      NextMetadataNo += GlobalMetadataBitPosIndex.size();
+      MetadataList.resize(NextMetadataNo);
+      break;
+    }
+    case bitc::METADATA_NAME: {
+      if (!HasIndex())
+        return NoIndex();
+      SmallString<8> Name(Record.begin(), Record.end());
+      Record.clear();
+      Code = Cursor.ReadCode();
+      if (Cursor.readRecord(Code, Record) != bitc::METADATA_NAMED_NODE)
+        return error("METADATA_NAME not followed by METADATA_NAMED_NODE");
+
+      NamedMDNode *NMD = TheModule.getOrInsertNamedMetadata(Name);
+      for (uint64_t ID : Record) {
+        MDNode *MD = getMDNodeFwdRefOrNull(ID);
+        if (!MD)
+          return error("Invalid record");
+        NMD->addOperand(MD);
+      }
+      break;
+    }
+    case bitc::METADATA_GLOBAL_DECL_ATTACHMENT: {
+      if (!HasIndex())
+        return NoIndex();
+      if (Record.size() % 2 == 0)
+        return error("Invalid record");
+      unsigned ValueID = Record[0];
+      if (ValueID >= ValueList.size())
+        return error("Invalid record");
+      if (auto *GO = dyn_cast<GlobalObject>(ValueList[ValueID]))
+        if (Error Err = parseGlobalObjectAttachment(
+                *GO, ArrayRef<uint64_t>(Record).slice(1)))
+          return std::move(Err);
+      break;
+    }
+    }
+  }
+}
+
+Error MetadataLoader::MetadataLoaderImpl::lazyLoadOneMetadata(
+    unsigned ID, PlaceholderQueue &Placeholders) {
+  assert(isLazyLoadable(ID) && "Not a module-level record");
+  IndexCursor.JumpToBit(GlobalMetadataBitPosIndex[ID - GlobalMetadataBegin]);
+  BitstreamEntry Entry = IndexCursor.advanceSkippingSubblocks(
+      BitstreamCursor::AF_DontPopBlockAtEnd);
+  if (Entry.Kind != BitstreamEntry::Record)
+    return error("Invalid metadata index");
+
+  SmallVector<uint64_t, 64> Record;
+  StringRef Blob;
+  unsigned Code = IndexCursor.readRecord(Entry.ID, Record, &Blob);
+  ++NumMDRecordLoaded;
+  return parseOneMetadata(Record, Code, Placeholders, Blob,
+                          /*ModuleLevel=*/true, ID);
+}
+
+Error MetadataLoader::MetadataLoaderImpl::resolveForwardRefsAndPlaceholders(
+    PlaceholderQueue &Placeholders) {
+  // Loading a record can add new forward references and placeholders, so
+  // iterate until every module-level record that is needed is loaded.
+  SmallVector<unsigned, 16> ToLoad;
+  while (!GlobalMetadataBitPosIndex.empty()) {
+    ToLoad.clear();
+    for (unsigned ID : MetadataList.getForwardReferences())
+      if (isLazyLoadable(ID))
+        ToLoad.push_back(ID);
+    Placeholders.getTemporaries(MetadataList, ToLoad);
+    ToLoad.erase(remove_if(ToLoad,
+                           [&](unsigned ID) { return !isLazyLoadable(ID); }),
+                 ToLoad.end());
+    if (ToLoad.empty())
+      break;
+
+    for (unsigned ID : ToLoad) {
+      // Skip the records that were loaded along with an earlier one.
+      Metadata *MD = MetadataList.lookup(ID);
+      if (MD && !(isa<MDNode>(MD) && cast<MDNode>(MD)->isTemporary()))
+        continue;
+      if (Error Err = lazyLoadOneMetadata(ID, Placeholders))
+        return Err;
+    }
+  }
+
+  MetadataList.tryToResolveCycles();
+  Placeholders.flush(MetadataList);
+  return Error::success();
+}
+
+Metadata *
+MetadataLoader::MetadataLoaderImpl::getMetadataFwdRefOrLoad(unsigned ID) {
+  if (Metadata *MD = MetadataList.lookup(ID))
+    return MD;
+  if (!isLazyLoadable(ID))
+    return MetadataList.getMetadataFwdRef(ID);
+
+  PlaceholderQueue Placeholders;
+  if (Error Err = lazyLoadOneMetadata(ID, Placeholders)) {
+    // Leave a forward reference; the caller reports the unresolved reference.
+    consumeError(std::move(Err));
+    return MetadataList.getMetadataFwdRef(ID);
+  }
+  if (Error Err = resolveForwardRefsAndPlaceholders(Placeholders)) {
+    consumeError(std::move(Err));
+    return MetadataList.getMetadataFwdRef(ID);
+  }
+  return MetadataList.lookup(ID);
+}
+
 Error MetadataLoader::MetadataLoaderImpl::parseOneMetadata(
     SmallVectorImpl<uint64_t> &Record, unsigned Code,
     PlaceholderQueue &Placeholders, StringRef Blob, bool ModuleLevel,
@@ -500,8 +823,21 @@ Error MetadataLoader::MetadataLoaderImpl::parseOneMetadata(
 
   bool IsDistinct = false;
   auto getMD = [&](unsigned ID) -> Metadata * {
-    if (!IsDistinct)
+    if (!IsDistinct) {
+      if (Metadata *MD = MetadataList.lookup(ID))
+        return MD;
+      // Load a module-level operand right away rather than creating a
+      // temporary that would have to be RAUW'd. The node being parsed gets a
+      // temporary first, in case the operand refers back to it.
+      if (isLazyLoadable(ID)) {
+        MetadataList.getMetadataFwdRef(NextMetadataNo);
+        // On failure, leave a forward reference: loading it again when the
+        // forward references are resolved reports the error.
+        if (Error Err = lazyLoadOneMetadata(ID, Placeholders))
+          consumeError(std::move(Err));
+      }
       return MetadataList.getMetadataFwdRef(ID);
+    }
     if (auto *MD = MetadataList.getMetadataIfResolved(ID))
       return MD;
     return &Placeholders.getPlaceholderOp(ID);
@@ -1188,6 +1524,11 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadataStrings(
   StringRef Lengths = Blob.slice(0, StringsOffset);
   SimpleBitstreamCursor R(Lengths);
 
+  // The MDStrings are only created when they are referenced. Until then the
+  // strings point into the blob, which is part of the bitcode buffer and
+  // lives as long as the reader.
+  std::vector<StringRef> LazyStrings;
+  LazyStrings.reserve(NumStrings);
   StringRef Strings = Blob.drop_front(StringsOffset);
   do {
     if (R.AtEndOfStream())
@@ -1197,11 +1538,13 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadataStrings(
     if (Strings.size() < Size)
       return error("Invalid record: metadata strings truncated chars");
 
-    MetadataList.assignValue(MDString::get(Context, Strings.slice(0, Size)),
-                             NextMetadataNo++);
+    LazyStrings.push_back(Strings.slice(0, Size));
     Strings = Strings.drop_front(Size);
   } while (--NumStrings);
 
+  unsigned Begin = NextMetadataNo;
+  NextMetadataNo += LazyStrings.size();
+  MetadataList.addLazyStrings(Begin, std::move(LazyStrings));
   return Error::success();
 }
 
@@ -1212,7 +1555,7 @@ Error MetadataLoader::MetadataLoaderImpl::parseGlobalObjectAttachment(
     auto K = MDKindMap.find(Record[I]);
     if (K == MDKindMap.end())
       return error("Invalid ID");
-    MDNode *MD = MetadataList.getMDNodeFwdRefOrNull(Record[I + 1]);
+    MDNode *MD = getMDNodeFwdRefOrNull(Record[I + 1]);
     if (!MD)
       return error("Invalid metadata attachment");
     GO.addMetadata(K->second, *MD);
@@ -1268,7 +1611,7 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadataAttachment(
         if (I->second == LLVMContext::MD_tbaa && StripTBAA)
           continue;
 
-        Metadata *Node = MetadataList.getMetadataFwdRef(Record[i + 1]);
+        Metadata *Node = getMetadataFwdRefOrLoad(Record[i + 1]);
         if (isa<LocalAsMetadata>(Node))
           // Drop the attachment.  This used to be legal, but there's no
           // upgrade path.
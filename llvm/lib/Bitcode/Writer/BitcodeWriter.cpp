@@ -28,15 +28,27 @@
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/UseListOrder.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/SHA1.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cctype>
 #include <map>
 using namespace llvm;
 
+static cl::opt<unsigned> BitcodeWriterThreads(
+    "bitcode-writer-threads", cl::init(1), cl::Hidden,
+    cl::desc("Number of threads writing the function blocks of a module"));
+
+static cl::opt<unsigned> IndexThreshold(
+    "bitcode-mdindex-threshold", cl::init(25), cl::Hidden,
+    cl::desc("Number of module-level metadata records above which an index "
+             "of their positions is emitted, so that the reader can load "
+             "them on demand"));
+
 namespace {
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
@@ -114,6 +126,14 @@ class ModuleBitcodeWriter : public BitcodeWriterBase {
   /// Tracks the last value id recorded in the GUIDToValueMap.
   unsigned GlobalValueId;
 
+  /// Indices of the metadata abbreviations that are emitted ahead of the
+  /// module-level metadata records when they are indexed.
+  enum MetadataAbbrev : unsigned {
+    DILocationAbbrevID,
+    GenericDINodeAbbrevID,
+    LastPlusOne
+  };
+
 public:
   /// Constructs a ModuleBitcodeWriter object for the given Module,
   /// writing to the provided \p Buffer.
@@ -148,6 +168,14 @@ public:
   void write();
 
 private:
+  /// Constructs a ModuleBitcodeWriter which writes the function blocks of the
+  /// module of \p Parent to \p Stream, with a copy of its ValueEnumerator.
+  ModuleBitcodeWriter(const ModuleBitcodeWriter &Parent,
+                      SmallVectorImpl<char> &Buffer, BitstreamWriter &Stream)
+      : BitcodeWriterBase(Stream), Buffer(Buffer), M(Parent.M), VE(Parent.VE),
+        Index(nullptr), GenerateHash(false), BitcodeStartBit(0),
+        GlobalValueId(Parent.GlobalValueId) {}
+
   uint64_t bitcodeStartBit() { return BitcodeStartBit; }
 
   void writeAttributeGroupTable();
@@ -224,7 +252,9 @@ private:
   void writeMetadataStrings(ArrayRef<const Metadata *> Strings,
                             SmallVectorImpl<uint64_t> &Record);
   void writeMetadataRecords(ArrayRef<const Metadata *> MDs,
-                            SmallVectorImpl<uint64_t> &Record);
+                            SmallVectorImpl<uint64_t> &Record,
+                            std::vector<unsigned> *MDAbbrevs = nullptr,
+                            std::vector<uint64_t> *IndexPos = nullptr);
   void writeModuleMetadata();
   void writeFunctionMetadata(const Function &F);
   void writeFunctionMetadataAttachment(const Function &F);
@@ -249,9 +279,9 @@ private:
       DenseMap<const Function *, uint64_t> *FunctionToBitcodeIndex = nullptr);
   void writeUseList(UseListOrder &&Order);
   void writeUseListBlock(const Function *F);
+  void writeFunction(const Function &F);
   void
-  writeFunction(const Function &F,
-                DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
+  writeFunctions(DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
   void writeBlockInfo();
   void writePerModuleFunctionSummaryRecord(SmallVector<uint64_t, 64> &NameVals,
                                            GlobalValueSummary *Summary,
@@ -1855,7 +1885,8 @@ void ModuleBitcodeWriter::writeMetadataStrings(
 }
 
 void ModuleBitcodeWriter::writeMetadataRecords(
-    ArrayRef<const Metadata *> MDs, SmallVectorImpl<uint64_t> &Record) {
+    ArrayRef<const Metadata *> MDs, SmallVectorImpl<uint64_t> &Record,
+    std::vector<unsigned> *MDAbbrevs, std::vector<uint64_t> *IndexPos) {
   if (MDs.empty())
     return;
 
@@ -1863,7 +1894,14 @@ void ModuleBitcodeWriter::writeMetadataRecords(
 #define HANDLE_MDNODE_LEAF(CLASS) unsigned CLASS##Abbrev = 0;
 #include "llvm/IR/Metadata.def"
 
+  if (MDAbbrevs) {
+    DILocationAbbrev = (*MDAbbrevs)[MetadataAbbrev::DILocationAbbrevID];
+    GenericDINodeAbbrev = (*MDAbbrevs)[MetadataAbbrev::GenericDINodeAbbrevID];
+  }
+
   for (const Metadata *MD : MDs) {
+    if (IndexPos)
+      IndexPos->push_back(Stream.GetCurrentBitNo());
     if (const MDNode *N = dyn_cast<MDNode>(MD)) {
       assert(N->isResolved() && "Expected forward references to be resolved");
 
@@ -1885,10 +1923,62 @@ void ModuleBitcodeWriter::writeModuleMetadata() {
   if (!VE.hasMDs() && M.named_metadata_empty())
     return;
 
-  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 4);
   SmallVector<uint64_t, 64> Record;
   writeMetadataStrings(VE.getMDStrings(), Record);
-  writeMetadataRecords(VE.getNonMDStrings(), Record);
+
+  // When there are enough records, emit the position of each of them so that
+  // a reader that needs only some of them (e.g. when importing functions) can
+  // load them on demand. The index follows the records, and the
+  // METADATA_INDEX_OFFSET record in front of them holds the distance to it so
+  // that the reader can skip the records.
+  ArrayRef<const Metadata *> MDs = VE.getNonMDStrings();
+  if (MDs.size() <= IndexThreshold) {
+    writeMetadataRecords(MDs, Record);
+  } else {
+    // A reader using the index jumps over the records, so it only knows about
+    // the abbreviations that are defined before them.
+    std::vector<unsigned> MDAbbrevs(MetadataAbbrev::LastPlusOne);
+    MDAbbrevs[MetadataAbbrev::DILocationAbbrevID] = createDILocationAbbrev();
+    MDAbbrevs[MetadataAbbrev::GenericDINodeAbbrevID] =
+        createGenericDINodeAbbrev();
+
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_INDEX_OFFSET));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    unsigned OffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+    // The offset is backpatched once the index is written. It is emitted as
+    // two fixed 32-bit fields at the end of the record.
+    uint64_t Vals[] = {0, 0};
+    Stream.EmitRecord(bitc::METADATA_INDEX_OFFSET, Vals, OffsetAbbrev);
+    uint64_t IndexOffsetRecordBitPos = Stream.GetCurrentBitNo();
+
+    std::vector<uint64_t> IndexPos;
+    IndexPos.reserve(MDs.size());
+    writeMetadataRecords(MDs, Record, &MDAbbrevs, &IndexPos);
+
+    uint64_t Offset = Stream.GetCurrentBitNo() - IndexOffsetRecordBitPos;
+    Stream.BackpatchWord(IndexOffsetRecordBitPos - 64, uint32_t(Offset));
+    Stream.BackpatchWord(IndexOffsetRecordBitPos - 32, Offset >> 32);
+
+    // Delta encode the positions, starting from the end of the offset record.
+    uint64_t PreviousPos = IndexOffsetRecordBitPos;
+    for (uint64_t &Pos : IndexPos) {
+      uint64_t Delta = Pos - PreviousPos;
+      PreviousPos = Pos;
+      Pos = Delta;
+    }
+
+    Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_INDEX));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+    Stream.EmitRecord(bitc::METADATA_INDEX, IndexPos,
+                      Stream.EmitAbbrev(Abbv));
+  }
+
   writeNamedMetadata(Record);
 
   auto AddDeclAttachedMetadata = [&](const GlobalObject &GO) {
@@ -2948,13 +3038,7 @@ void ModuleBitcodeWriter::writeUseListBlock(const Function *F) {
 }
 
 /// Emit a function body to the module stream.
-void ModuleBitcodeWriter::writeFunction(
-    const Function &F,
-    DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex) {
-  // Save the bitcode index of the start of this function block for recording
-  // in the VST.
-  FunctionToBitcodeIndex[&F] = Stream.GetCurrentBitNo();
-
+void ModuleBitcodeWriter::writeFunction(const Function &F) {
   Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
   VE.incorporateFunction(F);
 
@@ -3025,6 +3109,74 @@ void ModuleBitcodeWriter::writeFunction(
   Stream.ExitBlock();
 }
 
+/// Emit the bodies of the functions, recording the bit offset of each one in
+/// \p FunctionToBitcodeIndex for the VST.
+///
+/// With -bitcode-writer-threads=N, the functions are split in up to N
+/// contiguous slices. The blocks of each slice are written concurrently to a
+/// private buffer, with a private copy of the ValueEnumerator, then the
+/// buffers are appended to the module stream in order. A block that starts
+/// at a word boundary doesn't depend on the bits before it, so the output is
+/// identical to the serial one.
+void ModuleBitcodeWriter::writeFunctions(
+    DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex) {
+  std::vector<const Function *> Functions;
+  for (const Function &F : M)
+    if (!F.isDeclaration())
+      Functions.push_back(&F);
+
+  size_t NumSlices =
+      std::min<size_t>(BitcodeWriterThreads, Functions.size());
+  // The use-list orders of all the functions are kept in a single stack,
+  // which is consumed in function order.
+  if (NumSlices <= 1 || VE.shouldPreserveUseListOrder() ||
+      (Stream.GetCurrentBitNo() & 31) != 0) {
+    for (const Function *F : Functions) {
+      // Save the bitcode index of the start of this function block for
+      // recording in the VST.
+      FunctionToBitcodeIndex[F] = Stream.GetCurrentBitNo();
+      writeFunction(*F);
+    }
+    return;
+  }
+
+  struct Slice {
+    SmallVector<char, 0> Buffer;
+    /// The offsets of the function blocks in Buffer, followed by the offset of
+    /// the end of the last one.
+    std::vector<size_t> Offsets;
+  };
+  std::vector<Slice> Slices(NumSlices);
+  parallelFor(NumSlices, 0, NumSlices, [&](size_t I) {
+    Slice &S = Slices[I];
+    BitstreamWriter SliceStream(S.Buffer);
+    // Mirror the state of the module stream: the abbreviation width of the
+    // module block and the abbreviations of the BLOCKINFO block. These bits
+    // are not copied to the module stream.
+    SliceStream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
+    ModuleBitcodeWriter SliceWriter(*this, S.Buffer, SliceStream);
+    SliceWriter.writeBlockInfo();
+
+    for (size_t F = Functions.size() * I / NumSlices,
+                E = Functions.size() * (I + 1) / NumSlices;
+         F != E; ++F) {
+      S.Offsets.push_back(S.Buffer.size());
+      SliceWriter.writeFunction(*Functions[F]);
+    }
+    S.Offsets.push_back(S.Buffer.size());
+    SliceStream.ExitBlock();
+  });
+
+  auto FI = Functions.begin();
+  for (const Slice &S : Slices) {
+    for (size_t J = 0, E = S.Offsets.size() - 1; J != E; ++J)
+      FunctionToBitcodeIndex[*FI++] =
+          Stream.GetCurrentBitNo() + (S.Offsets[J] - S.Offsets[0]) * 8;
+    Stream.AppendWords(makeArrayRef(S.Buffer.data() + S.Offsets.front(),
+                                    S.Buffer.data() + S.Offsets.back()));
+  }
+}
+
 // Emit blockinfo, which defines the standard abbreviations etc.
 void ModuleBitcodeWriter::writeBlockInfo() {
   // We only want to emit block info records for blocks that have multiple
@@ -3694,9 +3846,7 @@ void ModuleBitcodeWriter::write() {
 
   // Emit function bodies.
   DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
-  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
-    if (!F->isDeclaration())
-      writeFunction(*F, FunctionToBitcodeIndex);
+  writeFunctions(FunctionToBitcodeIndex);
 
   // Need to write after the above call to WriteFunction which populates
   // the summary information in the index.
@@ -118,23 +118,26 @@ DIEAbbrevSet::~DIEAbbrevSet() {
 }
 
 DIEAbbrev &DIEAbbrevSet::uniqueAbbreviation(DIE &Die) {
+  DIEAbbrev &Abbrev = uniqueAbbreviation(Die.generateAbbrev());
+  Die.setAbbrevNumber(Abbrev.getNumber());
+  return Abbrev;
+}
 
+DIEAbbrev &DIEAbbrevSet::uniqueAbbreviation(const DIEAbbrev &Abbrev) {
   FoldingSetNodeID ID;
-  DIEAbbrev Abbrev = Die.generateAbbrev();
   Abbrev.Profile(ID);
 
   void *InsertPos;
   if (DIEAbbrev *Existing =
-          AbbreviationsSet.FindNodeOrInsertPos(ID, InsertPos)) {
-    Die.setAbbrevNumber(Existing->getNumber());
+          AbbreviationsSet.FindNodeOrInsertPos(ID, InsertPos))
     return *Existing;
-  }
 
-  // Move the abbreviation to the heap and assign a number.
-  DIEAbbrev *New = new (Alloc) DIEAbbrev(std::move(Abbrev));
+  // Copy the abbreviation to the heap and assign a number.
+  DIEAbbrev *New = new (Alloc) DIEAbbrev(Abbrev.getTag(), Abbrev.hasChildren());
+  for (const DIEAbbrevData &Data : Abbrev.getData())
+    New->AddAttribute(Data.getAttribute(), Data.getForm());
   Abbreviations.push_back(New);
   New->setNumber(Abbreviations.size());
-  Die.setAbbrevNumber(Abbreviations.size());
 
   // Store it for lookup.
   AbbreviationsSet.InsertNode(New, InsertPos);
@@ -45,6 +45,7 @@
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetFrameLowering.h"
@@ -580,21 +581,45 @@ void DwarfDebug::finalizeModuleInfo() {
 
   finishVariableDefinitions();
 
+  // The units are hashed and laid out on the threads of one pool, if any.
+  std::unique_ptr<ThreadPool> LayoutPool = DwarfFile::createLayoutPool();
+
+  // Emit DW_AT_containing_type attribute to connect types with their
+  // vtable holding type. If we're splitting the dwarf out now that we've got
+  // the entire CU, compute a unique identifier for it.
+  SmallVector<uint64_t, 4> DWOIds(CUMap.size());
+  if (!LayoutPool) {
+    for (unsigned I = 0, E = CUMap.size(); I != E; ++I) {
+      DwarfCompileUnit &TheCU = *CUMap.begin()[I].second;
+      TheCU.constructContainingTypeDIEs();
+      if (useSplitDwarf())
+        DWOIds[I] = DIEHash(Asm).computeCUSignature(TheCU.getUnitDie());
+    }
+  } else {
+    // Hashing only reads the DIEs, so the CUs are hashed concurrently once the
+    // attributes of all the CUs are added. Under LTO a CU can add one to a DIE
+    // of another CU, which then contributes to its hash even if it comes
+    // earlier, so the DWO IDs can differ from the ones computed serially.
+    for (const auto &P : CUMap)
+      P.second->constructContainingTypeDIEs();
+    if (useSplitDwarf())
+      parallelFor(LayoutPool.get(), 0, CUMap.size(), [&](size_t I) {
+        DwarfCompileUnit &TheCU = *CUMap.begin()[I].second;
+        DWOIds[I] = DIEHash(Asm).computeCUSignature(TheCU.getUnitDie());
+      });
+  }
+
   // Handle anything that needs to be done on a per-unit basis after
   // all other generation.
-  for (const auto &P : CUMap) {
+  for (unsigned I = 0, E = CUMap.size(); I != E; ++I) {
+    const auto &P = CUMap.begin()[I];
     auto &TheCU = *P.second;
-    // Emit DW_AT_containing_type attribute to connect types with their
-    // vtable holding type.
-    TheCU.constructContainingTypeDIEs();
 
     // Add CU specific attributes if we need to add any.
-    // If we're splitting the dwarf out now that we've got the entire
-    // CU then add the dwo id to it.
     auto *SkCU = TheCU.getSkeleton();
     if (useSplitDwarf()) {
       // Emit a unique identifier for this CU.
-      uint64_t ID = DIEHash(Asm).computeCUSignature(TheCU.getUnitDie());
+      uint64_t ID = DWOIds[I];
       TheCU.addUInt(TheCU.getUnitDie(), dwarf::DW_AT_GNU_dwo_id,
                     dwarf::DW_FORM_data8, ID);
       SkCU->addUInt(SkCU->getUnitDie(), dwarf::DW_AT_GNU_dwo_id,
@@ -642,9 +667,9 @@ void DwarfDebug::finalizeModuleInfo() {
   }
 
   // Compute DIE offsets and sizes.
-  InfoHolder.computeSizeAndOffsets();
+  InfoHolder.computeSizeAndOffsets(LayoutPool.get());
   if (useSplitDwarf())
-    SkeletonHolder.computeSizeAndOffsets();
+    SkeletonHolder.computeSizeAndOffsets(LayoutPool.get());
 }
 
 // Emit all Dwarf sections that should come after the content.
@@ -14,10 +14,17 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/MC/MCStreamer.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/LEB128.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetLoweringObjectFile.h"
 
 namespace llvm {
+static cl::opt<unsigned> LayoutThreads(
+    "dwarf-layout-threads", cl::Hidden, cl::init(1),
+    cl::desc("Number of threads computing the DWO IDs and the size and "
+             "offset of the DIEs of the units"));
+
 DwarfFile::DwarfFile(AsmPrinter *AP, StringRef Pref, BumpPtrAllocator &DA)
     : Asm(AP), Abbrevs(AbbrevAllocator), StrPool(DA, *Asm, Pref) {}
 
@@ -42,8 +49,43 @@ void DwarfFile::emitUnit(DwarfUnit *TheU, bool UseOffsets) {
   Asm->emitDwarfDIE(Die);
 }
 
+// Give each DIE of the tree rooted at Die its abbreviation number in Abbrevs.
+static void uniqueAbbreviations(DIE &Die, DIEAbbrevSet &Abbrevs) {
+  Abbrevs.uniqueAbbreviation(Die);
+  for (auto &Child : Die.children())
+    uniqueAbbreviations(Child, Abbrevs);
+}
+
+// Compute the size and offset of the DIEs of the tree rooted at Die, which were
+// numbered by a unit local set of abbreviations, and renumber them with Remap.
+// This is DIE::computeOffsetsAndAbbrevs once the abbreviations are uniqued.
+static unsigned computeOffsets(const AsmPrinter *AP, DIE &Die,
+                               ArrayRef<unsigned> Remap, unsigned CUOffset) {
+  Die.setAbbrevNumber(Remap[Die.getAbbrevNumber()]);
+  Die.setOffset(CUOffset);
+  CUOffset += getULEB128Size(Die.getAbbrevNumber());
+  for (const auto &V : Die.values())
+    CUOffset += V.SizeOf(AP);
+  if (Die.hasChildren()) {
+    for (auto &Child : Die.children())
+      CUOffset = computeOffsets(AP, Child, Remap, CUOffset);
+    CUOffset += sizeof(int8_t);
+  }
+  Die.setSize(CUOffset - Die.getOffset());
+  return CUOffset;
+}
+
+std::unique_ptr<ThreadPool> DwarfFile::createLayoutPool() {
+  if (LayoutThreads <= 1)
+    return nullptr;
+  return make_unique<ThreadPool>(LayoutThreads - 1);
+}
+
 // Compute the size and offset for each DIE.
-void DwarfFile::computeSizeAndOffsets() {
+void DwarfFile::computeSizeAndOffsets(ThreadPool *Pool) {
+  if (Pool && CUs.size() > 1)
+    return computeSizeAndOffsetsInParallel(*Pool);
+
   // Offset from the first CU in the debug info section is 0 initially.
   unsigned SecOffset = 0;
 
@@ -55,6 +97,49 @@ void DwarfFile::computeSizeAndOffsets() {
   }
 }
 
+// The abbreviation numbers are assigned in the order of the first use of the
+// abbreviations, which is sequential. The units are given their own set of
+// abbreviations to unique their DIEs concurrently, then the sets are merged in
+// the order of the units, which assigns the numbers a sequential walk would.
+// The sizes and offsets depend on the size of the abbreviation numbers, and
+// are computed concurrently once they are known.
+void DwarfFile::computeSizeAndOffsetsInParallel(ThreadPool &Pool) {
+  struct UnitLayout {
+    BumpPtrAllocator Alloc;
+    DIEAbbrevSet Abbrevs{Alloc};
+    std::vector<unsigned> Remap;
+    unsigned Size;
+  };
+  std::vector<std::unique_ptr<UnitLayout>> Layouts;
+  for (unsigned I = 0, E = CUs.size(); I != E; ++I)
+    Layouts.push_back(make_unique<UnitLayout>());
+
+  parallelFor(&Pool, 0, CUs.size(), [&](size_t I) {
+    uniqueAbbreviations(CUs[I]->getUnitDie(), Layouts[I]->Abbrevs);
+  });
+
+  for (auto &Layout : Layouts) {
+    ArrayRef<DIEAbbrev *> Local = Layout->Abbrevs.getAbbreviations();
+    // Abbreviation numbers start at 1.
+    Layout->Remap.resize(Local.size() + 1);
+    for (DIEAbbrev *Abbrev : Local)
+      Layout->Remap[Abbrev->getNumber()] =
+          Abbrevs.uniqueAbbreviation(*Abbrev).getNumber();
+  }
+
+  parallelFor(&Pool, 0, CUs.size(), [&](size_t I) {
+    unsigned Offset = sizeof(int32_t) + CUs[I]->getHeaderSize();
+    Layouts[I]->Size =
+        computeOffsets(Asm, CUs[I]->getUnitDie(), Layouts[I]->Remap, Offset);
+  });
+
+  unsigned SecOffset = 0;
+  for (unsigned I = 0, E = CUs.size(); I != E; ++I) {
+    CUs[I]->setDebugSectionOffset(SecOffset);
+    SecOffset += Layouts[I]->Size;
+  }
+}
+
 unsigned DwarfFile::computeSizeAndOffsetsForUnit(DwarfUnit *TheU) {
   // CU-relative offset is reset to 0 here.
   unsigned Offset = sizeof(int32_t) +      // Length of Unit Info
@@ -34,6 +34,7 @@ class StringRef;
 class DwarfDebug;
 class MCSection;
 class MDNode;
+class ThreadPool;
 class DwarfFile {
   // Target of Dwarf emission, used for sizing of abbreviations.
   AsmPrinter *Asm;
@@ -59,6 +60,10 @@ class DwarfFile {
   /// of in DwarfCompileUnit.
   DenseMap<const MDNode *, DIE *> DITypeNodeToDieMap;
 
+  /// \brief Compute the size and offset of all the DIEs, with the units laid
+  /// out concurrently.
+  void computeSizeAndOffsetsInParallel(ThreadPool &Pool);
+
 public:
   DwarfFile(AsmPrinter *AP, StringRef Pref, BumpPtrAllocator &DA);
 
@@ -69,8 +74,14 @@ public:
   /// \brief Compute the size and offset of a DIE given an incoming Offset.
   unsigned computeSizeAndOffset(DIE &Die, unsigned Offset);
 
-  /// \brief Compute the size and offset of all the DIEs.
-  void computeSizeAndOffsets();
+  /// \brief Compute the size and offset of all the DIEs, on the threads of
+  /// \p Pool and the calling thread if \p Pool isn't null.
+  void computeSizeAndOffsets(ThreadPool *Pool);
+
+  /// \brief Create the threads to work on the units with, on top of the
+  /// calling thread, as given by -dwarf-layout-threads. Returns null if the
+  /// units are processed serially.
+  static std::unique_ptr<ThreadPool> createLayoutPool();
 
   /// \brief Compute the size and offset of all the DIEs in the given unit.
   /// \returns The size of the root DIE.
@@ -87,12 +87,6 @@ protected:
   /// information entries.
   DenseMap<const MDNode *, DIE *> MDNodeToDieMap;
 
-  /// A list of all the DIEBlocks in use.
-  std::vector<DIEBlock *> DIEBlocks;
-
-  /// A list of all the DIELocs in use.
-  std::vector<DIELoc *> DIELocs;
-
   /// This map is used to keep track of subprogram DIEs that need
   /// DW_AT_containing_type attribute. This attribute points to a DIE that
   /// corresponds to the MDNode mapped with the subprogram DIE.
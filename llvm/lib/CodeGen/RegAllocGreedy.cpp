@@ -36,6 +36,8 @@
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/CodeGen/RegisterClassInfo.h"
 #include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/PassAnalysisSupport.h"
 #include "llvm/Support/BranchProbability.h"
@@ -55,6 +57,7 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumOverBudget,   "Number of functions allocated over budget");
 
 static cl::opt<SplitEditor::ComplementSpillMode> SplitSpillMode(
     "split-spill-mode", cl::Hidden,
@@ -100,6 +103,13 @@ CSRFirstTimeCost("regalloc-csr-first-time-cost",
               cl::desc("Cost for first time use of callee-saved register."),
               cl::init(0), cl::Hidden);
 
+static cl::opt<unsigned> WorkBudget(
+    "regalloc-greedy-budget", cl::Hidden,
+    cl::desc("Number of work units the greedy register allocator may spend "
+             "on a function before it stops splitting live ranges and spills "
+             "them instead (0 = unlimited)"),
+    cl::init(0));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -187,11 +197,23 @@ class RAGreedy : public MachineFunctionPass,
     CO_Depth = 1,
 
     // lcr-max-interf cutoff encountered
-    CO_Interf = 2
+    CO_Interf = 2,
+
+    // regalloc-greedy-budget exceeded before recoloring
+    CO_Budget = 4
   };
 
   uint8_t CutOffInfo;
 
+  // The work done on the current function, counted in interference queries
+  // and blocks visited by the eviction, splitting and recoloring searches.
+  uint64_t WorkUnits;
+
+  // Set once WorkUnits exceeds -regalloc-greedy-budget. The live ranges which
+  // can't be assigned are then evicted or spilled like in the basic
+  // allocator, and never split nor recolored.
+  bool OverBudget;
+
 #ifndef NDEBUG
   static const char *const StageName[];
 #endif
@@ -419,6 +441,10 @@ private:
   void collectHintInfo(unsigned, HintsInfo &);
 
   bool isUnusedCalleeSavedReg(unsigned PhysReg) const;
+
+  /// Adds \p Units to the work done on the current function. Returns true if
+  /// the function is over budget.
+  bool chargeWork(uint64_t Units);
 };
 } // end anonymous namespace
 
@@ -871,6 +897,7 @@ unsigned RAGreedy::tryEvict(LiveInterval &VirtReg,
                             unsigned CostPerUseLimit) {
   NamedRegionTimer T("evict", "Evict", TimerGroupName, TimerGroupDescription,
                      TimePassesIsEnabled);
+  chargeWork(Order.getOrder().size());
 
   // Keep track of the cheapest interference seen so far.
   EvictionCost BestCost;
@@ -1384,6 +1411,10 @@ unsigned RAGreedy::tryRegionSplit(LiveInterval &VirtReg, AllocationOrder &Order,
       calculateRegionSplitCost(VirtReg, Order, BestCost, NumCands,
                                false/*IgnoreCSR*/);
 
+  // The search went over budget and was cut short. Don't split at all.
+  if (OverBudget)
+    return 0;
+
   // No solutions found, fall back to single block splitting.
   if (!HasCompact && BestCand == NoCand)
     return 0;
@@ -1401,6 +1432,9 @@ unsigned RAGreedy::calculateRegionSplitCost(LiveInterval &VirtReg,
   while (unsigned PhysReg = Order.next()) {
     if (IgnoreCSR && isUnusedCalleeSavedReg(PhysReg))
       continue;
+    // Over budget, give up the search; the live range will be spilled.
+    if (chargeWork(SA->getUseBlocks().size() + SA->getNumThroughBlocks()))
+      return NoCand;
 
     // Discard bad candidates before we run out of interference cache cursors.
     // This will only affect register classes with a lot of registers (>32).
@@ -1819,6 +1853,9 @@ unsigned RAGreedy::tryLocalSplit(LiveInterval &VirtReg, AllocationOrder &Order,
 
   Order.rewind();
   while (unsigned PhysReg = Order.next()) {
+    if (chargeWork(NumGaps))
+      return 0;
+
     // Keep track of the largest spill weight that would need to be evicted in
     // order to make use of PhysReg between UseSlots[i] and UseSlots[i+1].
     calcGapWeights(PhysReg, GapWeight);
@@ -1972,7 +2009,7 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
                        TimerGroupDescription, TimePassesIsEnabled);
     SA->analyze(&VirtReg);
     unsigned PhysReg = tryLocalSplit(VirtReg, Order, NewVRegs);
-    if (PhysReg || !NewVRegs.empty())
+    if (PhysReg || !NewVRegs.empty() || OverBudget)
       return PhysReg;
     return tryInstructionSplit(VirtReg, Order, NewVRegs);
   }
@@ -1998,7 +2035,7 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
   // straight to single block splitting.
   if (getStage(VirtReg) < RS_Split2) {
     unsigned PhysReg = tryRegionSplit(VirtReg, Order, NewVRegs);
-    if (PhysReg || !NewVRegs.empty())
+    if (PhysReg || !NewVRegs.empty() || OverBudget)
       return PhysReg;
   }
 
@@ -2107,6 +2144,14 @@ unsigned RAGreedy::tryLastChanceRecoloring(LiveInterval &VirtReg,
     CutOffInfo |= CO_Depth;
     return ~0u;
   }
+  // Over budget, give up rather than start a search which is exponential in
+  // the depth. This also unwinds a search that went over budget.
+  if (OverBudget) {
+    DEBUG(dbgs() << "Abort because the budget has been exceeded.\n");
+    CutOffInfo |= CO_Budget;
+    return ~0u;
+  }
+  chargeWork(Order.getOrder().size());
 
   // Set of Live intervals that will need to be recolored.
   SmallLISet RecoloringCandidates;
@@ -2252,6 +2297,30 @@ bool RAGreedy::tryRecoloringCandidates(PQueue &RecoloringQueue,
   return true;
 }
 
+//===----------------------------------------------------------------------===//
+//                            Compile-Time Budget
+//===----------------------------------------------------------------------===//
+
+bool RAGreedy::chargeWork(uint64_t Units) {
+  WorkUnits += Units;
+  if (OverBudget || !WorkBudget || WorkUnits <= WorkBudget)
+    return OverBudget;
+
+  OverBudget = true;
+  ++NumOverBudget;
+  DEBUG(dbgs() << "Over the budget of " << WorkBudget << " work units\n");
+  const Function &F = *MF->getFunction();
+  DebugLoc Loc;
+  if (DISubprogram *SP = F.getSubprogram())
+    Loc = DebugLoc::get(SP->getScopeLine(), 0, SP);
+  emitOptimizationRemarkMissed(
+      F.getContext(), DEBUG_TYPE, F, Loc,
+      "register allocation of " + F.getName() + " exceeded its budget of " +
+          Twine(WorkBudget) + " work units; the remaining live ranges are "
+          "spilled instead of split");
+  return true;
+}
+
 //===----------------------------------------------------------------------===//
 //                            Main Entry Point
 //===----------------------------------------------------------------------===//
@@ -2264,7 +2333,11 @@ unsigned RAGreedy::selectOrSplit(LiveInterval &VirtReg,
   unsigned Reg = selectOrSplitImpl(VirtReg, NewVRegs, FixedRegisters);
   if (Reg == ~0U && (CutOffInfo != CO_None)) {
     uint8_t CutOffEncountered = CutOffInfo & (CO_Depth | CO_Interf);
-    if (CutOffEncountered == CO_Depth)
+    if (CutOffInfo & CO_Budget)
+      Ctx.emitError("register allocation failed: the budget of the function "
+                    "was exceeded before recoloring. Raise "
+                    "-regalloc-greedy-budget to recolor");
+    else if (CutOffEncountered == CO_Depth)
       Ctx.emitError("register allocation failed: maximum depth for recoloring "
                     "reached. Use -fexhaustive-register-search to skip "
                     "cutoffs");
@@ -2562,6 +2635,14 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
 
   assert((NewVRegs.empty() || Depth) && "Cannot append to existing NewVRegs");
 
+  // Over budget, don't wait for a better picture of the interference nor try
+  // to split: go straight to spilling.
+  if (OverBudget && Stage < RS_Spill) {
+    DEBUG(dbgs() << "over budget, not splitting\n");
+    Stage = RS_Spill;
+    setStage(VirtReg, Stage);
+  }
+
   // The first time we see a live range, don't try to split or spill.
   // Wait until the second time, when all smaller ranges have been allocated.
   // This gives a better picture of the interference to split around.
@@ -2655,8 +2736,13 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   GlobalCand.resize(32);  // This will grow as needed.
   SetOfBrokenHints.clear();
 
+  WorkUnits = 0;
+  OverBudget = false;
+
   allocatePhysRegs();
-  tryHintsRecoloring();
+  // Recoloring the broken hints is an optimization, skip it over budget.
+  if (!OverBudget)
+    tryHintsRecoloring();
   postOptimization();
 
   releaseMemory();
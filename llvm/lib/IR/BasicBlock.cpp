@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/BasicBlock.h"
+#include "LLVMContextImpl.h"
 #include "SymbolTableListTraitsImpl.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/CFG.h"
@@ -61,6 +62,17 @@ void BasicBlock::insertInto(Function *NewParent, BasicBlock *InsertBefore) {
     NewParent->getBasicBlockList().push_back(this);
 }
 
+void *BasicBlock::operator new(size_t Size) {
+  bool FromArena;
+  void *Storage = allocateIRStorage(Size, FromArena);
+  static_cast<BasicBlock *>(Storage)->IsArenaAllocated = FromArena;
+  return Storage;
+}
+
+void BasicBlock::operator delete(void *Ptr) {
+  deallocateIRStorage(Ptr, static_cast<BasicBlock *>(Ptr)->IsArenaAllocated);
+}
+
 BasicBlock::~BasicBlock() {
   // If the address of the block is taken and it is being deleted (e.g. because
   // it is dead), this means that there is either a dangling constant expr
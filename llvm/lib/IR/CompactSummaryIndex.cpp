@@ -0,0 +1,432 @@
+//===-- CompactSummaryIndex.cpp - Flat summary index format ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the reader and the writer of the compact summary index
+// format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/CompactSummaryIndex.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+
+static Error createError(const Twine &Msg) {
+  return make_error<StringError>("compact summary index: " + Msg,
+                                 inconvertibleErrorCode());
+}
+
+namespace {
+// Carves the arrays of an index out of its buffer, in file order.
+class ArrayReader {
+public:
+  ArrayReader(StringRef Data, uint64_t Offset) : Data(Data), Offset(Offset) {}
+
+  template <typename T> Error read(ArrayRef<T> &Array, uint64_t Count) {
+    static_assert(alignof(T) == 1, "arrays are used in place");
+    Offset = alignTo(Offset, 8);
+    uint64_t Size = Count * sizeof(T);
+    if (Offset > Data.size() || Size > Data.size() - Offset)
+      return createError("file is truncated");
+    Array = makeArrayRef(reinterpret_cast<const T *>(Data.data() + Offset),
+                         Count);
+    Offset += Size;
+    return Error::success();
+  }
+
+  Error read(StringRef &Str, uint64_t Size) {
+    ArrayRef<char> Chars;
+    if (Error E = read(Chars, Size))
+      return E;
+    Str = StringRef(Chars.data(), Chars.size());
+    return Error::success();
+  }
+
+private:
+  StringRef Data;
+  uint64_t Offset;
+};
+} // end anonymous namespace
+
+bool CompactSummaryIndex::isCompactSummaryIndex(MemoryBufferRef Buffer) {
+  return Buffer.getBufferSize() >= sizeof(csi::Magic) &&
+         memcmp(Buffer.getBufferStart(), csi::Magic, sizeof(csi::Magic)) == 0;
+}
+
+Expected<CompactSummaryIndex>
+CompactSummaryIndex::create(MemoryBufferRef Buffer) {
+  if (!isCompactSummaryIndex(Buffer))
+    return createError("invalid magic");
+  if (Buffer.getBufferSize() < sizeof(csi::Header))
+    return createError("file is truncated");
+  auto *H = reinterpret_cast<const csi::Header *>(Buffer.getBufferStart());
+  if (H->Version != csi::Version)
+    return createError("unsupported version " + Twine(H->Version));
+
+  CompactSummaryIndex Index;
+  ArrayReader R(Buffer.getBuffer(), sizeof(csi::Header));
+  uint64_t NumSummaries = H->NumSummaries;
+  if (Error E = R.read(Index.Modules, H->NumModules))
+    return std::move(E);
+  if (Error E = R.read(Index.GUIDs, H->NumGUIDs))
+    return std::move(E);
+  if (Error E = R.read(Index.SummaryBegin, H->NumGUIDs + 1ULL))
+    return std::move(E);
+  if (Error E = R.read(Index.Summaries, NumSummaries))
+    return std::move(E);
+  if (Error E = R.read(Index.ModuleSummaryBegin, H->NumModules + 1ULL))
+    return std::move(E);
+  if (Error E = R.read(Index.ModuleSummaries, NumSummaries))
+    return std::move(E);
+  if (Error E = R.read(Index.CallBegin, NumSummaries + 1))
+    return std::move(E);
+  if (Error E = R.read(Index.Calls, H->NumCalls))
+    return std::move(E);
+  if (Error E = R.read(Index.RefBegin, NumSummaries + 1))
+    return std::move(E);
+  if (Error E = R.read(Index.Refs, H->NumRefs))
+    return std::move(E);
+  if (Error E = R.read(Index.TypeTestBegin, NumSummaries + 1))
+    return std::move(E);
+  if (Error E = R.read(Index.TypeTests, H->NumTypeTests))
+    return std::move(E);
+  if (Error E = R.read(Index.StringTable, H->StringTableSize))
+    return std::move(E);
+
+  // The last offset of each offset array is the size of the array it indexes.
+  // Checking them is cheap and catches most inconsistent headers.
+  if (Index.SummaryBegin.back() != NumSummaries ||
+      Index.ModuleSummaryBegin.back() != NumSummaries ||
+      Index.CallBegin.back() != H->NumCalls ||
+      Index.RefBegin.back() != H->NumRefs ||
+      Index.TypeTestBegin.back() != H->NumTypeTests)
+    return createError("inconsistent array sizes");
+  return Index;
+}
+
+// Checks that Begin is a valid array of row offsets into an array of Size
+// elements.
+static bool isValidOffsetArray(ArrayRef<csi::ulittle32_t> Begin,
+                               uint64_t Size) {
+  if (Begin.front() != 0 || Begin.back() != Size)
+    return false;
+  for (size_t I = 1, E = Begin.size(); I != E; ++I)
+    if (Begin[I] < Begin[I - 1])
+      return false;
+  return true;
+}
+
+Error CompactSummaryIndex::verify() const {
+  for (size_t I = 1, E = GUIDs.size(); I < E; ++I)
+    if (GUIDs[I] <= GUIDs[I - 1])
+      return createError("GUIDs are not sorted");
+  if (!isValidOffsetArray(SummaryBegin, Summaries.size()) ||
+      !isValidOffsetArray(ModuleSummaryBegin, ModuleSummaries.size()) ||
+      !isValidOffsetArray(CallBegin, Calls.size()) ||
+      !isValidOffsetArray(RefBegin, Refs.size()) ||
+      !isValidOffsetArray(TypeTestBegin, TypeTests.size()))
+    return createError("invalid offset array");
+
+  for (const csi::Module &M : Modules)
+    if (M.NameOffset > StringTable.size() ||
+        M.NameSize > StringTable.size() - M.NameOffset)
+      return createError("invalid module path");
+
+  for (unsigned S = 0, E = getNumSummaries(); S != E; ++S) {
+    if (getModule(S) >= getNumModules())
+      return createError("invalid module index in summary " + Twine(S));
+    if (getSummaryKind(S) > GlobalValueSummary::GlobalVarKind)
+      return createError("invalid kind in summary " + Twine(S));
+    if (getLinkage(S) > GlobalValue::CommonLinkage)
+      return createError("invalid linkage in summary " + Twine(S));
+    if (getSummaryKind(S) == GlobalValueSummary::AliasKind &&
+        (getAliasee(S) >= E ||
+         getSummaryKind(getAliasee(S)) != GlobalValueSummary::FunctionKind))
+      return createError("invalid aliasee in summary " + Twine(S));
+  }
+
+  // Each summary must be listed once, in the module which defines it.
+  std::vector<bool> Seen(getNumSummaries());
+  for (unsigned M = 0, E = getNumModules(); M != E; ++M) {
+    for (unsigned I = module_summary_begin(M); I != module_summary_end(M);
+         ++I) {
+      unsigned S = getModuleSummary(I);
+      if (S >= getNumSummaries() || Seen[S] || getModule(S) != M)
+        return createError("invalid module summary list");
+      Seen[S] = true;
+    }
+  }
+
+  for (unsigned E = 0, N = getNumCalls(); E != N; ++E)
+    if (getCallee(E) >= getNumGUIDs())
+      return createError("invalid callee");
+  for (unsigned E = 0, N = getNumRefs(); E != N; ++E)
+    if (getRef(E) >= getNumGUIDs())
+      return createError("invalid reference");
+  return Error::success();
+}
+
+ModuleHash CompactSummaryIndex::getModuleHash(unsigned M) const {
+  ModuleHash Hash;
+  for (unsigned I = 0; I != Hash.size(); ++I)
+    Hash[I] = Modules[M].Hash[I];
+  return Hash;
+}
+
+Optional<unsigned> CompactSummaryIndex::findGUID(GlobalValue::GUID GUID) const {
+  auto I = std::lower_bound(
+      GUIDs.begin(), GUIDs.end(), GUID,
+      [](const csi::ulittle64_t &L, GlobalValue::GUID R) { return L < R; });
+  if (I == GUIDs.end() || *I != GUID)
+    return None;
+  return I - GUIDs.begin();
+}
+
+unsigned CompactSummaryIndex::getGUIDIndex(unsigned S) const {
+  // The summaries are numbered in GUID order, so the GUID of S is the last one
+  // whose summaries begin at or before S.
+  auto I = std::upper_bound(
+      SummaryBegin.begin(), SummaryBegin.end(), S,
+      [](unsigned L, const csi::ulittle32_t &R) { return L < R; });
+  return I - SummaryBegin.begin() - 1;
+}
+
+GlobalValueSummary::GVFlags CompactSummaryIndex::getFlags(unsigned S) const {
+  uint32_t Flags = Summaries[S].Flags;
+  return GlobalValueSummary::GVFlags(getLinkage(S), (Flags >> 6) & 1,
+                                     (Flags >> 7) & 1, (Flags >> 8) & 1);
+}
+
+namespace {
+// Writes the arrays of an index, aligning each one to 8 bytes from the start
+// of the index.
+class ArrayWriter {
+public:
+  ArrayWriter(raw_ostream &OS) : OS(OS), W(OS), Start(OS.tell()) {}
+
+  void align() {
+    while ((OS.tell() - Start) % 8)
+      OS << '\0';
+  }
+
+  template <typename T> void write(T Val) { W.write<T>(Val); }
+
+  template <typename T> void writeArray(ArrayRef<T> Vals) {
+    align();
+    for (T Val : Vals)
+      W.write<T>(Val);
+  }
+
+private:
+  raw_ostream &OS;
+  support::endian::Writer<support::little> W;
+  uint64_t Start;
+};
+} // end anonymous namespace
+
+Error llvm::writeCompactSummaryIndex(const ModuleSummaryIndex &Index,
+                                     raw_ostream &OS) {
+  // Number the modules in module ID order, so that the output doesn't depend
+  // on the order of the StringMap.
+  typedef ModulePathStringTableTy::value_type ModulePathTy;
+  std::vector<const ModulePathTy *> Paths;
+  for (auto &MP : Index.modulePaths())
+    Paths.push_back(&MP);
+  std::sort(Paths.begin(), Paths.end(),
+            [](const ModulePathTy *L, const ModulePathTy *R) {
+              return std::make_pair(L->second.first, L->first()) <
+                     std::make_pair(R->second.first, R->first());
+            });
+  StringMap<unsigned> ModuleIndices;
+  for (unsigned I = 0, E = Paths.size(); I != E; ++I)
+    ModuleIndices[Paths[I]->first()] = I;
+
+  // Intern the GUIDs of the summaries and of all the values they refer to.
+  std::vector<GlobalValue::GUID> GUIDs;
+  for (auto &I : Index) {
+    GUIDs.push_back(I.first);
+    for (auto &S : I.second) {
+      for (ValueInfo Ref : S->refs())
+        GUIDs.push_back(Ref.getGUID());
+      if (auto *FS = dyn_cast<FunctionSummary>(S.get()))
+        for (auto &Edge : FS->calls())
+          GUIDs.push_back(Edge.first.getGUID());
+    }
+  }
+  std::sort(GUIDs.begin(), GUIDs.end());
+  GUIDs.erase(std::unique(GUIDs.begin(), GUIDs.end()), GUIDs.end());
+  if (GUIDs.size() > csi::MaxGUIDs)
+    return createError("too many GUIDs (" + Twine(GUIDs.size()) + ")");
+  auto GetGUIDIndex = [&](GlobalValue::GUID GUID) -> uint32_t {
+    return std::lower_bound(GUIDs.begin(), GUIDs.end(), GUID) - GUIDs.begin();
+  };
+
+  // Number the summaries in GUID order. The index is sorted by GUID too.
+  std::vector<const GlobalValueSummary *> Summaries;
+  DenseMap<const GlobalValueSummary *, uint32_t> SummaryIndices;
+  std::vector<uint32_t> SummaryBegin;
+  auto It = Index.begin();
+  for (GlobalValue::GUID GUID : GUIDs) {
+    SummaryBegin.push_back(Summaries.size());
+    if (It == Index.end() || It->first != GUID)
+      continue;
+    for (auto &S : It->second) {
+      SummaryIndices[S.get()] = Summaries.size();
+      Summaries.push_back(S.get());
+    }
+    ++It;
+  }
+  SummaryBegin.push_back(Summaries.size());
+
+  // Resolve the aliasees before writing anything, the aliasee of an alias may
+  // be missing from an index which was not built by the thin link.
+  auto GetSummaryGUID = [&](unsigned S) {
+    return GUIDs[std::upper_bound(SummaryBegin.begin(), SummaryBegin.end(), S) -
+                 SummaryBegin.begin() - 1];
+  };
+  std::vector<uint32_t> Aliasees(Summaries.size(), ~0U);
+  for (unsigned S = 0, E = Summaries.size(); S != E; ++S) {
+    auto *AS = dyn_cast<AliasSummary>(Summaries[S]);
+    if (!AS)
+      continue;
+    auto I = SummaryIndices.find(&AS->getAliasee());
+    if (I == SummaryIndices.end())
+      return createError("the aliasee of alias " + Twine(GetSummaryGUID(S)) +
+                         " has no summary");
+    if (!isa<FunctionSummary>(AS->getAliasee()))
+      return createError("the aliasee of alias " + Twine(GetSummaryGUID(S)) +
+                         " is not a function");
+    Aliasees[S] = I->second;
+  }
+
+  std::vector<uint32_t> Modules(Summaries.size());
+  std::vector<std::vector<uint32_t>> SummariesPerModule(Paths.size());
+  for (unsigned S = 0, E = Summaries.size(); S != E; ++S) {
+    Modules[S] = ModuleIndices.lookup(Summaries[S]->modulePath());
+    SummariesPerModule[Modules[S]].push_back(S);
+  }
+
+  // The counts, and the offsets into the arrays they count, are 32-bit.
+  uint64_t NumCalls = 0, NumRefs = 0, NumTypeTests = 0, StringTableSize = 0;
+  for (const GlobalValueSummary *S : Summaries) {
+    NumRefs += S->refs().size();
+    if (auto *FS = dyn_cast<FunctionSummary>(S)) {
+      NumCalls += FS->calls().size();
+      NumTypeTests += FS->type_tests().size();
+    }
+  }
+  for (auto *P : Paths)
+    StringTableSize += P->first().size();
+  if (Summaries.size() > UINT32_MAX)
+    return createError("too many summaries (" + Twine(Summaries.size()) + ")");
+  if (NumCalls > UINT32_MAX)
+    return createError("too many calls (" + Twine(NumCalls) + ")");
+  if (NumRefs > UINT32_MAX)
+    return createError("too many references (" + Twine(NumRefs) + ")");
+  if (NumTypeTests > UINT32_MAX)
+    return createError("too many type tests (" + Twine(NumTypeTests) + ")");
+  if (StringTableSize > UINT32_MAX)
+    return createError("module paths are too long (" +
+                       Twine(StringTableSize) + " bytes)");
+
+  ArrayWriter W(OS);
+
+  OS.write(csi::Magic, sizeof(csi::Magic));
+  W.write<uint32_t>(csi::Version);
+  W.write<uint32_t>(Paths.size());
+  W.write<uint32_t>(GUIDs.size());
+  W.write<uint32_t>(Summaries.size());
+  W.write<uint32_t>(NumCalls);
+  W.write<uint32_t>(NumRefs);
+  W.write<uint32_t>(NumTypeTests);
+  W.write<uint32_t>(StringTableSize);
+
+  W.align();
+  uint32_t NameOffset = 0;
+  for (auto *P : Paths) {
+    W.write<uint32_t>(NameOffset);
+    W.write<uint32_t>(P->first().size());
+    W.write<uint64_t>(P->second.first);
+    for (uint32_t H : P->second.second)
+      W.write<uint32_t>(H);
+    W.write<uint32_t>(0);
+    NameOffset += P->first().size();
+  }
+
+  W.writeArray<uint64_t>(GUIDs);
+  W.writeArray<uint32_t>(SummaryBegin);
+
+  W.align();
+  for (unsigned S = 0, E = Summaries.size(); S != E; ++S) {
+    const GlobalValueSummary *GVS = Summaries[S];
+    uint32_t Flags = GVS->getSummaryKind() | GVS->linkage() << 2 |
+                     GVS->noRename() << 6 |
+                     GVS->hasInlineAsmMaybeReferencingInternal() << 7 |
+                     GVS->isNotViableToInline() << 8;
+    W.write<uint32_t>(Flags);
+    W.write<uint32_t>(Modules[S]);
+    auto *FS = dyn_cast<FunctionSummary>(GVS);
+    W.write<uint32_t>(FS ? FS->instCount() : 0);
+    W.write<uint32_t>(Aliasees[S]);
+    W.write<uint64_t>(GVS->getOriginalName());
+  }
+
+  std::vector<uint32_t> Offsets(1);
+  for (auto &ModuleSummaries : SummariesPerModule)
+    Offsets.push_back(Offsets.back() + ModuleSummaries.size());
+  W.writeArray<uint32_t>(Offsets);
+  W.align();
+  for (auto &ModuleSummaries : SummariesPerModule)
+    for (uint32_t S : ModuleSummaries)
+      W.write<uint32_t>(S);
+
+  Offsets.resize(1);
+  for (const GlobalValueSummary *S : Summaries) {
+    auto *FS = dyn_cast<FunctionSummary>(S);
+    Offsets.push_back(Offsets.back() + (FS ? FS->calls().size() : 0));
+  }
+  W.writeArray<uint32_t>(Offsets);
+  W.align();
+  for (const GlobalValueSummary *S : Summaries)
+    if (auto *FS = dyn_cast<FunctionSummary>(S))
+      for (auto &Edge : FS->calls())
+        W.write<uint32_t>(GetGUIDIndex(Edge.first.getGUID()) << 2 |
+                          uint32_t(Edge.second.Hotness));
+
+  Offsets.resize(1);
+  for (const GlobalValueSummary *S : Summaries)
+    Offsets.push_back(Offsets.back() + S->refs().size());
+  W.writeArray<uint32_t>(Offsets);
+  W.align();
+  for (const GlobalValueSummary *S : Summaries)
+    for (ValueInfo Ref : S->refs())
+      W.write<uint32_t>(GetGUIDIndex(Ref.getGUID()));
+
+  Offsets.resize(1);
+  for (const GlobalValueSummary *S : Summaries) {
+    auto *FS = dyn_cast<FunctionSummary>(S);
+    Offsets.push_back(Offsets.back() + (FS ? FS->type_tests().size() : 0));
+  }
+  W.writeArray<uint32_t>(Offsets);
+  W.align();
+  for (const GlobalValueSummary *S : Summaries)
+    if (auto *FS = dyn_cast<FunctionSummary>(S))
+      for (GlobalValue::GUID TypeId : FS->type_tests())
+        W.write<uint64_t>(TypeId);
+
+  W.align();
+  for (auto *P : Paths)
+    OS << P->first();
+  return Error::success();
+}
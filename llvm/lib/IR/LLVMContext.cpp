@@ -284,6 +284,21 @@ void LLVMContext::setDiscardValueNames(bool Discard) {
   pImpl->DiscardValueNames = Discard;
 }
 
+void LLVMContext::enableIRArena() {
+  assert((!CurrentIRArena || CurrentIRArena == &pImpl->IRArena) &&
+         "The IR arena of another context is enabled on this thread");
+  CurrentIRArena = &pImpl->IRArena;
+}
+
+void LLVMContext::disableIRArena() {
+  if (CurrentIRArena == &pImpl->IRArena)
+    CurrentIRArena = nullptr;
+}
+
+size_t LLVMContext::getIRArenaSize() const {
+  return pImpl->IRArena.getBytesAllocated();
+}
+
 OptBisect &LLVMContext::getOptBisect() {
   return pImpl->getOptBisect();
 }
@@ -51,7 +51,12 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
   NamedStructTypesUniqueID = 0;
 }
 
+LLVM_THREAD_LOCAL BumpPtrAllocator *llvm::CurrentIRArena;
+
 LLVMContextImpl::~LLVMContextImpl() {
+  if (CurrentIRArena == &IRArena)
+    CurrentIRArena = nullptr;
+
   // NOTE: We need to delete the contents of OwnedModules, but Module's dtor
   // will call LLVMContextImpl::removeModule, thus invalidating iterators into
   // the container. Avoid iterators during this operation:
@@ -32,6 +32,8 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/YAMLTraits.h"
 #include <vector>
@@ -1077,8 +1079,35 @@ public:
   void getAll(SmallVectorImpl<std::pair<unsigned, MDNode *>> &Result) const;
 };
 
+/// The IR arena enabled on the current thread by LLVMContext::enableIRArena(),
+/// if any.
+extern LLVM_THREAD_LOCAL BumpPtrAllocator *CurrentIRArena;
+
+/// Allocates the storage of an IR object, from the IR arena of the current
+/// thread if there is one. \p FromArena is set to whether it does.
+inline void *allocateIRStorage(size_t Size, bool &FromArena) {
+  if (BumpPtrAllocator *Arena = CurrentIRArena) {
+    FromArena = true;
+    return Arena->Allocate(Size, alignof(uint64_t));
+  }
+  FromArena = false;
+  return ::operator new(Size);
+}
+
+/// Releases storage returned by allocateIRStorage(). The storage of the IR
+/// arena is only released with the arena.
+inline void deallocateIRStorage(void *Storage, bool FromArena) {
+  if (!FromArena)
+    ::operator delete(Storage);
+}
+
 class LLVMContextImpl {
 public:
+  /// IRArena - The storage of the IR objects allocated after
+  /// LLVMContext::enableIRArena(). This is the first member so that it is
+  /// destroyed after all the objects of the context.
+  BumpPtrAllocator IRArena;
+
   /// OwnedModules - The set of modules instantiated in this context, and which
   /// will be automatically deleted if this context is deleted.
   SmallPtrSet<Module*, 4> OwnedModules;
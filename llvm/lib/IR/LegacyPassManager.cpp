@@ -25,6 +25,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/Timer.h"
+#include "llvm/Support/TraceEvents.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <map>
@@ -860,7 +861,8 @@ void PMDataManager::verifyPreservedAnalysis(Pass *P) {
 }
 
 /// Remove Analysis not preserved by Pass P
-void PMDataManager::removeNotPreservedAnalysis(Pass *P) {
+void PMDataManager::removeNotPreservedAnalysis(Pass *P,
+                                               Optional<StringRef> IRName) {
   AnalysisUsage *AnUsage = TPM->findAnalysisUsage(P);
   if (AnUsage->getPreservesAll())
     return;
@@ -877,6 +879,9 @@ void PMDataManager::removeNotPreservedAnalysis(Pass *P) {
         dbgs() << " -- '" <<  P->getPassName() << "' is not preserving '";
         dbgs() << S->getPassName() << "'\n";
       }
+      if (IRName && trace::isEnabled())
+        trace::recordInstant("invalidation", Info->second->getPassName(),
+                             *IRName);
       AvailableAnalysis.erase(Info);
     }
   }
@@ -900,6 +905,9 @@ void PMDataManager::removeNotPreservedAnalysis(Pass *P) {
           dbgs() << " -- '" <<  P->getPassName() << "' is not preserving '";
           dbgs() << S->getPassName() << "'\n";
         }
+        if (IRName && trace::isEnabled())
+          trace::recordInstant("invalidation", Info->second->getPassName(),
+                               *IRName);
         InheritedAnalysis[Index]->erase(Info);
       }
     }
@@ -1023,7 +1031,7 @@ void PMDataManager::add(Pass *P, bool ProcessAnalysis) {
 
   // Take a note of analysis required and made available by this pass.
   // Remove the analysis not preserved by this pass
-  removeNotPreservedAnalysis(P);
+  removeNotPreservedAnalysis(P, None);
   recordAvailableAnalysis(P);
 
   // Add pass
@@ -1292,6 +1300,9 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        trace::Scope TraceScope;
+        if (trace::isEnabled())
+          TraceScope.begin("pass", BP->getPassName(), F.getName());
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1304,7 +1315,7 @@ bool BBPassManager::runOnFunction(Function &F) {
       dumpUsedSet(BP);
 
       verifyPreservedAnalysis(BP);
-      removeNotPreservedAnalysis(BP);
+      removeNotPreservedAnalysis(BP, F.getName());
       recordAvailableAnalysis(BP);
       removeDeadPasses(BP, I->getName(), ON_BASICBLOCK_MSG);
     }
@@ -1509,6 +1520,9 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      trace::Scope TraceScope;
+      if (trace::isEnabled())
+        TraceScope.begin("pass", FP->getPassName(), F.getName());
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1520,7 +1534,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     dumpUsedSet(FP);
 
     verifyPreservedAnalysis(FP);
-    removeNotPreservedAnalysis(FP);
+    removeNotPreservedAnalysis(FP, F.getName());
     recordAvailableAnalysis(FP);
     removeDeadPasses(FP, F.getName(), ON_FUNCTION_MSG);
   }
@@ -1586,6 +1600,9 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      trace::Scope TraceScope;
+      if (trace::isEnabled())
+        TraceScope.begin("pass", MP->getPassName(), M.getModuleIdentifier());
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1598,7 +1615,7 @@ MPPassManager::runOnModule(Module &M) {
     dumpUsedSet(MP);
 
     verifyPreservedAnalysis(MP);
-    removeNotPreservedAnalysis(MP);
+    removeNotPreservedAnalysis(MP, StringRef(M.getModuleIdentifier()));
     recordAvailableAnalysis(MP);
     removeDeadPasses(MP, M.getModuleIdentifier(), ON_MODULE_MSG);
   }
@@ -31,6 +31,7 @@
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
@@ -44,6 +45,9 @@ using namespace llvm;
 using namespace lto;
 using namespace object;
 
+static const char *const ThinLinkGroupName = "thinlink";
+static const char *const ThinLinkGroupDescription = "ThinLTO Thin Link";
+
 #define DEBUG_TYPE "lto"
 
 // Returns a unique hash for the Module considering the current list of
@@ -61,44 +65,9 @@ static void computeCacheKey(
   // list of ResolvedODR for the module, and the list of preserved symbols.
   SHA1 Hasher;
 
-  // Start with the compiler revision
-  Hasher.update(LLVM_VERSION_STRING);
-#ifdef HAVE_LLVM_REVISION
-  Hasher.update(LLVM_REVISION);
-#endif
-
-  // Include the parts of the LTO configuration that affect code generation.
-  auto AddString = [&](StringRef Str) {
-    Hasher.update(Str);
-    Hasher.update(ArrayRef<uint8_t>{0});
-  };
-  auto AddUnsigned = [&](unsigned I) {
-    uint8_t Data[4];
-    Data[0] = I;
-    Data[1] = I >> 8;
-    Data[2] = I >> 16;
-    Data[3] = I >> 24;
-    Hasher.update(ArrayRef<uint8_t>{Data, 4});
-  };
-  AddString(Conf.CPU);
-  // FIXME: Hash more of Options. For now all clients initialize Options from
-  // command-line flags (which is unsupported in production), but may set
-  // RelaxELFRelocations. The clang driver can also pass FunctionSections,
-  // DataSections and DebuggerTuning via command line flags.
-  AddUnsigned(Conf.Options.RelaxELFRelocations);
-  AddUnsigned(Conf.Options.FunctionSections);
-  AddUnsigned(Conf.Options.DataSections);
-  AddUnsigned((unsigned)Conf.Options.DebuggerTuning);
-  for (auto &A : Conf.MAttrs)
-    AddString(A);
-  AddUnsigned(Conf.RelocModel);
-  AddUnsigned(Conf.CodeModel);
-  AddUnsigned(Conf.CGOptLevel);
-  AddUnsigned(Conf.OptLevel);
-  AddString(Conf.OptPipeline);
-  AddString(Conf.AAPipeline);
-  AddString(Conf.OverrideTriple);
-  AddString(Conf.DefaultTriple);
+  // Start with the compiler revision and the parts of the LTO configuration
+  // that affect code generation.
+  hashCodeGenConfig(Hasher, Conf);
 
   // Include the hash for the current module
   auto ModHash = Index.getModuleHash(ModuleID);
@@ -173,6 +142,16 @@ static void thinLTOResolveWeakForLinkerGUID(
   }
 }
 
+// Collects the summary lists of the index, so that they can be split among
+// threads.
+static std::vector<GlobalValueSummaryMapTy::value_type *>
+collectSummaryLists(ModuleSummaryIndex &Index) {
+  std::vector<GlobalValueSummaryMapTy::value_type *> Lists;
+  for (auto &I : Index)
+    Lists.push_back(&I);
+  return Lists;
+}
+
 // Resolve Weak and LinkOnce values in the \p Index.
 //
 // We'd like to drop these functions if they are no longer referenced in the
@@ -184,7 +163,8 @@ void llvm::thinLTOResolveWeakForLinkerInIndex(
     function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
         isPrevailing,
     function_ref<void(StringRef, GlobalValue::GUID, GlobalValue::LinkageTypes)>
-        recordNewLinkage) {
+        recordNewLinkage,
+    ThreadPool *Pool) {
   // We won't optimize the globals that are referenced by an alias for now
   // Ideally we should turn the alias into a global and duplicate the definition
   // when needed.
@@ -194,9 +174,34 @@ void llvm::thinLTOResolveWeakForLinkerInIndex(
       if (auto AS = dyn_cast<AliasSummary>(S.get()))
         GlobalInvolvedWithAlias.insert(&AS->getAliasee());
 
-  for (auto &I : Index)
-    thinLTOResolveWeakForLinkerGUID(I.second, I.first, GlobalInvolvedWithAlias,
-                                    isPrevailing, recordNewLinkage);
+  // The summary lists are resolved in slices on several threads. The linkage
+  // changes of each slice are buffered and recorded afterwards from this
+  // thread, in the order of the index.
+  struct NewLinkage {
+    StringRef ModulePath;
+    GlobalValue::GUID GUID;
+    GlobalValue::LinkageTypes Linkage;
+  };
+  auto Lists = collectSummaryLists(Index);
+  unsigned ThreadCount = Pool ? Pool->getThreadCount() + 1 : 1;
+  size_t NumSlices = std::min<size_t>(Lists.size(), ThreadCount * 8);
+  std::vector<std::vector<NewLinkage>> NewLinkages(NumSlices);
+  parallelFor(Pool, 0, NumSlices, [&](size_t Slice) {
+    auto Record = [&](StringRef ModulePath, GlobalValue::GUID GUID,
+                      GlobalValue::LinkageTypes Linkage) {
+      NewLinkages[Slice].push_back({ModulePath, GUID, Linkage});
+    };
+    size_t Begin = Lists.size() * Slice / NumSlices;
+    size_t End = Lists.size() * (Slice + 1) / NumSlices;
+    for (size_t I = Begin; I != End; ++I)
+      thinLTOResolveWeakForLinkerGUID(Lists[I]->second, Lists[I]->first,
+                                      GlobalInvolvedWithAlias, isPrevailing,
+                                      Record);
+  });
+
+  for (auto &SliceLinkages : NewLinkages)
+    for (NewLinkage &L : SliceLinkages)
+      recordNewLinkage(L.ModulePath, L.GUID, L.Linkage);
 }
 
 static void thinLTOInternalizeAndPromoteGUID(
@@ -215,9 +220,14 @@ static void thinLTOInternalizeAndPromoteGUID(
 // as external and non-exported values as internal.
 void llvm::thinLTOInternalizeAndPromoteInIndex(
     ModuleSummaryIndex &Index,
-    function_ref<bool(StringRef, GlobalValue::GUID)> isExported) {
-  for (auto &I : Index)
-    thinLTOInternalizeAndPromoteGUID(I.second, I.first, isExported);
+    function_ref<bool(StringRef, GlobalValue::GUID)> isExported,
+    ThreadPool *Pool) {
+  // Each summary list is updated independently of the others.
+  auto Lists = collectSummaryLists(Index);
+  parallelFor(Pool, 0, Lists.size(), [&](size_t I) {
+    thinLTOInternalizeAndPromoteGUID(Lists[I]->second, Lists[I]->first,
+                                     isExported);
+  });
 }
 
 struct InputFile::InputModule {
@@ -523,19 +533,25 @@ unsigned LTO::getMaxTasks() const {
   return RegularLTO.ParallelCodeGenParallelismLevel + ThinLTO.ModuleMap.size();
 }
 
-Error LTO::run(AddStreamFn AddStream, NativeObjectCache Cache) {
+Error LTO::run(AddStreamFn AddStream, NativeObjectCache Cache,
+               NativeObjectCache RegularLTOCache) {
   // Save the status of having a regularLTO combined module, as
   // this is needed for generating the ThinLTO Task ID, and
   // the CombinedModule will be moved at the end of runRegularLTO.
   bool HasRegularLTO = RegularLTO.CombinedModule != nullptr;
   // Invoke regular LTO if there was a regular LTO module to start with.
   if (HasRegularLTO)
-    if (auto E = runRegularLTO(AddStream))
+    if (auto E = runRegularLTO(AddStream, RegularLTOCache))
       return E;
   return runThinLTO(AddStream, Cache, HasRegularLTO);
 }
 
-Error LTO::runRegularLTO(AddStreamFn AddStream) {
+Error LTO::runRegularLTO(AddStreamFn AddStream, NativeObjectCache Cache) {
+  // All the modules have been linked, so the type and metadata maps of the
+  // IRMover aren't needed anymore. Free them before the optimizer runs.
+  RegularLTO.Mover.reset();
+  reportMemoryUsage("linking");
+
   // Make sure commons have the right size/alignment: we kept the largest from
   // all the prevailing when adding the inputs, and we apply it here.
   const DataLayout &DL = RegularLTO.CombinedModule->getDataLayout();
@@ -593,7 +609,7 @@ Error LTO::runRegularLTO(AddStreamFn AddStream) {
       return Error::success();
   }
   return backend(Conf, AddStream, RegularLTO.ParallelCodeGenParallelismLevel,
-                 std::move(RegularLTO.CombinedModule));
+                 std::move(RegularLTO.CombinedModule), Cache);
 }
 
 /// This class defines the interface to the ThinLTO backend.
@@ -831,12 +847,25 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache,
   if (Conf.CombinedIndexHook && !Conf.CombinedIndexHook(ThinLTO.CombinedIndex))
     return Error::success();
 
+  unsigned ThreadCount = Conf.ThinLinkThreads
+                             ? Conf.ThinLinkThreads
+                             : heavyweight_hardware_concurrency();
+  // The phases of the thin link share the threads of one pool, on top of the
+  // calling thread.
+  std::unique_ptr<ThreadPool> LinkPool;
+  if (ThreadCount > 1)
+    LinkPool = llvm::make_unique<ThreadPool>(ThreadCount - 1);
+
   // Collect for each module the list of function it defines (GUID ->
   // Summary).
   StringMap<std::map<GlobalValue::GUID, GlobalValueSummary *>>
       ModuleToDefinedGVSummaries(ThinLTO.ModuleMap.size());
-  ThinLTO.CombinedIndex.collectDefinedGVSummariesPerModule(
-      ModuleToDefinedGVSummaries);
+  {
+    NamedRegionTimer T("collect", "Collect defined summaries", ThinLinkGroupName,
+                       ThinLinkGroupDescription, TimePassesIsEnabled);
+    ThinLTO.CombinedIndex.collectDefinedGVSummariesPerModule(
+        ModuleToDefinedGVSummaries);
+  }
   // Create entries for any modules that didn't have any GV summaries
   // (either they didn't have any GVs to start with, or we suppressed
   // generation of the summaries because they e.g. had inline assembly
@@ -855,8 +884,13 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache,
   StringMap<std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>> ResolvedODR;
 
   if (Conf.OptLevel > 0) {
-    ComputeCrossModuleImport(ThinLTO.CombinedIndex, ModuleToDefinedGVSummaries,
-                             ImportLists, ExportLists);
+    {
+      NamedRegionTimer T("import", "Cross-module import", ThinLinkGroupName,
+                         ThinLinkGroupDescription, TimePassesIsEnabled);
+      ComputeCrossModuleImport(ThinLTO.CombinedIndex,
+                               ModuleToDefinedGVSummaries, ImportLists,
+                               ExportLists, LinkPool.get());
+    }
 
     std::set<GlobalValue::GUID> ExportedGUIDs;
     for (auto &Res : GlobalResolutions) {
@@ -865,9 +899,10 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache,
         ExportedGUIDs.insert(GlobalValue::getGUID(Res.second.IRName));
     }
 
+    // These callbacks are called concurrently and must not modify the maps.
     auto isPrevailing = [&](GlobalValue::GUID GUID,
                             const GlobalValueSummary *S) {
-      return ThinLTO.PrevailingModuleForGUID[GUID] == S->modulePath();
+      return ThinLTO.PrevailingModuleForGUID.lookup(GUID) == S->modulePath();
     };
     auto isExported = [&](StringRef ModuleIdentifier, GlobalValue::GUID GUID) {
       const auto &ExportList = ExportLists.find(ModuleIdentifier);
@@ -875,7 +910,12 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache,
               ExportList->second.count(GUID)) ||
              ExportedGUIDs.count(GUID);
     };
-    thinLTOInternalizeAndPromoteInIndex(ThinLTO.CombinedIndex, isExported);
+    {
+      NamedRegionTimer T("internalize", "Internalization", ThinLinkGroupName,
+                         ThinLinkGroupDescription, TimePassesIsEnabled);
+      thinLTOInternalizeAndPromoteInIndex(ThinLTO.CombinedIndex, isExported,
+                                          LinkPool.get());
+    }
 
     auto recordNewLinkage = [&](StringRef ModuleIdentifier,
                                 GlobalValue::GUID GUID,
@@ -883,8 +923,11 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache,
       ResolvedODR[ModuleIdentifier][GUID] = NewLinkage;
     };
 
+    NamedRegionTimer T("weak-resolution", "Weak symbol resolution",
+                       ThinLinkGroupName, ThinLinkGroupDescription,
+                       TimePassesIsEnabled);
     thinLTOResolveWeakForLinkerInIndex(ThinLTO.CombinedIndex, isPrevailing,
-                                       recordNewLinkage);
+                                       recordNewLinkage, LinkPool.get());
   }
 
   std::unique_ptr<ThinBackendProc> BackendProc =
@@ -15,6 +15,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/LTO/LTOBackend.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/CGSCCPassManager.h"
 #include "llvm/Analysis/LoopPassManager.h"
@@ -31,8 +32,11 @@
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_sha1_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
@@ -42,6 +46,61 @@
 using namespace llvm;
 using namespace lto;
 
+static cl::opt<bool> MemoryReport(
+    "lto-memory-report", cl::Hidden,
+    cl::desc("Print the memory usage after each phase of the regular LTO "
+             "link"));
+
+void lto::reportMemoryUsage(StringRef Phase) {
+  if (!MemoryReport)
+    return;
+  errs() << "memory after " << Phase
+         << ": malloc usage " << sys::Process::GetMallocUsage() / 1024
+         << " KB, peak RSS " << sys::Process::GetPeakMemoryUsage() / 1024
+         << " KB\n";
+}
+
+void lto::hashCodeGenConfig(SHA1 &Hasher, const Config &Conf) {
+  // Start with the compiler revision
+  Hasher.update(LLVM_VERSION_STRING);
+#ifdef HAVE_LLVM_REVISION
+  Hasher.update(LLVM_REVISION);
+#endif
+
+  // Include the parts of the LTO configuration that affect code generation.
+  auto AddString = [&](StringRef Str) {
+    Hasher.update(Str);
+    Hasher.update(ArrayRef<uint8_t>{0});
+  };
+  auto AddUnsigned = [&](unsigned I) {
+    uint8_t Data[4];
+    Data[0] = I;
+    Data[1] = I >> 8;
+    Data[2] = I >> 16;
+    Data[3] = I >> 24;
+    Hasher.update(ArrayRef<uint8_t>{Data, 4});
+  };
+  AddString(Conf.CPU);
+  // FIXME: Hash more of Options. For now all clients initialize Options from
+  // command-line flags (which is unsupported in production), but may set
+  // RelaxELFRelocations. The clang driver can also pass FunctionSections,
+  // DataSections and DebuggerTuning via command line flags.
+  AddUnsigned(Conf.Options.RelaxELFRelocations);
+  AddUnsigned(Conf.Options.FunctionSections);
+  AddUnsigned(Conf.Options.DataSections);
+  AddUnsigned((unsigned)Conf.Options.DebuggerTuning);
+  for (auto &A : Conf.MAttrs)
+    AddString(A);
+  AddUnsigned(Conf.RelocModel);
+  AddUnsigned(Conf.CodeModel);
+  AddUnsigned(Conf.CGOptLevel);
+  AddUnsigned(Conf.OptLevel);
+  AddString(Conf.OptPipeline);
+  AddString(Conf.AAPipeline);
+  AddString(Conf.OverrideTriple);
+  AddString(Conf.DefaultTriple);
+}
+
 LLVM_ATTRIBUTE_NORETURN static void reportOpenError(StringRef Path, Twine Msg) {
   errs() << "failed to open " << Path << ": " << Msg << '\n';
   errs().flush();
@@ -213,7 +272,49 @@ void codegen(Config &Conf, TargetMachine *TM, AddStreamFn AddStream,
   CodeGenPasses.run(Mod);
 }
 
+// Removes the declarations which aren't used. Each partition of a split module
+// declares the definitions of all the other partitions. They don't change the
+// generated code, but they would make the cache key of a partition change
+// whenever a global is added to or removed from another partition.
+void dropUnusedDeclarations(Module &Mod) {
+  for (auto I = Mod.begin(), E = Mod.end(); I != E;) {
+    Function &F = *I++;
+    F.removeDeadConstantUsers();
+    if (F.isDeclaration() && F.use_empty())
+      F.eraseFromParent();
+  }
+  for (auto I = Mod.global_begin(), E = Mod.global_end(); I != E;) {
+    GlobalVariable &GV = *I++;
+    GV.removeDeadConstantUsers();
+    if (GV.isDeclaration() && GV.use_empty())
+      GV.eraseFromParent();
+  }
+}
+
+// Generates the object of Mod, or adds it to the link from Cache if Cache
+// already has an object for the same optimized IR and configuration.
+void cachedCodegen(Config &Conf, TargetMachine *TM, AddStreamFn AddStream,
+                   NativeObjectCache Cache, unsigned Task, Module &Mod) {
+  if (!Cache) {
+    codegen(Conf, TM, AddStream, Task, Mod);
+    return;
+  }
+
+  SHA1 Hasher;
+  hashCodeGenConfig(Hasher, Conf);
+  // The printed module covers the definitions of Mod along with the
+  // declarations, metadata and module level state they refer to. It is hashed
+  // as it is printed rather than kept in memory.
+  raw_sha1_ostream IRHasher;
+  Mod.print(IRHasher, /*AAW=*/nullptr);
+  Hasher.update(IRHasher.sha1());
+
+  if (AddStreamFn CacheAddStream = Cache(Task, toHex(Hasher.result())))
+    codegen(Conf, TM, CacheAddStream, Task, Mod);
+}
+
 void splitCodeGen(Config &C, TargetMachine *TM, AddStreamFn AddStream,
+                  NativeObjectCache Cache,
                   unsigned ParallelCodeGenParallelismLevel,
                   std::unique_ptr<Module> Mod) {
   ThreadPool CodegenThreadPool(ParallelCodeGenParallelismLevel);
@@ -247,7 +348,10 @@ void splitCodeGen(Config &C, TargetMachine *TM, AddStreamFn AddStream,
               std::unique_ptr<TargetMachine> TM =
                   createTargetMachine(C, MPartInCtx->getTargetTriple(), T);
 
-              codegen(C, TM.get(), AddStream, ThreadId, *MPartInCtx);
+              if (Cache)
+                dropUnusedDeclarations(*MPartInCtx);
+              cachedCodegen(C, TM.get(), AddStream, Cache, ThreadId,
+                            *MPartInCtx);
             },
             // Pass BC using std::move to ensure that it get moved rather than
             // copied into the thread's context.
@@ -291,7 +395,7 @@ static void handleAsmUndefinedRefs(Module &Mod, TargetMachine &TM) {
 
 Error lto::backend(Config &C, AddStreamFn AddStream,
                    unsigned ParallelCodeGenParallelismLevel,
-                   std::unique_ptr<Module> Mod) {
+                   std::unique_ptr<Module> Mod, NativeObjectCache Cache) {
   Expected<const Target *> TOrErr = initAndLookupTarget(C, *Mod);
   if (!TOrErr)
     return TOrErr.takeError();
@@ -301,16 +405,19 @@ Error lto::backend(Config &C, AddStreamFn AddStream,
 
   handleAsmUndefinedRefs(*Mod, *TM);
 
-  if (!C.CodeGenOnly)
+  if (!C.CodeGenOnly) {
     if (!opt(C, TM.get(), 0, *Mod, /*IsThinLTO=*/false))
       return Error::success();
+    reportMemoryUsage("optimization");
+  }
 
   if (ParallelCodeGenParallelismLevel == 1) {
-    codegen(C, TM.get(), AddStream, 0, *Mod);
+    cachedCodegen(C, TM.get(), AddStream, Cache, 0, *Mod);
   } else {
-    splitCodeGen(C, TM.get(), AddStream, ParallelCodeGenParallelismLevel,
-                 std::move(Mod));
+    splitCodeGen(C, TM.get(), AddStream, Cache,
+                 ParallelCodeGenParallelismLevel, std::move(Mod));
   }
+  reportMemoryUsage("code generation");
   return Error::success();
 }
 
@@ -46,6 +46,7 @@
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO.h"
@@ -73,6 +74,9 @@ namespace {
 static cl::opt<int>
     ThreadCount("threads", cl::init(llvm::heavyweight_hardware_concurrency()));
 
+const char *const ThinLinkGroupName = "thinlink";
+const char *const ThinLinkGroupDescription = "ThinLTO Thin Link";
+
 Expected<std::unique_ptr<tool_output_file>>
 setupOptimizationRemarks(LLVMContext &Ctx, int Count) {
   if (LTOPassRemarksWithHotness)
@@ -435,6 +439,14 @@ ProcessThinLTOModule(Module &TheModule, ModuleSummaryIndex &Index,
   return codegenModule(TheModule, TM);
 }
 
+/// Create the threads the phases of the thin link share with the calling
+/// thread, or null if the thin link runs serially.
+static std::unique_ptr<ThreadPool> createThinLinkPool() {
+  if (ThreadCount <= 1)
+    return nullptr;
+  return llvm::make_unique<ThreadPool>(ThreadCount - 1);
+}
+
 /// Resolve LinkOnce/Weak symbols. Record resolutions in the \p ResolvedODR map
 /// for caching, and in the \p Index for application during the ThinLTO
 /// backends. This is needed for correctness for exported symbols (ensure
@@ -443,7 +455,8 @@ ProcessThinLTOModule(Module &TheModule, ModuleSummaryIndex &Index,
 static void resolveWeakForLinkerInIndex(
     ModuleSummaryIndex &Index,
     StringMap<std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>>
-        &ResolvedODR) {
+        &ResolvedODR,
+    ThreadPool *LinkPool) {
 
   DenseMap<GlobalValue::GUID, const GlobalValueSummary *> PrevailingCopy;
   computePrevailingCopies(Index, PrevailingCopy);
@@ -462,7 +475,8 @@ static void resolveWeakForLinkerInIndex(
     ResolvedODR[ModuleIdentifier][GUID] = NewLinkage;
   };
 
-  thinLTOResolveWeakForLinkerInIndex(Index, isPrevailing, recordNewLinkage);
+  thinLTOResolveWeakForLinkerInIndex(Index, isPrevailing, recordNewLinkage,
+                                     LinkPool);
 }
 
 // Initialize the TargetMachine builder for a given Triple
@@ -581,15 +595,17 @@ void ThinLTOCodeGenerator::promote(Module &TheModule,
   StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries;
   Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
 
+  auto LinkPool = createThinLinkPool();
+
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
   ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+                           ExportLists, LinkPool.get());
 
   // Resolve LinkOnce/Weak symbols.
   StringMap<std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>> ResolvedODR;
-  resolveWeakForLinkerInIndex(Index, ResolvedODR);
+  resolveWeakForLinkerInIndex(Index, ResolvedODR, LinkPool.get());
 
   thinLTOResolveWeakForLinkerModule(
       TheModule, ModuleToDefinedGVSummaries[ModuleIdentifier]);
@@ -606,7 +622,7 @@ void ThinLTOCodeGenerator::promote(Module &TheModule,
             ExportList->second.count(GUID)) ||
            GUIDPreservedSymbols.count(GUID);
   };
-  thinLTOInternalizeAndPromoteInIndex(Index, isExported);
+  thinLTOInternalizeAndPromoteInIndex(Index, isExported, LinkPool.get());
 
   promoteModule(TheModule, Index);
 }
@@ -623,11 +639,13 @@ void ThinLTOCodeGenerator::crossModuleImport(Module &TheModule,
   StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries(ModuleCount);
   Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
 
+  auto LinkPool = createThinLinkPool();
+
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
   ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+                           ExportLists, LinkPool.get());
   auto &ImportList = ImportLists[TheModule.getModuleIdentifier()];
 
   crossImportIntoModule(TheModule, Index, ModuleMap, ImportList);
@@ -645,11 +663,13 @@ void ThinLTOCodeGenerator::gatherImportedSummariesForModule(
   StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries(ModuleCount);
   Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
 
+  auto LinkPool = createThinLinkPool();
+
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
   ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+                           ExportLists, LinkPool.get());
 
   llvm::gatherImportedSummariesForModule(ModulePath, ModuleToDefinedGVSummaries,
                                          ImportLists[ModulePath],
@@ -668,11 +688,13 @@ void ThinLTOCodeGenerator::emitImports(StringRef ModulePath,
   StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries(ModuleCount);
   Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
 
+  auto LinkPool = createThinLinkPool();
+
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
   ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+                           ExportLists, LinkPool.get());
 
   std::error_code EC;
   if ((EC = EmitImportsFiles(ModulePath, OutputName, ImportLists[ModulePath])))
@@ -697,11 +719,13 @@ void ThinLTOCodeGenerator::internalize(Module &TheModule,
   StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries(ModuleCount);
   Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
 
+  auto LinkPool = createThinLinkPool();
+
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
   ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+                           ExportLists, LinkPool.get());
   auto &ExportList = ExportLists[ModuleIdentifier];
 
   // Be friendly and don't nuke totally the module when the client didn't
@@ -716,7 +740,7 @@ void ThinLTOCodeGenerator::internalize(Module &TheModule,
             ExportList->second.count(GUID)) ||
            GUIDPreservedSymbols.count(GUID);
   };
-  thinLTOInternalizeAndPromoteInIndex(Index, isExported);
+  thinLTOInternalizeAndPromoteInIndex(Index, isExported, LinkPool.get());
   thinLTOInternalizeModule(TheModule,
                            ModuleToDefinedGVSummaries[ModuleIdentifier]);
 }
@@ -834,14 +858,25 @@ void ThinLTOCodeGenerator::run() {
 
   // Collect for each module the list of function it defines (GUID -> Summary).
   StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries(ModuleCount);
-  Index->collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
+  {
+    NamedRegionTimer T("collect", "Collect defined summaries", ThinLinkGroupName,
+                       ThinLinkGroupDescription, TimePassesIsEnabled);
+    Index->collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
+  }
+
+  // The phases of the thin link share the threads of one pool.
+  auto LinkPool = createThinLinkPool();
 
   // Collect the import/export lists for all modules from the call-graph in the
   // combined index.
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
-  ComputeCrossModuleImport(*Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+  {
+    NamedRegionTimer T("import", "Cross-module import", ThinLinkGroupName,
+                       ThinLinkGroupDescription, TimePassesIsEnabled);
+    ComputeCrossModuleImport(*Index, ModuleToDefinedGVSummaries, ImportLists,
+                             ExportLists, LinkPool.get());
+  }
 
   // Convert the preserved symbols set from string to GUID, this is needed for
   // computing the caching hash and the internalization.
@@ -856,7 +891,12 @@ void ThinLTOCodeGenerator::run() {
 
   // Resolve LinkOnce/Weak symbols, this has to be computed early because it
   // impacts the caching.
-  resolveWeakForLinkerInIndex(*Index, ResolvedODR);
+  {
+    NamedRegionTimer T("weak-resolution", "Weak symbol resolution",
+                       ThinLinkGroupName, ThinLinkGroupDescription,
+                       TimePassesIsEnabled);
+    resolveWeakForLinkerInIndex(*Index, ResolvedODR, LinkPool.get());
+  }
 
   auto isExported = [&](StringRef ModuleIdentifier, GlobalValue::GUID GUID) {
     const auto &ExportList = ExportLists.find(ModuleIdentifier);
@@ -868,7 +908,11 @@ void ThinLTOCodeGenerator::run() {
   // Use global summary-based analysis to identify symbols that can be
   // internalized (because they aren't exported or preserved as per callback).
   // Changes are made in the index, consumed in the ThinLTO backends.
-  thinLTOInternalizeAndPromoteInIndex(*Index, isExported);
+  {
+    NamedRegionTimer T("internalize", "Internalization", ThinLinkGroupName,
+                       ThinLinkGroupDescription, TimePassesIsEnabled);
+    thinLTOInternalizeAndPromoteInIndex(*Index, isExported, LinkPool.get());
+  }
 
   // Make sure that every module has an entry in the ExportLists and
   // ResolvedODR maps to enable threaded access to these maps below.
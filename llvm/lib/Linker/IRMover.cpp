@@ -1437,10 +1437,13 @@ Error IRMover::move(
     std::unique_ptr<Module> Src, ArrayRef<GlobalValue *> ValuesToLink,
     std::function<void(GlobalValue &, ValueAdder Add)> AddLazyFor,
     bool LinkModuleInlineAsm, bool IsPerformingImport) {
-  IRLinker TheIRLinker(Composite, SharedMDs, IdentifiedStructTypes,
-                       std::move(Src), ValuesToLink, std::move(AddLazyFor),
-                       LinkModuleInlineAsm, IsPerformingImport);
-  Error E = TheIRLinker.run();
+  auto TheIRLinker = llvm::make_unique<IRLinker>(
+      Composite, SharedMDs, IdentifiedStructTypes, std::move(Src), ValuesToLink,
+      std::move(AddLazyFor), LinkModuleInlineAsm, IsPerformingImport);
+  Error E = TheIRLinker->run();
+  // Free the source module first, so that the constants which were only used
+  // by its globals that weren't linked can be dropped too.
+  TheIRLinker.reset();
   Composite.dropTriviallyDeadConstantArrays();
   return E;
 }
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/MC/MCAssembler.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Twine.h"
@@ -30,6 +31,7 @@
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <tuple>
 using namespace llvm;
 
@@ -54,6 +56,7 @@ STATISTIC(evaluateFixup, "Number of evaluated fixups");
 STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
+STATISTIC(RelaxationChecks, "Number of fragments checked for relaxation");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
 }
 }
@@ -639,6 +642,201 @@ std::pair<uint64_t, bool> MCAssembler::handleFixup(const MCAsmLayout &Layout,
   return std::make_pair(FixedValue, IsPCRel);
 }
 
+/// The fragments whose size may change during relaxation, in layout order, and
+/// the history of the size changes of each section.
+///
+/// A fragment is only checked again once a fragment that its size depends on
+/// moved, instead of in every pass: the value of a label difference changes
+/// only if a fragment between the two labels changed size, and the offset of
+/// a label only if a fragment before it did. An align or org fragment changes
+/// size whenever a fragment before it does. The fragments which can't be
+/// relaxed anymore are dropped.
+struct MCAssembler::RelaxationWorklist {
+  /// A range [Begin, End) of the layout orders of the fragments of Sec.
+  struct Span {
+    const MCSection *Sec;
+    unsigned Begin;
+    unsigned End;
+  };
+
+  struct Candidate {
+    MCFragment *F;
+    /// The step in which F was last checked, 0 if it wasn't yet.
+    unsigned CheckedAt = 0;
+    /// Set if the dependencies of F are not known and it is checked in every
+    /// step.
+    bool AlwaysCheck = false;
+    /// The size of F depends on the sizes of the fragments in these spans.
+    SmallVector<Span, 1> Spans;
+
+    explicit Candidate(MCFragment *F) : F(F) {}
+  };
+
+  /// The fragments of a section which changed size in one step.
+  struct Change {
+    unsigned Step;
+    unsigned FirstOrder;
+    std::vector<unsigned> Orders;
+  };
+
+  DenseMap<const MCSection *, std::vector<Candidate>> Candidates;
+  DenseMap<const MCSection *, std::vector<Change>> Changes;
+  /// The layout orders of the align and org fragments of each section.
+  DenseMap<const MCSection *, std::vector<unsigned>> OffsetDependent;
+  unsigned Step = 0;
+  /// False if fragments may change size because of bundle padding, in which
+  /// case every candidate is checked in every step.
+  bool TrackDependencies;
+
+  RelaxationWorklist(const MCAssembler &Asm, const MCAsmLayout &Layout);
+
+  /// Returns true if a fragment in the spans of \p C changed size since \p C
+  /// was checked.
+  bool needsCheck(const Candidate &C) const;
+
+  /// Sets the spans of \p C from the expressions its size depends on.
+  void computeSpans(Candidate &C) const;
+};
+
+MCAssembler::RelaxationWorklist::RelaxationWorklist(const MCAssembler &Asm,
+                                                    const MCAsmLayout &Layout)
+    : TrackDependencies(!Asm.isBundlingEnabled()) {
+  for (MCSection *Sec : Layout.getSectionOrder()) {
+    for (MCFragment &F : *Sec) {
+      switch (F.getKind()) {
+      default:
+        break;
+      case MCFragment::FT_Relaxable:
+        if (Asm.getBackend().mayNeedRelaxation(
+                cast<MCRelaxableFragment>(F).getInst()))
+          Candidates[Sec].emplace_back(&F);
+        break;
+      case MCFragment::FT_Dwarf:
+      case MCFragment::FT_DwarfFrame:
+      case MCFragment::FT_LEB:
+      case MCFragment::FT_CVInlineLines:
+      case MCFragment::FT_CVDefRange:
+        Candidates[Sec].emplace_back(&F);
+        break;
+      case MCFragment::FT_Align:
+      case MCFragment::FT_Org:
+        OffsetDependent[Sec].push_back(F.getLayoutOrder());
+        break;
+      }
+    }
+  }
+}
+
+bool MCAssembler::RelaxationWorklist::needsCheck(const Candidate &C) const {
+  if (!C.CheckedAt || C.AlwaysCheck)
+    return true;
+  for (const Span &S : C.Spans) {
+    auto CI = Changes.find(S.Sec);
+    if (CI == Changes.end())
+      continue;
+    auto OI = OffsetDependent.find(S.Sec);
+    for (const Change &Ch : make_range(CI->second.rbegin(), CI->second.rend())) {
+      if (Ch.Step < C.CheckedAt)
+        break;
+      auto I = std::lower_bound(Ch.Orders.begin(), Ch.Orders.end(), S.Begin);
+      if (I != Ch.Orders.end() && *I < S.End)
+        return true;
+      if (OI == OffsetDependent.end())
+        continue;
+      auto J = std::upper_bound(OI->second.begin(), OI->second.end(),
+                                std::max(S.Begin, Ch.FirstOrder + 1) - 1);
+      if (J != OI->second.end() && *J < S.End)
+        return true;
+    }
+  }
+  return false;
+}
+
+/// Adds the fragments of the labels referenced by \p Expr to \p Frags.
+/// Returns false if the value of \p Expr may depend on the layout in other
+/// ways.
+static bool collectFragments(const MCExpr &Expr,
+                             SmallVectorImpl<const MCFragment *> &Frags) {
+  switch (Expr.getKind()) {
+  case MCExpr::Constant:
+    return true;
+  case MCExpr::SymbolRef: {
+    const MCSymbol &Sym = cast<MCSymbolRefExpr>(Expr).getSymbol();
+    if (Sym.isVariable())
+      return false;
+    if (Sym.isInSection(/*SetUsed=*/false))
+      Frags.push_back(Sym.getFragment(/*SetUsed=*/false));
+    return true;
+  }
+  case MCExpr::Unary:
+    return collectFragments(*cast<MCUnaryExpr>(Expr).getSubExpr(), Frags);
+  case MCExpr::Binary: {
+    const MCBinaryExpr &BE = cast<MCBinaryExpr>(Expr);
+    return collectFragments(*BE.getLHS(), Frags) &&
+           collectFragments(*BE.getRHS(), Frags);
+  }
+  case MCExpr::Target:
+    return false;
+  }
+  llvm_unreachable("Invalid assembly expression kind!");
+}
+
+void MCAssembler::RelaxationWorklist::computeSpans(Candidate &C) const {
+  C.Spans.clear();
+  C.AlwaysCheck = !TrackDependencies;
+  if (C.AlwaysCheck)
+    return;
+
+  SmallVector<const MCFragment *, 4> Frags;
+  bool Known = true;
+  switch (C.F->getKind()) {
+  default:
+    // The code view fragments depend on the line tables of the context.
+    Known = false;
+    break;
+  case MCFragment::FT_Relaxable:
+    // The fixups may be relative to the fragment itself.
+    Frags.push_back(C.F);
+    for (const MCFixup &Fixup : cast<MCRelaxableFragment>(C.F)->getFixups())
+      Known &= collectFragments(*Fixup.getValue(), Frags);
+    break;
+  case MCFragment::FT_Dwarf:
+    Known = collectFragments(
+        cast<MCDwarfLineAddrFragment>(C.F)->getAddrDelta(), Frags);
+    break;
+  case MCFragment::FT_DwarfFrame:
+    Known = collectFragments(
+        cast<MCDwarfCallFrameFragment>(C.F)->getAddrDelta(), Frags);
+    break;
+  case MCFragment::FT_LEB:
+    Known = collectFragments(cast<MCLEBFragment>(C.F)->getValue(), Frags);
+    break;
+  }
+  if (!Known) {
+    C.AlwaysCheck = true;
+    return;
+  }
+
+  // The difference of two labels of a section depends on the fragments
+  // between them, the offset of a single label on the fragments before it.
+  std::sort(Frags.begin(), Frags.end(),
+            [](const MCFragment *A, const MCFragment *B) {
+              return std::make_pair(A->getParent()->getLayoutOrder(),
+                                    A->getLayoutOrder()) <
+                     std::make_pair(B->getParent()->getLayoutOrder(),
+                                    B->getLayoutOrder());
+            });
+  for (size_t I = 0, E = Frags.size(); I != E;) {
+    size_t J = I + 1;
+    while (J != E && Frags[J]->getParent() == Frags[I]->getParent())
+      ++J;
+    unsigned Begin = J - I == 1 ? 0 : Frags[I]->getLayoutOrder();
+    C.Spans.push_back(
+        {Frags[I]->getParent(), Begin, Frags[J - 1]->getLayoutOrder()});
+    I = J;
+  }
+}
+
 void MCAssembler::layout(MCAsmLayout &Layout) {
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - pre-layout\n--\n";
@@ -666,7 +864,8 @@ void MCAssembler::layout(MCAsmLayout &Layout) {
   }
 
   // Layout until everything fits.
-  while (layoutOnce(Layout))
+  RelaxationWorklist Worklist(*this, Layout);
+  while (layoutOnce(Layout, Worklist))
     if (getContext().hadError())
       return;
 
@@ -855,62 +1054,91 @@ bool MCAssembler::relaxCVDefRange(MCAsmLayout &Layout,
   return OldSize != F.getContents().size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = nullptr;
+bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
+  switch(F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable:
+    assert(!getRelaxAll() &&
+           "Did not expect a MCRelaxableFragment in RelaxAll mode");
+    return relaxInstruction(Layout, cast<MCRelaxableFragment>(F));
+  case MCFragment::FT_Dwarf:
+    return relaxDwarfLineAddr(Layout, cast<MCDwarfLineAddrFragment>(F));
+  case MCFragment::FT_DwarfFrame:
+    return relaxDwarfCallFrameFragment(Layout,
+                                       cast<MCDwarfCallFrameFragment>(F));
+  case MCFragment::FT_LEB:
+    return relaxLEB(Layout, cast<MCLEBFragment>(F));
+  case MCFragment::FT_CVInlineLines:
+    return relaxCVInlineLineTable(Layout, cast<MCCVInlineLineTableFragment>(F));
+  case MCFragment::FT_CVDefRange:
+    return relaxCVDefRange(Layout, cast<MCCVDefRangeFragment>(F));
+  }
+}
 
-  // Attempt to relax all the fragments in the section.
-  for (MCSection::iterator I = Sec.begin(), IE = Sec.end(); I != IE; ++I) {
-    // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = false;
-    switch(I->getKind()) {
-    default:
-      break;
-    case MCFragment::FT_Relaxable:
-      assert(!getRelaxAll() &&
-             "Did not expect a MCRelaxableFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCRelaxableFragment>(I));
-      break;
-    case MCFragment::FT_Dwarf:
-      RelaxedFrag = relaxDwarfLineAddr(Layout,
-                                       *cast<MCDwarfLineAddrFragment>(I));
-      break;
-    case MCFragment::FT_DwarfFrame:
-      RelaxedFrag =
-        relaxDwarfCallFrameFragment(Layout,
-                                    *cast<MCDwarfCallFrameFragment>(I));
-      break;
-    case MCFragment::FT_LEB:
-      RelaxedFrag = relaxLEB(Layout, *cast<MCLEBFragment>(I));
-      break;
-    case MCFragment::FT_CVInlineLines:
-      RelaxedFrag =
-          relaxCVInlineLineTable(Layout, *cast<MCCVInlineLineTableFragment>(I));
-      break;
-    case MCFragment::FT_CVDefRange:
-      RelaxedFrag = relaxCVDefRange(Layout, *cast<MCCVDefRangeFragment>(I));
-      break;
+bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec,
+                                    RelaxationWorklist &Worklist) {
+  auto CI = Worklist.Candidates.find(&Sec);
+  if (CI == Worklist.Candidates.end())
+    return false;
+  std::vector<RelaxationWorklist::Candidate> &Candidates = CI->second;
+  unsigned Step = ++Worklist.Step;
+
+  // The layout orders of the fragments which were relaxed. When a fragment is
+  // relaxed, all the fragments following it should get invalidated because
+  // their offset is going to change.
+  std::vector<unsigned> Relaxed;
+
+  // Attempt to relax the fragments of the section whose size may have to
+  // change.
+  bool Dropped = false;
+  for (RelaxationWorklist::Candidate &C : Candidates) {
+    if (!Worklist.needsCheck(C))
+      continue;
+    ++stats::RelaxationChecks;
+    bool RelaxedFrag = relaxFragment(Layout, *C.F);
+    if (RelaxedFrag)
+      Relaxed.push_back(C.F->getLayoutOrder());
+    // The fixups of a relaxed instruction may have changed.
+    if (!C.CheckedAt || (RelaxedFrag && isa<MCRelaxableFragment>(C.F)))
+      Worklist.computeSpans(C);
+    C.CheckedAt = Step;
+
+    // Drop the instructions which can't be relaxed anymore.
+    if (auto *RF = dyn_cast<MCRelaxableFragment>(C.F)) {
+      if (!getBackend().mayNeedRelaxation(RF->getInst())) {
+        C.F = nullptr;
+        Dropped = true;
+      }
     }
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = &*I;
-  }
-  if (FirstRelaxedFragment) {
-    Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
-    return true;
   }
-  return false;
+  if (Dropped)
+    Candidates.erase(
+        std::remove_if(Candidates.begin(), Candidates.end(),
+                       [](const RelaxationWorklist::Candidate &C) {
+                         return C.F == nullptr;
+                       }),
+        Candidates.end());
+
+  if (Relaxed.empty())
+    return false;
+  Layout.invalidateFragmentsFrom(&*std::find_if(
+      Sec.begin(), Sec.end(), [&](const MCFragment &F) {
+        return F.getLayoutOrder() == Relaxed.front();
+      }));
+  unsigned FirstOrder = Relaxed.front();
+  Worklist.Changes[&Sec].push_back({Step, FirstOrder, std::move(Relaxed)});
+  return true;
 }
 
-bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
+bool MCAssembler::layoutOnce(MCAsmLayout &Layout,
+                             RelaxationWorklist &Worklist) {
   ++stats::RelaxationSteps;
 
   bool WasRelaxed = false;
   for (iterator it = begin(), ie = end(); it != ie; ++it) {
     MCSection &Sec = *it;
-    while (layoutSectionOnce(Layout, Sec))
+    while (layoutSectionOnce(Layout, Sec, Worklist))
       WasRelaxed = true;
   }
 
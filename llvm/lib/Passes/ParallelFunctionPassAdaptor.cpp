@@ -0,0 +1,477 @@
+//===- ParallelFunctionPassAdaptor.cpp - Run function passes in parallel --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the parallel module-to-function pass adaptor.
+///
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Passes/ParallelFunctionPassAdaptor.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+using namespace llvm;
+
+static cl::opt<unsigned> ParallelFunctionThreads(
+    "parallel-function-threads", cl::init(0), cl::Hidden,
+    cl::desc("Number of threads used to run a parallel-function pipeline "
+             "(0 uses the number of hardware threads)"));
+
+static const RemapFlags MergeFlags =
+    RemapFlags(RF_MoveDistinctMDs | RF_IgnoreMissingLocals);
+
+template <class Callable>
+static void forEachGlobalValue(Module &M, Callable Fn) {
+  for (Function &F : M)
+    Fn(F);
+  for (GlobalVariable &GV : M.globals())
+    Fn(GV);
+  for (GlobalAlias &GA : M.aliases())
+    Fn(GA);
+  for (GlobalIFunc &GI : M.ifuncs())
+    Fn(GI);
+}
+
+// Returns a prefix for temporary names which no global value or struct type
+// name of M starts with.
+static std::string getTemporaryNamePrefix(Module &M) {
+  for (unsigned I = 0;; ++I) {
+    std::string Prefix = ("parallel-function.anon" + Twine(I) + ".").str();
+    bool Used = false;
+    forEachGlobalValue(M, [&](GlobalValue &GV) {
+      Used |= GV.getName().startswith(Prefix);
+    });
+    for (StructType *STy : M.getIdentifiedStructTypes())
+      Used |= STy->getName().startswith(Prefix);
+    if (!Used)
+      return Prefix;
+  }
+}
+
+static size_t getInstructionCount(const Function &F) {
+  size_t N = 0;
+  for (const BasicBlock &BB : F)
+    N += BB.size();
+  return N;
+}
+
+static std::unique_ptr<TargetMachine> cloneTargetMachine(TargetMachine *TM) {
+  if (!TM)
+    return nullptr;
+  return std::unique_ptr<TargetMachine>(TM->getTarget().createTargetMachine(
+      TM->getTargetTriple().str(), TM->getTargetCPU(),
+      TM->getTargetFeatureString(), TM->Options, TM->getRelocationModel(),
+      TM->getCodeModel(), TM->getOptLevel()));
+}
+
+// Optimizes the functions named by Names in a private copy of the module
+// read from Buffer and writes the result to Out.
+static void
+optimizePartition(MemoryBufferRef Buffer, const StringSet<> &Names,
+                  TargetMachine *TM,
+                  const ParallelModuleToFunctionPassAdaptor::PipelineBuilderT
+                      &BuildPipeline,
+                  SmallVectorImpl<char> &Out) {
+  LLVMContext Ctx;
+  Expected<std::unique_ptr<Module>> MOrErr = getLazyBitcodeModule(Buffer, Ctx);
+  if (!MOrErr)
+    report_fatal_error("parallel-function: " + toString(MOrErr.takeError()));
+  Module &M = **MOrErr;
+
+  // Functions outside of the partition are replaced with stubs before
+  // they are read. They stay definitions so that their linkage, comdats and
+  // aliases are still valid.
+  for (Function &F : M) {
+    if (F.isDeclaration() || Names.count(F.getName()))
+      continue;
+    F.dropAllReferences();
+    new UnreachableInst(Ctx, BasicBlock::Create(Ctx, "", &F));
+  }
+  if (Error E = M.materializeAll())
+    report_fatal_error("parallel-function: " + toString(std::move(E)));
+
+  std::unique_ptr<TargetMachine> LocalTM = cloneTargetMachine(TM);
+  PassBuilder PB(LocalTM.get());
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  FunctionPassManager FPM;
+  if (!BuildPipeline(PB, FPM))
+    report_fatal_error("parallel-function: unable to build the pipeline");
+  for (Function &F : M) {
+    if (!Names.count(F.getName()))
+      continue;
+    PreservedAnalyses PA = FPM.run(F, FAM);
+    FAM.invalidate(F, PA);
+  }
+
+  raw_svector_ostream OS(Out);
+  WriteBitcodeToFile(&M, OS, /*ShouldPreserveUseListOrder=*/true);
+}
+
+namespace {
+// Maps the types of a partition read into the context of the original
+// module to the types of the original module.
+class PartitionTypeMapper : public ValueMapTypeRemapper {
+public:
+  DenseMap<Type *, Type *> Map;
+
+  Type *remapType(Type *Ty) override;
+};
+} // end anonymous namespace
+
+Type *PartitionTypeMapper::remapType(Type *Ty) {
+  auto It = Map.find(Ty);
+  if (It != Map.end())
+    return It->second;
+
+  // Identified structs are mapped as a whole, so only derived types are
+  // rebuilt here.
+  Type *Result = Ty;
+  auto *STy = dyn_cast<StructType>(Ty);
+  if (Ty->getNumContainedTypes() && (!STy || STy->isLiteral())) {
+    SmallVector<Type *, 4> Elts;
+    bool Changed = false;
+    for (Type *Elt : Ty->subtypes()) {
+      Elts.push_back(remapType(Elt));
+      Changed |= Elts.back() != Elt;
+    }
+    if (Changed) {
+      switch (Ty->getTypeID()) {
+      case Type::PointerTyID:
+        Result = PointerType::get(Elts[0], Ty->getPointerAddressSpace());
+        break;
+      case Type::ArrayTyID:
+        Result = ArrayType::get(Elts[0], Ty->getArrayNumElements());
+        break;
+      case Type::VectorTyID:
+        Result = VectorType::get(Elts[0], Ty->getVectorNumElements());
+        break;
+      case Type::FunctionTyID:
+        Result = FunctionType::get(Elts[0], makeArrayRef(Elts).slice(1),
+                                   cast<FunctionType>(Ty)->isVarArg());
+        break;
+      case Type::StructTyID:
+        Result = StructType::get(Ty->getContext(), Elts, STy->isPacked());
+        break;
+      default:
+        llvm_unreachable("unknown derived type");
+      }
+    }
+  }
+  Map[Ty] = Result;
+  return Result;
+}
+
+// A partition and the original module were read from the same bitcode, so
+// their metadata graphs have the same shape. Walks both graphs in lockstep
+// from S and D and maps distinct nodes of the partition to the nodes of the
+// original module, so that the compile unit, subprograms and other distinct
+// debug info nodes are not duplicated by the merge.
+static void mapDistinctMetadata(const MDNode *S, MDNode *D,
+                                ValueToValueMapTy &VMap,
+                                SmallPtrSetImpl<const MDNode *> &Visited) {
+  SmallVector<std::pair<const MDNode *, MDNode *>, 16> Worklist;
+  Worklist.push_back({S, D});
+  while (!Worklist.empty()) {
+    std::tie(S, D) = Worklist.pop_back_val();
+    if (S == D || !Visited.insert(S).second)
+      continue;
+    if (S->getMetadataID() != D->getMetadataID() ||
+        S->getNumOperands() != D->getNumOperands() ||
+        S->isDistinct() != D->isDistinct())
+      continue;
+    if (S->isDistinct())
+      VMap.MD()[S].reset(D);
+    for (unsigned I = 0, E = S->getNumOperands(); I != E; ++I)
+      if (auto *SOp = dyn_cast_or_null<MDNode>(S->getOperand(I)))
+        if (auto *DOp = dyn_cast_or_null<MDNode>(D->getOperand(I)))
+          Worklist.push_back({SOp, DOp});
+  }
+}
+
+typedef SmallVector<std::pair<unsigned, MDNode *>, 4> AttachmentList;
+
+static void mapAttachments(const AttachmentList &S, const AttachmentList &D,
+                           ValueToValueMapTy &VMap,
+                           SmallPtrSetImpl<const MDNode *> &Visited) {
+  for (size_t I = 0, E = std::min(S.size(), D.size()); I != E; ++I)
+    if (S[I].first == D[I].first)
+      mapDistinctMetadata(S[I].second, D[I].second, VMap, Visited);
+}
+
+// Moves the bodies of the functions in Funcs from the optimized partition in
+// Buffer into M. OrigNames and OrigTypes are the names of the global values
+// and identified struct types that M had when the partition was created;
+// everything else in the partition was created by the pipeline.
+static void mergePartition(Module &M, MemoryBufferRef Buffer,
+                           ArrayRef<Function *> Funcs,
+                           const StringSet<> &OrigNames,
+                           const StringSet<> &OrigTypes) {
+  LLVMContext &Ctx = M.getContext();
+
+  // Hide the names of M's struct types while the partition is read, so
+  // that the reader gives the partition's types the same names instead of
+  // renaming them, and match the types by name.
+  StringMap<StructType *> MTypes;
+  for (StructType *STy : M.getIdentifiedStructTypes()) {
+    if (!STy->hasName() || !OrigTypes.count(STy->getName()))
+      continue;
+    MTypes[STy->getName()] = STy;
+    STy->setName("");
+  }
+
+  Expected<std::unique_ptr<Module>> SrcOrErr = parseBitcodeFile(Buffer, Ctx);
+  if (!SrcOrErr)
+    report_fatal_error("parallel-function: " +
+                       toString(SrcOrErr.takeError()));
+  Module &Src = **SrcOrErr;
+
+  PartitionTypeMapper TypeMapper;
+  for (StructType *STy : Src.getIdentifiedStructTypes()) {
+    auto It = MTypes.find(STy->getName());
+    if (!STy->hasName() || It == MTypes.end())
+      continue;
+    TypeMapper.Map[STy] = It->second;
+    STy->setName("");
+  }
+  for (auto &KV : MTypes)
+    KV.second->setName(KV.first());
+
+  // Map the global values of the partition to those of M. Global values
+  // created by the pipeline, such as declarations of library functions or
+  // private string constants, are added to M.
+  ValueToValueMapTy VMap;
+  std::vector<std::pair<GlobalVariable *, GlobalVariable *>> NewVars;
+  forEachGlobalValue(Src, [&](GlobalValue &SGV) {
+    GlobalValue *DGV = nullptr;
+    if (SGV.hasName() &&
+        (!SGV.hasLocalLinkage() || OrigNames.count(SGV.getName())))
+      DGV = M.getNamedValue(SGV.getName());
+
+    if (!DGV) {
+      if (auto *SF = dyn_cast<Function>(&SGV)) {
+        if (!SF->isDeclaration())
+          report_fatal_error("parallel-function: the pipeline created "
+                             "function " + SF->getName());
+        Function *NF = Function::Create(
+            cast<FunctionType>(TypeMapper.remapType(SF->getFunctionType())),
+            SF->getLinkage(), SF->getName(), &M);
+        NF->copyAttributesFrom(SF);
+        DGV = NF;
+      } else if (auto *SV = dyn_cast<GlobalVariable>(&SGV)) {
+        if (!SV->isDeclaration() && !SV->hasLocalLinkage())
+          report_fatal_error("parallel-function: the pipeline created "
+                             "global variable " + SV->getName());
+        auto *NV = new GlobalVariable(
+            M, TypeMapper.remapType(SV->getValueType()), SV->isConstant(),
+            SV->getLinkage(), nullptr, SV->getName(), nullptr,
+            SV->getThreadLocalMode(), SV->getType()->getAddressSpace());
+        NV->copyAttributesFrom(SV);
+        if (SV->hasInitializer())
+          NewVars.push_back({SV, NV});
+        DGV = NV;
+      } else {
+        report_fatal_error("parallel-function: the pipeline created alias " +
+                           SGV.getName());
+      }
+    }
+
+    Type *Ty = TypeMapper.remapType(SGV.getType());
+    if (DGV->getType() == Ty)
+      VMap[&SGV] = DGV;
+    else
+      VMap[&SGV] = ConstantExpr::getBitCast(DGV, Ty);
+  });
+
+  // Map distinct metadata reachable from named metadata, global variables
+  // and the merged functions.
+  SmallPtrSet<const MDNode *, 32> Visited;
+  for (NamedMDNode &SN : Src.named_metadata())
+    if (NamedMDNode *DN = M.getNamedMetadata(SN.getName()))
+      for (unsigned I = 0, E = std::min(SN.getNumOperands(),
+                                        DN->getNumOperands());
+           I != E; ++I)
+        mapDistinctMetadata(SN.getOperand(I), DN->getOperand(I), VMap,
+                            Visited);
+
+  for (GlobalVariable &SV : Src.globals()) {
+    auto *DV = dyn_cast<GlobalVariable>(VMap.lookup(&SV));
+    if (!DV)
+      continue;
+    AttachmentList SMDs, DMDs;
+    SV.getAllMetadata(SMDs);
+    DV->getAllMetadata(DMDs);
+    mapAttachments(SMDs, DMDs, VMap, Visited);
+  }
+
+  for (Function *MF : Funcs) {
+    AttachmentList SMDs, DMDs;
+    Src.getFunction(MF->getName())->getAllMetadata(SMDs);
+    MF->getAllMetadata(DMDs);
+    mapAttachments(SMDs, DMDs, VMap, Visited);
+  }
+
+  for (auto &P : NewVars)
+    P.second->setInitializer(
+        MapValue(P.first->getInitializer(), VMap, MergeFlags, &TypeMapper));
+
+  // Replace the bodies. This follows IRLinker::linkFunctionBody.
+  for (Function *MF : Funcs) {
+    Function *SF = Src.getFunction(MF->getName());
+    MF->dropAllReferences();
+    if (SF->hasPrefixData())
+      MF->setPrefixData(SF->getPrefixData());
+    if (SF->hasPrologueData())
+      MF->setPrologueData(SF->getPrologueData());
+    if (SF->hasPersonalityFn())
+      MF->setPersonalityFn(SF->getPersonalityFn());
+    MF->copyMetadata(SF, 0);
+    MF->setAttributes(SF->getAttributes());
+    MF->stealArgumentListFrom(*SF);
+    MF->getBasicBlockList().splice(MF->end(), SF->getBasicBlockList());
+    RemapFunction(*MF, VMap, MergeFlags, &TypeMapper);
+  }
+}
+
+PreservedAnalyses
+ParallelModuleToFunctionPassAdaptor::run(Module &M, ModuleAnalysisManager &AM) {
+  unsigned NumThreads = ParallelFunctionThreads;
+  if (NumThreads == 0)
+    NumThreads = heavyweight_hardware_concurrency();
+
+  // A blockaddress refers to a block of another function, which can't be
+  // moved between modules one function at a time, so modules that take the
+  // address of a block are optimized serially.
+  std::vector<Function *> Funcs;
+  bool CanSplit = true;
+  for (Function &F : M) {
+    if (F.isMaterializable())
+      CanSplit = false;
+    if (F.isDeclaration())
+      continue;
+    Funcs.push_back(&F);
+    for (BasicBlock &BB : F)
+      if (BB.hasAddressTaken())
+        CanSplit = false;
+  }
+
+  if (!CanSplit || NumThreads <= 1 || Funcs.size() < 2) {
+    PassBuilder PB(TM);
+    FunctionPassManager FPM(DebugLogging);
+    if (!BuildPipeline(PB, FPM))
+      report_fatal_error("parallel-function: unable to build the pipeline");
+    return createModuleToFunctionPassAdaptor(std::move(FPM)).run(M, AM);
+  }
+
+  // Global values and struct types are matched by name, so give temporary
+  // names to those without one. No name in M starts with Prefix, so the
+  // temporary names can't be taken for the names of other values or types.
+  std::string Prefix = getTemporaryNamePrefix(M);
+  std::vector<GlobalValue *> Unnamed;
+  StringSet<> OrigNames;
+  forEachGlobalValue(M, [&](GlobalValue &GV) {
+    if (!GV.hasName()) {
+      GV.setName(Prefix + Twine(Unnamed.size()));
+      Unnamed.push_back(&GV);
+    }
+    OrigNames.insert(GV.getName());
+  });
+
+  std::vector<StructType *> UnnamedTypes;
+  StringSet<> OrigTypes;
+  for (StructType *STy : M.getIdentifiedStructTypes()) {
+    if (!STy->hasName()) {
+      STy->setName((Prefix + "type." + Twine(UnnamedTypes.size())).str());
+      UnnamedTypes.push_back(STy);
+    }
+    OrigTypes.insert(STy->getName());
+  }
+
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS, /*ShouldPreserveUseListOrder=*/true);
+  }
+  MemoryBufferRef Buffer(StringRef(Bitcode.data(), Bitcode.size()),
+                         M.getModuleIdentifier());
+
+  // Split the functions into contiguous partitions of roughly the same
+  // number of instructions.
+  size_t Total = 0;
+  for (Function *F : Funcs)
+    Total += getInstructionCount(*F);
+
+  size_t NumParts = std::min<size_t>(NumThreads, Funcs.size());
+  std::vector<std::vector<Function *>> Parts(1);
+  size_t Size = 0;
+  for (Function *F : Funcs) {
+    if (!Parts.back().empty() && Parts.size() < NumParts &&
+        Size * NumParts >= Total * Parts.size())
+      Parts.emplace_back();
+    Parts.back().push_back(F);
+    Size += getInstructionCount(*F);
+  }
+
+  std::vector<StringSet<>> Names(Parts.size());
+  for (size_t I = 0, E = Parts.size(); I != E; ++I)
+    for (Function *F : Parts[I])
+      Names[I].insert(F->getName());
+
+  std::vector<SmallVector<char, 0>> Results(Parts.size());
+  {
+    ThreadPool Pool(NumThreads);
+    for (size_t I = 0, E = Parts.size(); I != E; ++I)
+      Pool.async([&, I] {
+        optimizePartition(Buffer, Names[I], TM, BuildPipeline, Results[I]);
+      });
+    Pool.wait();
+  }
+
+  // The bodies of the functions are about to be replaced, so drop the
+  // analyses cached for them.
+  FunctionAnalysisManager &FAM =
+      AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  for (Function *F : Funcs)
+    FAM.invalidate(*F, PreservedAnalyses::none());
+
+  for (size_t I = 0, E = Parts.size(); I != E; ++I)
+    mergePartition(M,
+                   MemoryBufferRef(StringRef(Results[I].data(),
+                                             Results[I].size()),
+                                   M.getModuleIdentifier()),
+                   Parts[I], OrigNames, OrigTypes);
+
+  for (GlobalValue *GV : Unnamed)
+    GV->setName("");
+  for (StructType *STy : UnnamedTypes)
+    STy->setName("");
+  return PreservedAnalyses::none();
+}
@@ -56,6 +56,7 @@
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Passes/ParallelFunctionPassAdaptor.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Target/TargetMachine.h"
@@ -613,6 +614,8 @@ static bool isModulePassName(StringRef Name) {
     return true;
   if (Name == "function")
     return true;
+  if (Name == "parallel-function")
+    return true;
 
   // Explicitly handle custom-parsed pass names.
   if (parseRepeatPassName(Name))
@@ -752,6 +755,19 @@ PassBuilder::parsePipelineText(StringRef Text) {
   return {std::move(ResultPipeline)};
 }
 
+std::string
+PassBuilder::printPipelineText(ArrayRef<PipelineElement> Pipeline) {
+  std::string Text;
+  for (const PipelineElement &E : Pipeline) {
+    if (!Text.empty())
+      Text += ",";
+    Text += E.Name;
+    if (!E.InnerPipeline.empty())
+      Text += "(" + printPipelineText(E.InnerPipeline) + ")";
+  }
+  return Text;
+}
+
 bool PassBuilder::parseModulePass(ModulePassManager &MPM,
                                   const PipelineElement &E, bool VerifyEachPass,
                                   bool DebugLogging) {
@@ -785,6 +801,26 @@ bool PassBuilder::parseModulePass(ModulePassManager &MPM,
       MPM.addPass(createModuleToFunctionPassAdaptor(std::move(FPM)));
       return true;
     }
+    if (Name == "parallel-function") {
+      // Check the pipeline here so that errors are reported while parsing.
+      // Each thread parses its own copy of it when the pass runs.
+      FunctionPassManager FPM(DebugLogging);
+      if (!parseFunctionPassPipeline(FPM, InnerPipeline, VerifyEachPass,
+                                     DebugLogging))
+        return false;
+      std::string Text = printPipelineText(InnerPipeline);
+      MPM.addPass(ParallelModuleToFunctionPassAdaptor(
+          TM,
+          [Text, VerifyEachPass, DebugLogging](PassBuilder &PB,
+                                               FunctionPassManager &FPM) {
+            auto Pipeline = parsePipelineText(Text);
+            return Pipeline && PB.parseFunctionPassPipeline(
+                                   FPM, *Pipeline, VerifyEachPass,
+                                   DebugLogging);
+          },
+          DebugLogging));
+      return true;
+    }
     if (auto Count = parseRepeatPassName(Name)) {
       ModulePassManager NestedMPM(DebugLogging);
       if (!parseModulePassPipeline(NestedMPM, InnerPipeline, VerifyEachPass,
@@ -58,6 +58,7 @@ class StatisticInfo {
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
   friend void llvm::PrintStatisticsJSON(raw_ostream &OS);
+  friend std::vector<std::pair<std::string, unsigned>> llvm::GetStatistics();
 
   /// Sort statistics by debugtype,name,description.
   void sort();
@@ -156,6 +157,19 @@ void llvm::PrintStatistics(raw_ostream &OS) {
   OS.flush();
 }
 
+std::vector<std::pair<std::string, unsigned>> llvm::GetStatistics() {
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  StatisticInfo &Stats = *StatInfo;
+  Stats.sort();
+
+  std::vector<std::pair<std::string, unsigned>> Result;
+  for (const Statistic *Stat : Stats.Stats)
+    Result.emplace_back(std::string(Stat->getDebugType()) + '.' +
+                            Stat->getName(),
+                        Stat->getValue());
+  return Result;
+}
+
 void llvm::PrintStatisticsJSON(raw_ostream &OS) {
   StatisticInfo &Stats = *StatInfo;
 
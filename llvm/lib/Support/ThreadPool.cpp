@@ -7,133 +7,258 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file implements a crude C++11 based thread pool.
+// This file implements a C++11 based work-stealing thread pool.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/ThreadPool.h"
 
 #include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
 
+namespace {
+// Runs a packaged task stored in a ThreadPoolTask.
+struct PackagedTaskRunner {
+  ThreadPool::PackagedTaskTy Task;
+
+  void operator()() {
+#ifndef _MSC_VER
+    Task();
+#else
+    Task(/* unused */ false);
+#endif
+  }
+};
+} // end anonymous namespace
+
 #if LLVM_ENABLE_THREADS
 
+// The pool and the queue index of the current thread if it belongs to a
+// pool.
+static LLVM_THREAD_LOCAL ThreadPool *CurrentPool;
+static LLVM_THREAD_LOCAL unsigned CurrentIndex;
+
 // Default to std::thread::hardware_concurrency
 ThreadPool::ThreadPool() : ThreadPool(std::thread::hardware_concurrency()) {}
 
 ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0), EnableFlag(true) {
-  // Create ThreadCount threads that will loop forever, wait on QueueCondition
+    : PendingTasks(0), ActiveThreads(0), IdleThreads(0), CompletionWaiters(0),
+      GroupWaiters(0), EnableFlag(true) {
+  // One queue per thread plus one for tasks queued from outside of the pool.
+  for (unsigned I = 0; I <= ThreadCount; ++I)
+    Queues.emplace_back(new WorkQueue);
+
+  // Create ThreadCount threads that will loop forever, wait on WorkCondition
   // for tasks to be queued or the Pool to be destroyed.
   Threads.reserve(ThreadCount);
   for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID) {
-    Threads.emplace_back([&] {
+    Threads.emplace_back([this, ThreadID] {
+      CurrentPool = this;
+      CurrentIndex = ThreadID;
       while (true) {
-        PackagedTaskTy Task;
-        {
-          std::unique_lock<std::mutex> LockGuard(QueueLock);
-          // Wait for tasks to be pushed in the queue
-          QueueCondition.wait(LockGuard,
-                              [&] { return !EnableFlag || !Tasks.empty(); });
-          // Exit condition
-          if (!EnableFlag && Tasks.empty())
-            return;
-          // Yeah, we have a task, grab it and release the lock on the queue
-
-          // We first need to signal that we are active before popping the queue
-          // in order for wait() to properly detect that even if the queue is
-          // empty, there is still a task in flight.
-          {
-            ++ActiveThreads;
-            std::unique_lock<std::mutex> LockGuard(CompletionLock);
-          }
-          Task = std::move(Tasks.front());
-          Tasks.pop();
-        }
-        // Run the task we just grabbed
-#ifndef _MSC_VER
-        Task();
-#else
-        Task(/* unused */ false);
-#endif
-
-        {
-          // Adjust `ActiveThreads`, in case someone waits on ThreadPool::wait()
-          std::unique_lock<std::mutex> LockGuard(CompletionLock);
-          --ActiveThreads;
+        ThreadPoolTask Task;
+        if (pop(ThreadID, Task)) {
+          runTask(Task);
+          continue;
         }
-
-        // Notify task completion, in case someone waits on ThreadPool::wait()
-        CompletionCondition.notify_all();
+        std::unique_lock<std::mutex> LockGuard(Lock);
+        // Wait for tasks to be pushed in the queues. IdleThreads is updated
+        // before PendingTasks is checked, and push() does the opposite, so
+        // that at least one of them sees the update of the other.
+        ++IdleThreads;
+        WorkCondition.wait(LockGuard,
+                           [&] { return !EnableFlag || PendingTasks; });
+        --IdleThreads;
+        // Exit condition
+        if (!EnableFlag && !PendingTasks)
+          return;
       }
     });
   }
 }
 
+bool ThreadPool::pop(unsigned Index, ThreadPoolTask &Task) {
+  // Take the most recently queued task of our own queue, then the oldest
+  // task queued from outside of the pool, and then steal the oldest task of
+  // the other threads.
+  unsigned NumQueues = Queues.size();
+  unsigned External = NumQueues - 1;
+  auto TryQueue = [&](unsigned I, bool Back) {
+    WorkQueue &Q = *Queues[I];
+    std::lock_guard<std::mutex> LockGuard(Q.Lock);
+    if (Q.Tasks.empty())
+      return false;
+    if (Back) {
+      Task = std::move(Q.Tasks.back());
+      Q.Tasks.pop_back();
+    } else {
+      Task = std::move(Q.Tasks.front());
+      Q.Tasks.pop_front();
+    }
+    // We first need to signal that we are active before decrementing the
+    // number of pending tasks in order for wait() to properly detect that
+    // even if the queues are empty, there is still a task in flight.
+    ++ActiveThreads;
+    --PendingTasks;
+    return true;
+  };
+
+  if (Index != External && TryQueue(Index, /*Back=*/true))
+    return true;
+  if (TryQueue(External, /*Back=*/false))
+    return true;
+  for (unsigned I = 1; I < NumQueues; ++I) {
+    unsigned Victim = (Index + I) % NumQueues;
+    if (Victim != External && TryQueue(Victim, /*Back=*/false))
+      return true;
+  }
+  return false;
+}
+
+void ThreadPool::runTask(ThreadPoolTask &Task) {
+  Task();
+  Task = ThreadPoolTask();
+  --ActiveThreads;
+  // Notify task completion, in case someone waits on ThreadPool::wait() or
+  // on a TaskGroup. Taking the lock makes sure that a waiter which saw the
+  // old state is already waiting on the condition variable.
+  if (CompletionWaiters) {
+    { std::lock_guard<std::mutex> LockGuard(Lock); }
+    CompletionCondition.notify_all();
+  }
+}
+
+bool ThreadPool::runPendingTask() {
+  unsigned Index = CurrentPool == this ? CurrentIndex : Queues.size() - 1;
+  ThreadPoolTask Task;
+  if (!pop(Index, Task))
+    return false;
+  runTask(Task);
+  return true;
+}
+
 void ThreadPool::wait() {
-  // Wait for all threads to complete and the queue to be empty
-  std::unique_lock<std::mutex> LockGuard(CompletionLock);
-  // The order of the checks for ActiveThreads and Tasks.empty() matters because
-  // any active threads might be modifying the Tasks queue, and this would be a
-  // race.
+  assert(CurrentPool != this && "ThreadPool::wait() called from the pool");
+  // Wait for all threads to complete and the queues to be empty
+  std::unique_lock<std::mutex> LockGuard(Lock);
+  ++CompletionWaiters;
+  // The order of the checks for ActiveThreads and PendingTasks matters
+  // because any active threads might be queueing new tasks.
   CompletionCondition.wait(LockGuard,
-                           [&] { return !ActiveThreads && Tasks.empty(); });
+                           [&] { return !ActiveThreads && !PendingTasks; });
+  --CompletionWaiters;
+}
+
+void ThreadPool::push(ThreadPoolTask Task) {
+  // Don't allow enqueueing after disabling the pool
+  assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
+
+  // Count the task before it becomes visible, so that PendingTasks never
+  // drops below the number of tasks in the queues.
+  ++PendingTasks;
+  unsigned Index = CurrentPool == this ? CurrentIndex : Queues.size() - 1;
+  {
+    WorkQueue &Q = *Queues[Index];
+    std::lock_guard<std::mutex> LockGuard(Q.Lock);
+    Q.Tasks.push_back(std::move(Task));
+  }
+
+  // Only take the lock if a thread may be waiting. This is what keeps
+  // queueing cheap when all threads are busy.
+  if (IdleThreads) {
+    { std::lock_guard<std::mutex> LockGuard(Lock); }
+    WorkCondition.notify_one();
+  }
+  // Threads waiting for a task group can run the new task too. This also
+  // avoids a deadlock when every thread of the pool waits for a group.
+  if (GroupWaiters) {
+    { std::lock_guard<std::mutex> LockGuard(Lock); }
+    CompletionCondition.notify_all();
+  }
 }
 
 std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
   /// Wrap the Task in a packaged_task to return a future object.
   PackagedTaskTy PackagedTask(std::move(Task));
   auto Future = PackagedTask.get_future();
-  {
-    // Lock the queue and push the new task
-    std::unique_lock<std::mutex> LockGuard(QueueLock);
-
-    // Don't allow enqueueing after disabling the pool
-    assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
-
-    Tasks.push(std::move(PackagedTask));
-  }
-  QueueCondition.notify_one();
+  push(PackagedTaskRunner{std::move(PackagedTask)});
   return Future.share();
 }
 
 // The destructor joins all threads, waiting for completion.
 ThreadPool::~ThreadPool() {
   {
-    std::unique_lock<std::mutex> LockGuard(QueueLock);
+    std::unique_lock<std::mutex> LockGuard(Lock);
     EnableFlag = false;
   }
-  QueueCondition.notify_all();
+  WorkCondition.notify_all();
   for (auto &Worker : Threads)
     Worker.join();
 }
 
+void TaskGroup::wait() {
+  while (Pending) {
+    // Help the pool instead of blocking, so that a thread of the pool can
+    // wait for a group without starving the tasks of that group.
+    if (Pool.runPendingTask())
+      continue;
+    std::unique_lock<std::mutex> LockGuard(Pool.Lock);
+    ++Pool.GroupWaiters;
+    ++Pool.CompletionWaiters;
+    Pool.CompletionCondition.wait(
+        LockGuard, [&] { return !Pending || Pool.PendingTasks; });
+    --Pool.CompletionWaiters;
+    --Pool.GroupWaiters;
+  }
+}
+
 #else // LLVM_ENABLE_THREADS Disabled
 
 ThreadPool::ThreadPool() : ThreadPool(0) {}
 
 // No threads are launched, issue a warning if ThreadCount is not 0
 ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0) {
+    : PendingTasks(0), ActiveThreads(0), IdleThreads(0), CompletionWaiters(0),
+      GroupWaiters(0) {
   if (ThreadCount) {
     errs() << "Warning: request a ThreadPool with " << ThreadCount
            << " threads, but LLVM_ENABLE_THREADS has been turned off\n";
   }
+  Queues.emplace_back(new WorkQueue);
+}
+
+bool ThreadPool::pop(unsigned Index, ThreadPoolTask &Task) {
+  std::deque<ThreadPoolTask> &Tasks = Queues[0]->Tasks;
+  if (Tasks.empty())
+    return false;
+  Task = std::move(Tasks.front());
+  Tasks.pop_front();
+  --PendingTasks;
+  return true;
+}
+
+void ThreadPool::runTask(ThreadPoolTask &Task) { Task(); }
+
+bool ThreadPool::runPendingTask() {
+  ThreadPoolTask Task;
+  if (!pop(0, Task))
+    return false;
+  runTask(Task);
+  return true;
 }
 
 void ThreadPool::wait() {
   // Sequential implementation running the tasks
-  while (!Tasks.empty()) {
-    auto Task = std::move(Tasks.front());
-    Tasks.pop();
-#ifndef _MSC_VER
-        Task();
-#else
-        Task(/* unused */ false);
-#endif
-  }
+  while (runPendingTask())
+    ;
+}
+
+void ThreadPool::push(ThreadPoolTask Task) {
+  Queues[0]->Tasks.push_back(std::move(Task));
+  ++PendingTasks;
 }
 
 std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
@@ -147,7 +272,7 @@ std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
   auto Future = std::async(std::launch::deferred, std::move(Task), false).share();
   PackagedTaskTy PackagedTask([Future](bool) -> bool { Future.get(); return false; });
 #endif
-  Tasks.push(std::move(PackagedTask));
+  push(PackagedTaskRunner{std::move(PackagedTask)});
   return Future;
 }
 
@@ -155,4 +280,9 @@ ThreadPool::~ThreadPool() {
   wait();
 }
 
+void TaskGroup::wait() {
+  while (Pending && Pool.runPendingTask())
+    ;
+}
+
 #endif
@@ -0,0 +1,205 @@
+//===-- TraceEvents.cpp - Trace event recording ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the recording of trace events and their output in the
+// Chrome trace event JSON format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TraceEvents.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::trace;
+
+static cl::opt<std::string>
+    TraceFile("trace-events-file", cl::value_desc("filename"),
+              cl::desc("Record pass and analysis trace events and write them "
+                       "to this file in the Chrome trace event format"));
+
+static cl::opt<unsigned>
+    SampleRate("trace-events-sample-rate", cl::init(1),
+               cl::desc("Only record trace events in one process out of "
+                        "this many"));
+
+static cl::opt<unsigned>
+    MinDuration("trace-events-min-us", cl::init(0),
+                cl::desc("Drop the trace scopes which are shorter than this "
+                         "many microseconds"));
+
+std::atomic<trace::detail::StateTy>
+    trace::detail::State(trace::detail::Uninitialized);
+
+namespace {
+struct Event {
+  const char *Category;
+  char Phase;
+  std::string Name;
+  std::string Detail;
+  uint64_t Start;
+  uint64_t Duration;
+};
+
+/// The events of one thread. Each thread appends to its own buffer, so that
+/// recording an event doesn't need a lock.
+struct ThreadBuffer {
+  unsigned Tid;
+  std::vector<Event> Events;
+};
+
+/// The events of all the threads. This is used in a ManagedStatic and the
+/// trace is written by its destructor.
+class TraceState {
+  std::chrono::steady_clock::time_point Epoch;
+  sys::SmartMutex<true> Lock;
+  std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+
+public:
+  TraceState();
+  ~TraceState();
+
+  /// Returns the time since the start of the trace in microseconds.
+  uint64_t now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - Epoch)
+        .count();
+  }
+
+  ThreadBuffer &getThreadBuffer();
+  void write(raw_ostream &OS);
+};
+} // end anonymous namespace
+
+static ManagedStatic<TraceState> TheTrace;
+static LLVM_THREAD_LOCAL ThreadBuffer *CurrentBuffer;
+
+TraceState::TraceState() : Epoch(std::chrono::steady_clock::now()) {
+  // Ensure the statistics are created first so they are destructed after us
+  // and can be written to the trace.
+  (void)GetStatistics();
+}
+
+TraceState::~TraceState() {
+  if (TraceFile.empty() || trace::detail::State != trace::detail::Enabled)
+    return;
+  std::error_code EC;
+  raw_fd_ostream OS(TraceFile, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << "error: could not open trace events file '" << TraceFile
+           << "': " << EC.message() << '\n';
+    return;
+  }
+  write(OS);
+}
+
+ThreadBuffer &TraceState::getThreadBuffer() {
+  if (CurrentBuffer)
+    return *CurrentBuffer;
+  sys::SmartScopedLock<true> Guard(Lock);
+  Buffers.push_back(make_unique<ThreadBuffer>());
+  Buffers.back()->Tid = Buffers.size() - 1;
+  CurrentBuffer = Buffers.back().get();
+  return *CurrentBuffer;
+}
+
+static void writeEscaped(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (unsigned char C : Str) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void TraceState::write(raw_ostream &OS) {
+  sys::SmartScopedLock<true> Guard(Lock);
+  OS << "{\"traceEvents\":[";
+  const char *Delim = "\n";
+  for (const auto &Buffer : Buffers) {
+    for (const Event &E : Buffer->Events) {
+      OS << Delim << "{\"cat\":\"" << E.Category << "\",\"name\":";
+      writeEscaped(OS, E.Name);
+      OS << ",\"ph\":\"" << E.Phase << "\",\"pid\":1,\"tid\":" << Buffer->Tid
+         << ",\"ts\":" << E.Start;
+      if (E.Phase == 'X')
+        OS << ",\"dur\":" << E.Duration;
+      else
+        OS << ",\"s\":\"t\"";
+      OS << ",\"args\":{\"detail\":";
+      writeEscaped(OS, E.Detail);
+      OS << "}}";
+      Delim = ",\n";
+    }
+  }
+
+  // The statistics are counters whose value is known at the end of the trace.
+  uint64_t End = now();
+  for (const auto &Stat : GetStatistics()) {
+    OS << Delim << "{\"cat\":\"statistic\",\"name\":";
+    writeEscaped(OS, Stat.first);
+    OS << ",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << End
+       << ",\"args\":{\"value\":" << Stat.second << "}}";
+    Delim = ",\n";
+  }
+  OS << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool trace::detail::initialize() {
+  // Sampling is decided once per process, the first time an instrumentation
+  // point is reached, which is after the command line has been parsed.
+  StateTy Desired = Disabled;
+  if (!TraceFile.empty() &&
+      (SampleRate <= 1 || sys::Process::GetRandomNumber() % SampleRate == 0)) {
+    (void)*TheTrace;
+    Desired = Enabled;
+  }
+  StateTy Expected = Uninitialized;
+  State.compare_exchange_strong(Expected, Desired);
+  return State.load() == Enabled;
+}
+
+void Scope::begin(const char *Category, StringRef Name, StringRef Detail) {
+  this->Category = Category;
+  this->Name = Name;
+  this->Detail = Detail;
+  Start = TheTrace->now();
+}
+
+void Scope::end() {
+  uint64_t Duration = TheTrace->now() - Start;
+  if (Duration < MinDuration)
+    return;
+  TheTrace->getThreadBuffer().Events.push_back(
+      {Category, 'X', std::move(Name), std::move(Detail), Start, Duration});
+}
+
+void trace::recordInstant(const char *Category, StringRef Name,
+                          StringRef Detail) {
+  if (!isEnabled())
+    return;
+  TheTrace->getThreadBuffer().Events.push_back(
+      {Category, 'i', Name, Detail, TheTrace->now(), 0});
+}
+
+void trace::write(raw_ostream &OS) { TheTrace->write(OS); }
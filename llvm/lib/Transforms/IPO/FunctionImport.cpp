@@ -13,11 +13,13 @@
 
 #include "llvm/Transforms/IPO/FunctionImport.h"
 
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/AutoUpgrade.h"
+#include "llvm/IR/CompactSummaryIndex.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
@@ -29,6 +31,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 
@@ -239,6 +242,23 @@ static const GlobalValueSummary *selectCallee(GlobalValue::GUID GUID,
 using EdgeInfo = std::tuple<const FunctionSummary *, unsigned /* Threshold */,
                             GlobalValue::GUID>;
 
+static float getBonusMultiplier(CalleeInfo::HotnessType Hotness) {
+  if (Hotness == CalleeInfo::HotnessType::Hot)
+    return ImportHotMultiplier;
+  if (Hotness == CalleeInfo::HotnessType::Cold)
+    return ImportColdMultiplier;
+  return 1.0;
+}
+
+static float getAdjustedThreshold(unsigned Threshold, bool IsHotCallsite) {
+  // Adjust the threshold for next level of imported functions.
+  // The threshold is different for hot callsites because we can then
+  // inline chains of hot calls.
+  if (IsHotCallsite)
+    return Threshold * ImportHotInstrFactor;
+  return Threshold * ImportInstrFactor;
+}
+
 /// Compute the list of functions to import for a given caller. Mark these
 /// imported functions and the symbols they reference in their source module as
 /// exported from their source module.
@@ -257,16 +277,8 @@ static void computeImportForFunction(
       continue;
     }
 
-    auto GetBonusMultiplier = [](CalleeInfo::HotnessType Hotness) -> float {
-      if (Hotness == CalleeInfo::HotnessType::Hot)
-        return ImportHotMultiplier;
-      if (Hotness == CalleeInfo::HotnessType::Cold)
-        return ImportColdMultiplier;
-      return 1.0;
-    };
-
     const auto NewThreshold =
-        Threshold * GetBonusMultiplier(Edge.second.Hotness);
+        Threshold * getBonusMultiplier(Edge.second.Hotness);
 
     auto *CalleeSummary = selectCallee(GUID, NewThreshold, Index);
     if (!CalleeSummary) {
@@ -287,17 +299,8 @@ static void computeImportForFunction(
     assert(ResolvedCalleeSummary->instCount() <= NewThreshold &&
            "selectCallee() didn't honor the threshold");
 
-    auto GetAdjustedThreshold = [](unsigned Threshold, bool IsHotCallsite) {
-      // Adjust the threshold for next level of imported functions.
-      // The threshold is different for hot callsites because we can then
-      // inline chains of hot calls.
-      if (IsHotCallsite)
-        return Threshold * ImportHotInstrFactor;
-      return Threshold * ImportInstrFactor;
-    };
-
     bool IsHotCallsite = Edge.second.Hotness == CalleeInfo::HotnessType::Hot;
-    const auto AdjThreshold = GetAdjustedThreshold(Threshold, IsHotCallsite);
+    const auto AdjThreshold = getAdjustedThreshold(Threshold, IsHotCallsite);
 
     auto ExportModulePath = ResolvedCalleeSummary->modulePath();
     auto &ProcessedThreshold = ImportList[ExportModulePath][GUID];
@@ -388,35 +391,64 @@ static void ComputeImportForModule(
 
 } // anonymous namespace
 
+/// When computing imports we added all GUIDs referenced by anything imported
+/// from a module to its ExportList. Prune each ExportList of any not defined
+/// in that module. This is more efficient than checking while computing
+/// imports because some of the summary lists may be long due to linkonce
+/// (comdat) copies.
+static void
+pruneExportLists(StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+                 const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries) {
+  for (auto &ELI : ExportLists) {
+    auto DefinedGVSummaries = ModuleToDefinedGVSummaries.find(ELI.first());
+    if (DefinedGVSummaries == ModuleToDefinedGVSummaries.end()) {
+      ELI.second.clear();
+      continue;
+    }
+    for (auto EI = ELI.second.begin(); EI != ELI.second.end();) {
+      if (!DefinedGVSummaries->second.count(*EI))
+        EI = ELI.second.erase(EI);
+      else
+        ++EI;
+    }
+  }
+}
+
 /// Compute all the import and export for every module using the Index.
 void llvm::ComputeCrossModuleImport(
     const ModuleSummaryIndex &Index,
     const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
-    StringMap<FunctionImporter::ExportSetTy> &ExportLists) {
-  // For each module that has function defined, compute the import/export lists.
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    ThreadPool *Pool) {
+  // Create the import list of every module up front, so that the threads
+  // below only access their own list.
+  std::vector<const StringMapEntry<GVSummaryMapTy> *> Modules;
+  std::vector<FunctionImporter::ImportMapTy *> ModuleImportLists;
   for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
-    auto &ImportList = ImportLists[DefinedGVSummaries.first()];
-    DEBUG(dbgs() << "Computing import for Module '"
-                 << DefinedGVSummaries.first() << "'\n");
-    ComputeImportForModule(DefinedGVSummaries.second, Index, ImportList,
-                           &ExportLists);
+    Modules.push_back(&DefinedGVSummaries);
+    ModuleImportLists.push_back(&ImportLists[DefinedGVSummaries.first()]);
   }
 
-  // When computing imports we added all GUIDs referenced by anything
-  // imported from the module to its ExportList. Now we prune each ExportList
-  // of any not defined in that module. This is more efficient than checking
-  // while computing imports because some of the summary lists may be long
-  // due to linkonce (comdat) copies.
-  for (auto &ELI : ExportLists) {
-    const auto &DefinedGVSummaries =
-        ModuleToDefinedGVSummaries.lookup(ELI.first());
-    for (auto EI = ELI.second.begin(); EI != ELI.second.end();) {
-      if (!DefinedGVSummaries.count(*EI))
-        EI = ELI.second.erase(EI);
-      else
-        ++EI;
-    }
+  // For each module that has function defined, compute the import/export
+  // lists. The exports caused by the imports of a module are collected and
+  // pruned separately and merged in module order afterwards, so that the
+  // result doesn't depend on the number of threads.
+  std::vector<StringMap<FunctionImporter::ExportSetTy>> ModuleExportLists(
+      Modules.size());
+  parallelFor(Pool, 0, Modules.size(), [&](size_t I) {
+    DEBUG(dbgs() << "Computing import for Module '" << Modules[I]->first()
+                 << "'\n");
+    ComputeImportForModule(Modules[I]->second, Index, *ModuleImportLists[I],
+                           &ModuleExportLists[I]);
+    pruneExportLists(ModuleExportLists[I], ModuleToDefinedGVSummaries);
+  });
+
+  for (auto &ModuleExports : ModuleExportLists) {
+    for (auto &ELI : ModuleExports)
+      ExportLists[ELI.first()].insert(ELI.second.begin(), ELI.second.end());
+    // Release the memory early, there is one map per module.
+    ModuleExports.clear();
   }
 
 #ifndef NDEBUG
@@ -437,6 +469,218 @@ void llvm::ComputeCrossModuleImport(
 #endif
 }
 
+namespace {
+// The import computation above, on a CompactSummaryIndex. Summaries, GUIDs and
+// modules are the indices of the compact index; the results use the GUIDs and
+// module paths, like the ones computed from a ModuleSummaryIndex.
+
+static bool canBeExternallyReferenced(const CompactSummaryIndex &Index,
+                                      unsigned S) {
+  if (!GlobalValue::isLocalLinkage(Index.getLinkage(S)))
+    return true;
+  // Can't externally reference a global that needs renaming if has a section
+  // or is referenced from inline assembly, for example.
+  return !Index.getFlags(S).NoRename;
+}
+
+static bool canBeExternallyReferencedGUID(const CompactSummaryIndex &Index,
+                                          unsigned G) {
+  // If there are multiple globals with this GUID, then we know it is not a
+  // local symbol, and it is necessarily externally referenced.
+  if (Index.summary_end(G) - Index.summary_begin(G) != 1)
+    return true;
+  return canBeExternallyReferenced(Index, Index.summary_begin(G));
+}
+
+static bool eligibleForImport(const CompactSummaryIndex &Index, unsigned S) {
+  if (!canBeExternallyReferenced(Index, S))
+    return false;
+  GlobalValueSummary::GVFlags Flags = Index.getFlags(S);
+  if (Flags.IsNotViableToInline || Flags.HasInlineAsmMaybeReferencingInternal)
+    return false;
+  for (unsigned R = Index.ref_begin(S), E = Index.ref_end(S); R != E; ++R)
+    if (!canBeExternallyReferencedGUID(Index, Index.getRef(R)))
+      return false;
+  for (unsigned C = Index.call_begin(S), E = Index.call_end(S); C != E; ++C)
+    if (!canBeExternallyReferencedGUID(Index, Index.getCallee(C)))
+      return false;
+  return true;
+}
+
+/// Returns the function summary, with aliases resolved, of the first callee
+/// implementation of GUID \p G which fits the \p Threshold, or None.
+static Optional<unsigned> selectCallee(const CompactSummaryIndex &Index,
+                                       unsigned G, unsigned Threshold) {
+  for (unsigned S = Index.summary_begin(G), E = Index.summary_end(G); S != E;
+       ++S) {
+    // There is no point in importing these, we can't inline them.
+    if (GlobalValue::isInterposableLinkage(Index.getLinkage(S)))
+      continue;
+    unsigned FS = S;
+    if (Index.getSummaryKind(S) == GlobalValueSummary::AliasKind) {
+      FS = Index.getAliasee(S);
+      // See selectCallee() above: only linkonce_odr aliasees are imported.
+      if (!GlobalValue::isLinkOnceODRLinkage(Index.getLinkage(FS)))
+        continue;
+    }
+    assert(Index.getSummaryKind(FS) == GlobalValueSummary::FunctionKind &&
+           "Expected a function summary for a callee");
+    if (Index.getInstCount(FS) > Threshold || !eligibleForImport(Index, FS))
+      continue;
+    return FS;
+  }
+  return None;
+}
+
+class CompactImportComputer {
+public:
+  CompactImportComputer(const CompactSummaryIndex &Index,
+                        FunctionImporter::ImportMapTy &ImportList,
+                        StringMap<FunctionImporter::ExportSetTy> &ExportLists)
+      : Index(Index), ImportList(ImportList), ExportLists(ExportLists) {}
+
+  void computeImportForModule(unsigned M);
+
+private:
+  void computeImportForFunction(unsigned S, unsigned Threshold);
+
+  const CompactSummaryIndex &Index;
+  FunctionImporter::ImportMapTy &ImportList;
+  StringMap<FunctionImporter::ExportSetTy> &ExportLists;
+  /// The GUID indices of the globals defined in the destination module.
+  DenseSet<unsigned> Defined;
+  /// Function summary, threshold and GUID index of the imported functions
+  /// whose callees remain to be analyzed.
+  SmallVector<std::tuple<unsigned, unsigned, unsigned>, 128> Worklist;
+};
+} // anonymous namespace
+
+void CompactImportComputer::computeImportForFunction(unsigned S,
+                                                     unsigned Threshold) {
+  for (unsigned C = Index.call_begin(S), E = Index.call_end(S); C != E; ++C) {
+    unsigned G = Index.getCallee(C);
+    if (Defined.count(G))
+      continue;
+
+    const auto NewThreshold =
+        Threshold * getBonusMultiplier(Index.getHotness(C));
+    Optional<unsigned> Callee = selectCallee(Index, G, NewThreshold);
+    if (!Callee)
+      continue;
+
+    bool IsHotCallsite = Index.getHotness(C) == CalleeInfo::HotnessType::Hot;
+    const auto AdjThreshold = getAdjustedThreshold(Threshold, IsHotCallsite);
+
+    StringRef ExportModulePath = Index.getModulePath(Index.getModule(*Callee));
+    auto &ProcessedThreshold = ImportList[ExportModulePath][Index.getGUID(G)];
+    if (ProcessedThreshold && ProcessedThreshold >= AdjThreshold)
+      continue;
+    bool PreviouslyImported = ProcessedThreshold != 0;
+    ProcessedThreshold = AdjThreshold;
+
+    // Make exports in the source module, they are pruned later.
+    auto &ExportList = ExportLists[ExportModulePath];
+    ExportList.insert(Index.getGUID(G));
+    if (!PreviouslyImported) {
+      for (unsigned CC = Index.call_begin(*Callee),
+                    CE = Index.call_end(*Callee);
+           CC != CE; ++CC)
+        ExportList.insert(Index.getGUID(Index.getCallee(CC)));
+      for (unsigned R = Index.ref_begin(*Callee), RE = Index.ref_end(*Callee);
+           R != RE; ++R)
+        ExportList.insert(Index.getGUID(Index.getRef(R)));
+    }
+
+    Worklist.emplace_back(*Callee, AdjThreshold, G);
+  }
+}
+
+void CompactImportComputer::computeImportForModule(unsigned M) {
+  for (unsigned I = Index.module_summary_begin(M),
+                E = Index.module_summary_end(M);
+       I != E; ++I)
+    Defined.insert(Index.getGUIDIndex(Index.getModuleSummary(I)));
+
+  for (unsigned I = Index.module_summary_begin(M),
+                E = Index.module_summary_end(M);
+       I != E; ++I) {
+    unsigned S = Index.getModuleSummary(I);
+    if (Index.getSummaryKind(S) == GlobalValueSummary::AliasKind)
+      S = Index.getAliasee(S);
+    // Skip import for global variables
+    if (Index.getSummaryKind(S) != GlobalValueSummary::FunctionKind)
+      continue;
+    computeImportForFunction(S, ImportInstrLimit);
+  }
+
+  while (!Worklist.empty()) {
+    unsigned S, Threshold, G;
+    std::tie(S, Threshold, G) = Worklist.pop_back_val();
+    // Check if we later added this summary with a higher threshold.
+    StringRef ExportModulePath = Index.getModulePath(Index.getModule(S));
+    if (ImportList[ExportModulePath][Index.getGUID(G)] > Threshold)
+      continue;
+    computeImportForFunction(S, Threshold);
+  }
+}
+
+/// Returns true if the GUID \p GUID has a summary in module \p M.
+static bool isDefinedInModule(const CompactSummaryIndex &Index,
+                              GlobalValue::GUID GUID, unsigned M) {
+  Optional<unsigned> G = Index.findGUID(GUID);
+  if (!G)
+    return false;
+  for (unsigned S = Index.summary_begin(*G), E = Index.summary_end(*G); S != E;
+       ++S)
+    if (Index.getModule(S) == M)
+      return true;
+  return false;
+}
+
+void llvm::ComputeCrossModuleImport(
+    const CompactSummaryIndex &Index,
+    StringMap<FunctionImporter::ImportMapTy> &ImportLists,
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    ThreadPool *Pool) {
+  // Like collectDefinedGVSummariesPerModule(), only the modules which define
+  // something get an import list.
+  std::vector<unsigned> Modules;
+  std::vector<FunctionImporter::ImportMapTy *> ModuleImportLists;
+  StringMap<unsigned> ModuleIndices;
+  for (unsigned M = 0, E = Index.getNumModules(); M != E; ++M) {
+    ModuleIndices[Index.getModulePath(M)] = M;
+    if (Index.module_summary_begin(M) == Index.module_summary_end(M))
+      continue;
+    Modules.push_back(M);
+    ModuleImportLists.push_back(&ImportLists[Index.getModulePath(M)]);
+  }
+
+  std::vector<StringMap<FunctionImporter::ExportSetTy>> ModuleExportLists(
+      Modules.size());
+  parallelFor(Pool, 0, Modules.size(), [&](size_t I) {
+    DEBUG(dbgs() << "Computing import for Module '"
+                 << Index.getModulePath(Modules[I]) << "'\n");
+    CompactImportComputer(Index, *ModuleImportLists[I], ModuleExportLists[I])
+        .computeImportForModule(Modules[I]);
+    // Prune the exports which are not defined in their module.
+    for (auto &ELI : ModuleExportLists[I]) {
+      unsigned M = ModuleIndices.lookup(ELI.first());
+      for (auto EI = ELI.second.begin(); EI != ELI.second.end();) {
+        if (!isDefinedInModule(Index, *EI, M))
+          EI = ELI.second.erase(EI);
+        else
+          ++EI;
+      }
+    }
+  });
+
+  for (auto &ModuleExports : ModuleExportLists) {
+    for (auto &ELI : ModuleExports)
+      ExportLists[ELI.first()].insert(ELI.second.begin(), ELI.second.end());
+    ModuleExports.clear();
+  }
+}
+
 /// Compute all the imports for the given module in the Index.
 void llvm::ComputeCrossModuleImportForModule(
     StringRef ModulePath, const ModuleSummaryIndex &Index,
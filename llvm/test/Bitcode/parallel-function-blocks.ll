@@ -0,0 +1,77 @@
+; The function blocks written in parallel must give the same bitcode as the
+; serial writer, including the function offsets of the VST.
+; RUN: llvm-as < %s > %t.serial.bc
+; RUN: llvm-as -bitcode-writer-threads=3 < %s > %t.parallel.bc
+; RUN: diff %t.serial.bc %t.parallel.bc
+; RUN: llvm-dis < %t.parallel.bc | FileCheck %s
+
+; RUN: opt -module-summary %s -o %t.serial.summary.bc
+; RUN: opt -module-summary -bitcode-writer-threads=8 %s -o %t.parallel.summary.bc
+; RUN: diff %t.serial.summary.bc %t.parallel.summary.bc
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@g = global i32 0
+
+declare void @ext(i8*)
+
+; CHECK: define i32 @f1(i32 %x)
+define i32 @f1(i32 %x) !dbg !6 {
+entry:
+  %add = add nsw i32 %x, 1, !dbg !9
+  call void @llvm.dbg.value(metadata i32 %add, i64 0, metadata !10, metadata !12), !dbg !9
+  ret i32 %add, !dbg !9
+}
+
+; CHECK: define void @f2(i1 %c)
+define void @f2(i1 %c) {
+entry:
+  br i1 %c, label %a, label %b
+a:
+  call void @ext(i8* blockaddress(@f2, %b))
+  br label %b
+b:
+  store i32 7, i32* @g, !tbaa !13
+  ret void
+}
+
+; CHECK: define i32 @f3()
+define i32 @f3() {
+  %v = load i32, i32* @g
+  %r = call i32 @f1(i32 %v)
+  ret i32 %r
+}
+
+; CHECK: define internal float @f4(float %a, float %b)
+define internal float @f4(float %a, float %b) {
+  %m = fmul fast float %a, %b
+  %s = fadd float %m, 1.000000e+00
+  ret float %s
+}
+
+; CHECK: define void @f5()
+define void @f5() {
+  call void @f2(i1 true)
+  ret void
+}
+
+declare void @llvm.dbg.value(metadata, i64, metadata, metadata)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !DISubroutineType(types: !2)
+!6 = distinct !DISubprogram(name: "f1", scope: !1, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, variables: !2)
+!9 = !DILocation(line: 2, column: 3, scope: !6)
+!10 = !DILocalVariable(name: "y", scope: !6, file: !1, line: 2, type: !11)
+!11 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!12 = !DIExpression()
+!13 = !{!14, !14, i64 0}
+!14 = !{!"int", !15, i64 0}
+!15 = !{!"tbaa root"}
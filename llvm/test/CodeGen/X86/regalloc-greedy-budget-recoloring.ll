@@ -0,0 +1,19 @@
+; RUN: not llc < %s -mtriple=i386-unknown-linux-gnu \
+; RUN:   -regalloc-greedy-budget=1 -o /dev/null 2>&1 | FileCheck %s
+; RUN: not llc < %s -mtriple=i386-unknown-linux-gnu -o /dev/null 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=UNDER
+
+; Over its budget, the greedy register allocator doesn't try last chance
+; recoloring and says why the allocation failed.
+
+; CHECK: error: register allocation failed: the budget of the function was exceeded before recoloring
+; UNDER-NOT: budget
+; UNDER: error: inline assembly requires more registers than available
+
+define void @f(i32 %a, i32 %b, i32 %c, i32 %d, i32 %e, i32 %f, i32 %g,
+               i32 %h) {
+  call void asm sideeffect "", "r,r,r,r,r,r,r,r"(i32 %a, i32 %b, i32 %c,
+                                                 i32 %d, i32 %e, i32 %f,
+                                                 i32 %g, i32 %h)
+  ret void
+}
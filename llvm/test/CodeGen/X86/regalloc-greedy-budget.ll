@@ -0,0 +1,144 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -regalloc-greedy-budget=1 -o %t.s 2>&1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -regalloc-greedy-budget=1000000 -o %t.s 2>&1 | FileCheck %s -check-prefix=UNDER --allow-empty
+
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -regalloc-greedy-budget=420 -stop-after=greedy -o - 2>/dev/null \
+; RUN:   | FileCheck %s -check-prefix=NOSPLIT
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -stop-after=greedy -o - | FileCheck %s -check-prefix=SPLIT
+
+; Over its budget, the greedy register allocator says so and spills the live
+; ranges it can't assign instead of splitting them.
+
+; CHECK: remark: <unknown>:0:0: register allocation of pressure exceeded its budget of 1 work units; the remaining live ranges are spilled instead of split
+; UNDER-NOT: remark
+
+define i32 @pressure(i32* %p) {
+entry:
+  %a0 = getelementptr i32, i32* %p, i64 0
+  %v0 = load volatile i32, i32* %a0
+  %a1 = getelementptr i32, i32* %p, i64 1
+  %v1 = load volatile i32, i32* %a1
+  %a2 = getelementptr i32, i32* %p, i64 2
+  %v2 = load volatile i32, i32* %a2
+  %a3 = getelementptr i32, i32* %p, i64 3
+  %v3 = load volatile i32, i32* %a3
+  %a4 = getelementptr i32, i32* %p, i64 4
+  %v4 = load volatile i32, i32* %a4
+  %a5 = getelementptr i32, i32* %p, i64 5
+  %v5 = load volatile i32, i32* %a5
+  %a6 = getelementptr i32, i32* %p, i64 6
+  %v6 = load volatile i32, i32* %a6
+  %a7 = getelementptr i32, i32* %p, i64 7
+  %v7 = load volatile i32, i32* %a7
+  %a8 = getelementptr i32, i32* %p, i64 8
+  %v8 = load volatile i32, i32* %a8
+  %a9 = getelementptr i32, i32* %p, i64 9
+  %v9 = load volatile i32, i32* %a9
+  %a10 = getelementptr i32, i32* %p, i64 10
+  %v10 = load volatile i32, i32* %a10
+  %a11 = getelementptr i32, i32* %p, i64 11
+  %v11 = load volatile i32, i32* %a11
+  %a12 = getelementptr i32, i32* %p, i64 12
+  %v12 = load volatile i32, i32* %a12
+  %a13 = getelementptr i32, i32* %p, i64 13
+  %v13 = load volatile i32, i32* %a13
+  %a14 = getelementptr i32, i32* %p, i64 14
+  %v14 = load volatile i32, i32* %a14
+  %a15 = getelementptr i32, i32* %p, i64 15
+  %v15 = load volatile i32, i32* %a15
+  %a16 = getelementptr i32, i32* %p, i64 16
+  %v16 = load volatile i32, i32* %a16
+  %a17 = getelementptr i32, i32* %p, i64 17
+  %v17 = load volatile i32, i32* %a17
+  %a18 = getelementptr i32, i32* %p, i64 18
+  %v18 = load volatile i32, i32* %a18
+  %a19 = getelementptr i32, i32* %p, i64 19
+  %v19 = load volatile i32, i32* %a19
+  %a20 = getelementptr i32, i32* %p, i64 20
+  %v20 = load volatile i32, i32* %a20
+  %a21 = getelementptr i32, i32* %p, i64 21
+  %v21 = load volatile i32, i32* %a21
+  %a22 = getelementptr i32, i32* %p, i64 22
+  %v22 = load volatile i32, i32* %a22
+  %a23 = getelementptr i32, i32* %p, i64 23
+  %v23 = load volatile i32, i32* %a23
+  %s22 = mul i32 %v23, %v22
+  %s21 = mul i32 %s22, %v21
+  %s20 = mul i32 %s21, %v20
+  %s19 = mul i32 %s20, %v19
+  %s18 = mul i32 %s19, %v18
+  %s17 = mul i32 %s18, %v17
+  %s16 = mul i32 %s17, %v16
+  %s15 = mul i32 %s16, %v15
+  %s14 = mul i32 %s15, %v14
+  %s13 = mul i32 %s14, %v13
+  %s12 = mul i32 %s13, %v12
+  %s11 = mul i32 %s12, %v11
+  %s10 = mul i32 %s11, %v10
+  %s9 = mul i32 %s10, %v9
+  %s8 = mul i32 %s9, %v8
+  %s7 = mul i32 %s8, %v7
+  %s6 = mul i32 %s7, %v6
+  %s5 = mul i32 %s6, %v5
+  %s4 = mul i32 %s5, %v4
+  %s3 = mul i32 %s4, %v3
+  %s2 = mul i32 %s3, %v2
+  %s1 = mul i32 %s2, %v1
+  %s0 = mul i32 %s1, %v0
+  ret i32 %s0
+}
+
+; %n is live across the call in the loop, and all callee-saved registers are
+; taken. Within the budget, it is split around the call. A budget of 420 runs
+; out during the split search for %n; the search is cut short and no copies
+; are inserted for splitting.
+
+; SPLIT-LABEL: name: split
+; SPLIT: bb.2.cold:
+; SPLIT: %{{[0-9]+}} = COPY %{{[0-9]+}}
+; SPLIT-NEXT: CALL64pcrel32 @g
+
+; NOSPLIT-LABEL: name: split
+; NOSPLIT-NOT: %{{[0-9]+}} = COPY %{{[0-9]+}}
+; NOSPLIT: RET
+
+declare void @g()
+
+define i32 @split(i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %latch ]
+  %odd = and i32 %i, 7
+  %c = icmp eq i32 %odd, 0
+  br i1 %c, label %cold, label %hot
+
+cold:
+  call void @g()
+  br label %latch
+
+hot:
+  %h0 = mul i32 %acc, %a0
+  %h1 = mul i32 %h0, %a1
+  %h2 = mul i32 %h1, %a2
+  %h3 = mul i32 %h2, %a3
+  %h4 = mul i32 %h3, %a4
+  %h5 = mul i32 %h4, %a5
+  %h6 = mul i32 %h5, %a6
+  %h7 = mul i32 %h6, %a7
+  br label %latch
+
+latch:
+  %acc.next = phi i32 [ %acc, %cold ], [ %h7, %hot ]
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret i32 %acc.next
+}
@@ -0,0 +1,91 @@
+; RUN: llc -O0 %s -mtriple=x86_64-unknown-linux-gnu -filetype=obj -o %t.serial
+; RUN: llc -O0 %s -mtriple=x86_64-unknown-linux-gnu -filetype=obj -o %t.parallel \
+; RUN:   -dwarf-layout-threads=3
+; RUN: cmp %t.serial %t.parallel
+; RUN: llvm-dwarfdump -debug-dump=info %t.parallel | FileCheck %s
+; RUN: llc -O0 %s -mtriple=x86_64-unknown-linux-gnu -filetype=obj \
+; RUN:   -split-dwarf=Enable -o %t.split.serial
+; RUN: llc -O0 %s -mtriple=x86_64-unknown-linux-gnu -filetype=obj \
+; RUN:   -split-dwarf=Enable -o %t.split.parallel -dwarf-layout-threads=3
+; RUN: cmp %t.split.serial %t.split.parallel
+; RUN: llvm-dwarfdump -debug-dump=all %t.split.parallel \
+; RUN:   | FileCheck -check-prefix=SPLIT %s
+
+; The units are laid out concurrently, and their abbreviations are numbered
+; as if they were laid out one after the other, so the objects are identical.
+
+; CHECK: DW_TAG_compile_unit
+; CHECK:   DW_AT_name {{.*}} "a.c"
+; CHECK:   DW_TAG_subprogram
+; CHECK: DW_TAG_compile_unit
+; CHECK:   DW_AT_name {{.*}} "b.c"
+; CHECK:   DW_TAG_variable
+; CHECK:   DW_TAG_structure_type
+; CHECK:     DW_TAG_member
+; CHECK: DW_TAG_compile_unit
+; CHECK:   DW_AT_name {{.*}} "c.c"
+; CHECK:   DW_TAG_subprogram
+; CHECK:     DW_TAG_formal_parameter
+
+; The DWO IDs are computed concurrently too.
+
+; SPLIT: .debug_info contents:
+; SPLIT: DW_TAG_compile_unit
+; SPLIT:   DW_AT_GNU_dwo_id [DW_FORM_data8] ([[A:0x[0-9a-f]+]])
+; SPLIT: DW_TAG_compile_unit
+; SPLIT:   DW_AT_GNU_dwo_id [DW_FORM_data8] ([[B:0x[0-9a-f]+]])
+; SPLIT: DW_TAG_compile_unit
+; SPLIT:   DW_AT_GNU_dwo_id [DW_FORM_data8] ([[C:0x[0-9a-f]+]])
+; SPLIT: .debug_info.dwo contents:
+; SPLIT: DW_TAG_compile_unit
+; SPLIT:   DW_AT_GNU_dwo_id [DW_FORM_data8] ([[A]])
+; SPLIT: DW_TAG_compile_unit
+; SPLIT:   DW_AT_GNU_dwo_id [DW_FORM_data8] ([[B]])
+; SPLIT: DW_TAG_compile_unit
+; SPLIT:   DW_AT_GNU_dwo_id [DW_FORM_data8] ([[C]])
+
+%struct.S = type { i32, i32 }
+
+@s = global %struct.S zeroinitializer, align 4, !dbg !20
+
+define i32 @f() !dbg !5 {
+entry:
+  ret i32 0, !dbg !10
+}
+
+define i32 @g(i32 %x) !dbg !30 {
+entry:
+  call void @llvm.dbg.value(metadata i32 %x, i64 0, metadata !33, metadata !DIExpression()), !dbg !34
+  ret i32 %x, !dbg !34
+}
+
+declare void @llvm.dbg.value(metadata, i64, metadata, metadata)
+
+!llvm.dbg.cu = !{!0, !11, !28}
+!llvm.module.flags = !{!40}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "a.c", directory: "/tmp")
+!2 = !{}
+!5 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, type: !6, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !0, variables: !2)
+!6 = !DISubroutineType(types: !7)
+!7 = !{!8}
+!8 = !DIBasicType(name: "int", size: 32, align: 32, encoding: DW_ATE_signed)
+!10 = !DILocation(line: 1, column: 1, scope: !5)
+!11 = distinct !DICompileUnit(language: DW_LANG_C99, file: !12, producer: "clang", isOptimized: false, emissionKind: FullDebug, enums: !2, globals: !19)
+!12 = !DIFile(filename: "b.c", directory: "/tmp")
+!19 = !{!20}
+!20 = !DIGlobalVariableExpression(var: !21)
+!21 = distinct !DIGlobalVariable(name: "s", scope: !11, file: !12, line: 1, type: !22, isLocal: false, isDefinition: true)
+!22 = !DICompositeType(tag: DW_TAG_structure_type, name: "S", file: !12, line: 1, size: 64, align: 32, elements: !23)
+!23 = !{!24, !25}
+!24 = !DIDerivedType(tag: DW_TAG_member, name: "a", scope: !22, file: !12, line: 1, baseType: !8, size: 32, align: 32)
+!25 = !DIDerivedType(tag: DW_TAG_member, name: "b", scope: !22, file: !12, line: 1, baseType: !8, size: 32, align: 32, offset: 32)
+!28 = distinct !DICompileUnit(language: DW_LANG_C99, file: !29, producer: "clang", isOptimized: false, emissionKind: FullDebug, enums: !2)
+!29 = !DIFile(filename: "c.c", directory: "/tmp")
+!30 = distinct !DISubprogram(name: "g", scope: !29, file: !29, line: 1, type: !31, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !28, variables: !2)
+!31 = !DISubroutineType(types: !32)
+!32 = !{!8, !8}
+!33 = !DILocalVariable(name: "x", arg: 1, scope: !30, file: !29, line: 1, type: !8)
+!34 = !DILocation(line: 1, column: 1, scope: !30)
+!40 = !{i32 2, !"Debug Info Version", i32 3}
@@ -0,0 +1,22 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @a(i32 %x) {
+  %r = call i32 @e(i32 %x)
+  ret i32 %r
+}
+
+define i32 @e(i32 %x) noinline {
+  %r = add i32 %x, 2
+  ret i32 %r
+}
+
+define i32 @b(i32 %x) {
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
+
+define i32 @f(i32 %x) {
+  %r = sub i32 %x, 5
+  ret i32 %r
+}
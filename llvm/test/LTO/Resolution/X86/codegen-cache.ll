@@ -0,0 +1,63 @@
+; Each function of this module lands in a partition of its own when the module
+; is split in four, so the regular LTO code generation cache has one entry per
+; function.
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-as %p/Inputs/codegen-cache.ll -o %t2.bc
+; RUN: rm -rf %t.cache && mkdir %t.cache
+; RUN: llvm-lto2 -o %t.o %t.bc -lto-partitions=4 -lto-cache-dir %t.cache \
+; RUN:     -r=%t.bc,a,px -r=%t.bc,e,px -r=%t.bc,b,px -r=%t.bc,f,px
+; RUN: ls %t.cache | count 4
+
+; Linking again only uses the cache and gives the same objects.
+; RUN: llvm-lto2 -o %t2.o %t.bc -lto-partitions=4 -lto-cache-dir %t.cache \
+; RUN:     -r=%t.bc,a,px -r=%t.bc,e,px -r=%t.bc,b,px -r=%t.bc,f,px
+; RUN: ls %t.cache | count 4
+; RUN: cmp %t.o.0 %t2.o.0
+; RUN: cmp %t.o.1 %t2.o.1
+; RUN: cmp %t.o.2 %t2.o.2
+; RUN: cmp %t.o.3 %t2.o.3
+
+; Changing the body of e only generates the partition of e again, even though
+; a calls it.
+; RUN: llvm-lto2 -o %t3.o %t2.bc -lto-partitions=4 -lto-cache-dir %t.cache \
+; RUN:     -r=%t2.bc,a,px -r=%t2.bc,e,px -r=%t2.bc,b,px -r=%t2.bc,f,px
+; RUN: ls %t.cache | count 5
+; RUN: cmp %t.o.0 %t3.o.0
+; RUN: not cmp %t.o.1 %t3.o.1
+; RUN: llvm-nm %t3.o.1 | FileCheck %s
+; CHECK: T e
+
+; The ThinLTO cache directory isn't used for regular LTO.
+; RUN: rm -rf %t.cache && mkdir %t.cache
+; RUN: llvm-lto2 -o %t5.o %t.bc -lto-partitions=4 -cache-dir %t.cache \
+; RUN:     -r=%t.bc,a,px -r=%t.bc,e,px -r=%t.bc,b,px -r=%t.bc,f,px
+; RUN: ls %t.cache | count 0
+
+; Without partitions the whole module has a single entry.
+; RUN: rm -rf %t.cache && mkdir %t.cache
+; RUN: llvm-lto2 -o %t4.o %t.bc -lto-cache-dir %t.cache \
+; RUN:     -r=%t.bc,a,px -r=%t.bc,e,px -r=%t.bc,b,px -r=%t.bc,f,px
+; RUN: ls %t.cache | count 1
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @a(i32 %x) {
+  %r = call i32 @e(i32 %x)
+  ret i32 %r
+}
+
+define i32 @e(i32 %x) noinline {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @b(i32 %x) {
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
+
+define i32 @f(i32 %x) {
+  %r = sub i32 %x, 5
+  ret i32 %r
+}
@@ -0,0 +1,18 @@
+; RUN: llvm-as %s -o %t.o
+; RUN: llvm-lto2 -o %t2.o %t.o -r=%t.o,foo,px -lto-memory-report 2>&1 \
+; RUN:     | FileCheck %s
+; RUN: llvm-lto2 -o %t2.o %t.o -r=%t.o,foo,px 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=NOREPORT --allow-empty
+
+; CHECK: memory after linking: malloc usage {{[0-9]+}} KB, peak RSS {{[0-9]+}} KB
+; CHECK-NEXT: memory after optimization: malloc usage {{[0-9]+}} KB, peak RSS {{[0-9]+}} KB
+; CHECK-NEXT: memory after code generation: malloc usage {{[0-9]+}} KB, peak RSS {{[0-9]+}} KB
+
+; NOREPORT-NOT: memory after
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @foo() {
+  ret void
+}
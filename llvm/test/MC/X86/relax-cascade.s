@@ -0,0 +1,31 @@
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-unknown %s -o %t
+# RUN: llvm-objdump -d %t | FileCheck %s
+
+# The branches which fit at first have to be checked again once the fragments
+# they depend on are relaxed: .Lz is relaxed in the first pass, which moves
+# .Lw out of the range of w, and relaxing w grows the padding of the alignment
+# between x and .Lx.
+
+# CHECK-LABEL: w:
+# CHECK-NEXT:   0: e9 {{.*}} jmp
+# CHECK-LABEL: x:
+# CHECK-NEXT:   5: e9 {{.*}} jmp
+# CHECK-LABEL: z:
+# CHECK-NEXT:  {{[0-9a-f]+}}: e9 {{.*}} jmp
+
+	.text
+w:
+	jmp	.Lw
+x:
+	jmp	.Lx
+	.fill	12, 1, 0x90
+	.p2align	4, 0x90
+	.fill	108, 1, 0x90
+.Lx:
+z:
+	jmp	.Lz
+	.fill	3, 1, 0x90
+.Lw:
+	.fill	200, 1, 0x90
+.Lz:
+	retq
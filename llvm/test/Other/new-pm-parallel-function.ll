@@ -0,0 +1,121 @@
+; Test that running a function pipeline on several threads gives the same
+; result as running it serially.
+
+; RUN: opt -S -passes='function(instcombine,simplify-cfg,early-cse)' %s \
+; RUN:     -o %t.serial.ll
+; RUN: opt -S -passes='parallel-function(instcombine,simplify-cfg,early-cse)' \
+; RUN:     -parallel-function-threads=3 %s -o %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: FileCheck %s < %t.parallel.ll
+
+; With a single thread the pipeline runs on the serial adaptor.
+; RUN: opt -S -passes='parallel-function(instcombine,simplify-cfg,early-cse)' \
+; RUN:     -parallel-function-threads=1 %s | FileCheck %s
+
+; RUN: not opt -S -passes='parallel-function(no-such-pass)' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=ERR
+; ERR: unable to parse pass pipeline description
+
+%struct.S = type { i32, %struct.S* }
+
+@.str = private unnamed_addr constant [7 x i8] c"hello\0A\00"
+@.str.1 = private unnamed_addr constant [7 x i8] c"world\0A\00"
+@0 = internal global i32 1
+@counter = internal global i32 0
+@parallel-function.anon = internal global i32 2
+@parallel-function.anon0.0 = internal global i32 3
+@s = global %struct.S zeroinitializer
+
+; CHECK-LABEL: define void @hello()
+; CHECK-NEXT: call i32 @puts({{.*}}@str{{.*}}), !dbg
+; CHECK-NEXT: ret void
+define void @hello() !dbg !4 {
+  %1 = call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([7 x i8], [7 x i8]* @.str, i32 0, i32 0)), !dbg !7
+  ret void, !dbg !7
+}
+
+; CHECK-LABEL: define void @world()
+; CHECK-NEXT: call i32 @puts({{.*}}@str.1{{.*}}), !dbg
+; CHECK-NEXT: ret void
+define void @world() !dbg !8 {
+  %1 = call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([7 x i8], [7 x i8]* @.str.1, i32 0, i32 0)), !dbg !9
+  ret void, !dbg !9
+}
+
+; CHECK-LABEL: define i32 @anon()
+; CHECK-NEXT: load i32, i32* @0
+; CHECK-NEXT: ret i32
+define i32 @anon() {
+  %1 = load i32, i32* @0
+  %2 = add i32 %1, 0
+  ret i32 %2
+}
+
+; Unnamed values get temporary names which don't collide with these.
+; CHECK-LABEL: define i32 @named()
+; CHECK-NEXT: load i32, i32* @parallel-function.anon
+; CHECK-NEXT: load i32, i32* @parallel-function.anon0.0
+; CHECK-NEXT: add i32
+; CHECK-NEXT: ret i32
+define i32 @named() {
+  %1 = load i32, i32* @parallel-function.anon
+  %2 = load i32, i32* @parallel-function.anon0.0
+  %3 = add i32 %1, 0
+  %4 = add i32 %3, %2
+  ret i32 %4
+}
+
+; CHECK-LABEL: define i32 @next(%struct.S* %p)
+; CHECK: br i1 %c, label %exit, label %nonnull
+; CHECK-NOT: {{^}}null:
+; CHECK: ret i32 %r
+define i32 @next(%struct.S* %p) {
+entry:
+  %c = icmp eq %struct.S* %p, null
+  br i1 %c, label %null, label %nonnull
+
+null:
+  br label %exit
+
+nonnull:
+  %f = getelementptr %struct.S, %struct.S* %p, i32 0, i32 0
+  %v = load i32, i32* %f
+  br label %exit
+
+exit:
+  %r = phi i32 [ 0, %null ], [ %v, %nonnull ]
+  %n = load i32, i32* @counter
+  %n1 = add i32 %n, 1
+  store i32 %n1, i32* @counter
+  ret i32 %r
+}
+
+; CHECK-LABEL: define %struct.S* @self()
+; CHECK-NEXT: ret %struct.S* @s
+define %struct.S* @self() {
+  %p = getelementptr %struct.S, %struct.S* @s, i32 0, i32 1
+  %q = load %struct.S*, %struct.S** %p
+  %r = select i1 true, %struct.S* @s, %struct.S* %q
+  ret %struct.S* %r
+}
+
+; CHECK: declare i32 @printf(i8*, ...)
+declare i32 @printf(i8*, ...)
+
+; CHECK: !llvm.dbg.cu = !{![[CU:[0-9]+]]}
+; CHECK: ![[CU]] = distinct !DICompileUnit(
+; CHECK-NOT: distinct !DICompileUnit(
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, producer: "clang", isOptimized: true, emissionKind: FullDebug, file: !1, enums: !2, retainedTypes: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 1, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "hello", line: 1, isLocal: false, isDefinition: true, isOptimized: true, unit: !0, file: !1, scope: !1, type: !5)
+!5 = !DISubroutineType(types: !6)
+!6 = !{null}
+!7 = !DILocation(line: 2, column: 3, scope: !4)
+!8 = distinct !DISubprogram(name: "world", line: 5, isLocal: false, isDefinition: true, isOptimized: true, unit: !0, file: !1, scope: !1, type: !5)
+!9 = !DILocation(line: 6, column: 3, scope: !8)
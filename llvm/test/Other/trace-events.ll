@@ -0,0 +1,51 @@
+; Test the trace events recorded for the legacy and the new pass managers.
+
+; RUN: opt -domtree -simplifycfg -disable-output -trace-events-file=%t.json %s
+; RUN: FileCheck %s --check-prefix=LEGACY < %t.json
+; LEGACY: {"traceEvents":[
+; LEGACY-DAG: {"cat":"pass","name":"Dominator Tree Construction","ph":"X","pid":1,"tid":0,"ts":{{[0-9]+}},"dur":{{[0-9]+}},"args":{"detail":"foo"}}
+; LEGACY-DAG: {"cat":"pass","name":"Simplify the CFG","ph":"X","pid":1,"tid":0,"ts":{{[0-9]+}},"dur":{{[0-9]+}},"args":{"detail":"foo"}}
+; LEGACY-DAG: {"cat":"pass","name":"Simplify the CFG","ph":"X","pid":1,"tid":0,"ts":{{[0-9]+}},"dur":{{[0-9]+}},"args":{"detail":"bar \"baz\""}}
+; LEGACY: ],"displayTimeUnit":"ms"}
+
+; The legacy pass manager records the analyses invalidated by the passes run on
+; an IR unit, with its name, and not the ones invalidated while scheduling.
+; RUN: opt -gvn -simplifycfg -gvn -disable-output \
+; RUN:     -trace-events-file=%t.inval.json %s
+; RUN: FileCheck %s --check-prefix=INVAL < %t.inval.json
+; INVAL-NOT: "args":{"detail":""}
+; INVAL: {"cat":"invalidation","name":"Memory Dependence Analysis","ph":"i","pid":1,"tid":0,"ts":{{[0-9]+}},"s":"t","args":{"detail":"foo"}}
+; INVAL-NOT: "args":{"detail":""}
+
+; RUN: opt -passes='function(require<domtree>,simplify-cfg)' -disable-output \
+; RUN:     -trace-events-file=%t.new.json %s
+; RUN: FileCheck %s --check-prefix=NEW < %t.new.json
+; NEW-DAG: {"cat":"analysis","name":"DominatorTreeAnalysis","ph":"X",{{.*}}"args":{"detail":"foo"}}
+; NEW-DAG: {"cat":"pass","name":"SimplifyCFGPass","ph":"X",{{.*}}"args":{"detail":"foo"}}
+; NEW-DAG: {"cat":"invalidation","name":"DominatorTreeAnalysis","ph":"i",{{.*}}"args":{"detail":"foo"}}
+; NEW-DAG: {"cat":"pass","name":"ModuleToFunctionPassAdaptor<{{.*}}>","ph":"X",{{.*}}"args":{"detail":"{{.*}}trace-events.ll"}}
+
+; Scopes shorter than the minimum duration are dropped, instant events are
+; kept.
+; RUN: opt -gvn -simplifycfg -gvn -disable-output \
+; RUN:     -trace-events-file=%t.min.json -trace-events-min-us=100000000 %s
+; RUN: FileCheck %s --check-prefix=MIN < %t.min.json
+; MIN-NOT: "ph":"X"
+; MIN: "cat":"invalidation"
+; MIN-NOT: "ph":"X"
+
+define i32 @foo(i1 %c) {
+entry:
+  br i1 %c, label %a, label %b
+
+a:
+  br label %b
+
+b:
+  %r = phi i32 [ 0, %entry ], [ 1, %a ]
+  ret i32 %r
+}
+
+define void @"bar \22baz\22"() {
+  ret void
+}
@@ -0,0 +1,81 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.S = type { i32, i32, i64, i64 }
+
+define i32 @globalfunc1(i32 %a) !dbg !10 {
+entry:
+  call void @llvm.dbg.value(metadata i32 %a, i64 0, metadata !14, metadata !15), !dbg !16
+  %add = add nsw i32 %a, 1, !dbg !17
+  ret i32 %add, !dbg !17
+}
+
+define i32 @globalfunc2(i32* %p, %struct.S* %s) !dbg !20 {
+entry:
+  call void @llvm.dbg.value(metadata i32* %p, i64 0, metadata !24, metadata !15), !dbg !26
+  call void @llvm.dbg.value(metadata %struct.S* %s, i64 0, metadata !51, metadata !15), !dbg !26
+  %v = load i32, i32* %p, align 4, !dbg !27, !tbaa !40
+  ret i32 %v, !dbg !27
+}
+
+define i64 @globalfunc3(i64 %x, i64 %y, %struct.S* %s) !dbg !30 {
+entry:
+  call void @llvm.dbg.value(metadata i64 %x, i64 0, metadata !34, metadata !15), !dbg !36
+  call void @llvm.dbg.value(metadata i64 %y, i64 0, metadata !35, metadata !15), !dbg !36
+  call void @llvm.dbg.value(metadata %struct.S* %s, i64 0, metadata !50, metadata !15), !dbg !36
+  %mul = mul nsw i64 %x, %y, !dbg !37
+  ret i64 %mul, !dbg !38
+}
+
+declare void @llvm.dbg.value(metadata, i64, metadata, metadata)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!llvm.ident = !{!5}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang version 4.0.0", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "lazyload_metadata.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !{!"clang version 4.0.0"}
+!6 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!10 = distinct !DISubprogram(name: "globalfunc1", scope: !1, file: !1, line: 1, type: !11, isLocal: false, isDefinition: true, scopeLine: 1, flags: DIFlagPrototyped, isOptimized: true, unit: !0, variables: !13)
+!11 = !DISubroutineType(types: !12)
+!12 = !{!6, !6}
+!13 = !{!14}
+!14 = !DILocalVariable(name: "a", arg: 1, scope: !10, file: !1, line: 1, type: !6)
+!15 = !DIExpression()
+!16 = !DILocation(line: 1, column: 21, scope: !10)
+!17 = !DILocation(line: 2, column: 12, scope: !10)
+!20 = distinct !DISubprogram(name: "globalfunc2", scope: !1, file: !1, line: 5, type: !21, isLocal: false, isDefinition: true, scopeLine: 5, flags: DIFlagPrototyped, isOptimized: true, unit: !0, variables: !23)
+!21 = !DISubroutineType(types: !22)
+!22 = !{!6, !25, !52}
+!23 = !{!24, !51}
+!24 = !DILocalVariable(name: "pointer", arg: 1, scope: !20, file: !1, line: 5, type: !25)
+!25 = !DIDerivedType(tag: DW_TAG_pointer_type, baseType: !6, size: 64)
+!26 = !DILocation(line: 5, column: 22, scope: !20)
+!27 = !DILocation(line: 6, column: 10, scope: !20)
+!30 = distinct !DISubprogram(name: "globalfunc3", scope: !1, file: !1, line: 9, type: !31, isLocal: false, isDefinition: true, scopeLine: 9, flags: DIFlagPrototyped, isOptimized: true, unit: !0, variables: !33)
+!31 = !DISubroutineType(types: !32)
+!32 = !{!39, !39, !39, !52}
+!33 = !{!34, !35, !50}
+!34 = !DILocalVariable(name: "first", arg: 1, scope: !30, file: !1, line: 9, type: !39)
+!35 = !DILocalVariable(name: "second", arg: 2, scope: !30, file: !1, line: 9, type: !39)
+!36 = !DILocation(line: 9, column: 30, scope: !30)
+!37 = !DILocation(line: 10, column: 12, scope: !30)
+!38 = !DILocation(line: 10, column: 3, scope: !30)
+!39 = !DIBasicType(name: "long long", size: 64, encoding: DW_ATE_signed)
+!40 = !{!41, !41, i64 0}
+!41 = !{!"int", !42, i64 0}
+!42 = !{!"omnipotent char", !43, i64 0}
+!43 = !{!"Simple C/C++ TBAA"}
+!50 = !DILocalVariable(name: "s", arg: 3, scope: !30, file: !1, line: 9, type: !52)
+!51 = !DILocalVariable(name: "s", arg: 2, scope: !20, file: !1, line: 5, type: !52)
+!52 = !DIDerivedType(tag: DW_TAG_pointer_type, baseType: !53, size: 64)
+!53 = !DICompositeType(tag: DW_TAG_structure_type, name: "S", file: !1, line: 20, size: 192, elements: !54)
+!54 = !{!55, !56, !57, !58}
+!55 = !DIDerivedType(tag: DW_TAG_member, name: "first_member", scope: !53, file: !1, line: 21, baseType: !6, size: 32)
+!56 = !DIDerivedType(tag: DW_TAG_member, name: "second_member", scope: !53, file: !1, line: 22, baseType: !6, size: 32, offset: 32)
+!57 = !DIDerivedType(tag: DW_TAG_member, name: "third_member", scope: !53, file: !1, line: 23, baseType: !39, size: 64, offset: 64)
+!58 = !DIDerivedType(tag: DW_TAG_member, name: "fourth_member", scope: !53, file: !1, line: 24, baseType: !39, size: 64, offset: 128)
@@ -0,0 +1,17 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@G = internal global i32 0
+
+define i32 @g() {
+entry:
+  %v = load i32, i32* @G
+  %r = call i32 @h()
+  %s = add i32 %v, %r
+  ret i32 %s
+}
+
+define linkonce_odr i32 @h() {
+entry:
+  ret i32 1
+}
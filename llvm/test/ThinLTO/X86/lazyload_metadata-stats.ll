@@ -0,0 +1,30 @@
+; Check that importing @globalfunc1 doesn't load the module-level metadata
+; that only @globalfunc2 and @globalfunc3 need.
+; REQUIRES: asserts
+
+; RUN: opt -module-summary %s -o %t.bc
+; RUN: opt -module-summary %p/Inputs/lazyload_metadata.ll -o %t2.bc \
+; RUN:   -bitcode-mdindex-threshold=0
+; RUN: llvm-lto -thinlto-action=thinlink -o %t3.bc %t.bc %t2.bc
+
+; RUN: llvm-lto -thinlto-action=import %t.bc -thinlto-index=%t3.bc \
+; RUN:   -o /dev/null -stats 2>&1 | FileCheck %s -check-prefix=LAZY
+; LAZY-DAG: 18 bitcode-reader - Number of Metadata records loaded
+; LAZY-DAG: 8 bitcode-reader - Number of MDStrings loaded
+
+; RUN: llvm-lto -thinlto-action=import %t.bc -thinlto-index=%t3.bc \
+; RUN:   -o /dev/null -disable-ondemand-mds-loading -stats 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=NOTLAZY
+; NOTLAZY-DAG: 32 bitcode-reader - Number of Metadata records loaded
+; NOTLAZY-DAG: 14 bitcode-reader - Number of MDStrings loaded
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @main() {
+entry:
+  %r = call i32 @globalfunc1(i32 1)
+  ret i32 %r
+}
+
+declare i32 @globalfunc1(i32)
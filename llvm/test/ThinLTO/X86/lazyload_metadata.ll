@@ -0,0 +1,34 @@
+; Check that importing a function loads the module-level metadata of the
+; source module on demand, and gives the same result as loading all of it.
+
+; RUN: opt -module-summary %s -o %t.bc
+; RUN: opt -module-summary %p/Inputs/lazyload_metadata.ll -o %t2.bc \
+; RUN:   -bitcode-mdindex-threshold=0
+; RUN: llvm-lto -thinlto-action=thinlink -o %t3.bc %t.bc %t2.bc
+
+; The source module has an index of its metadata records.
+; RUN: llvm-bcanalyzer -dump %t2.bc | FileCheck %s -check-prefix=INDEX
+; INDEX: <INDEX_OFFSET
+; INDEX: <INDEX
+
+; RUN: llvm-lto -thinlto-action=import %t.bc -thinlto-index=%t3.bc -o - \
+; RUN:   | llvm-dis -o %t4.ll
+; RUN: llvm-lto -thinlto-action=import %t.bc -thinlto-index=%t3.bc -o - \
+; RUN:   -disable-ondemand-mds-loading | llvm-dis -o %t5.ll
+; RUN: diff %t4.ll %t5.ll
+; RUN: FileCheck %s -check-prefix=IMPORT < %t4.ll
+; IMPORT: define available_externally i32 @globalfunc1(i32 %a) !dbg
+; IMPORT: !DISubprogram(name: "globalfunc1"
+; IMPORT-NOT: globalfunc2
+; IMPORT-NOT: globalfunc3
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @main() {
+entry:
+  %r = call i32 @globalfunc1(i32 1)
+  ret i32 %r
+}
+
+declare i32 @globalfunc1(i32)
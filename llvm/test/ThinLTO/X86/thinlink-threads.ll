@@ -0,0 +1,58 @@
+; Check that the thin link gives the same result with one or several threads.
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/thinlink-threads.ll -o %t2.bc
+
+; RUN: llvm-lto2 %t1.bc %t2.bc -o %t.o -thinlto-distributed-indexes \
+; RUN:     -thinlto-threads=1 \
+; RUN:     -r=%t1.bc,f,px \
+; RUN:     -r=%t1.bc,g, \
+; RUN:     -r=%t1.bc,h,px \
+; RUN:     -r=%t2.bc,g,px \
+; RUN:     -r=%t2.bc,h,
+; RUN: mv %t1.bc.thinlto.bc %t1.serial.thinlto.bc
+; RUN: mv %t2.bc.thinlto.bc %t2.serial.thinlto.bc
+; RUN: mv %t1.bc.imports %t1.serial.imports
+
+; RUN: llvm-lto2 %t1.bc %t2.bc -o %t.o -thinlto-distributed-indexes \
+; RUN:     -thinlto-threads=4 -time-passes \
+; RUN:     -r=%t1.bc,f,px \
+; RUN:     -r=%t1.bc,g, \
+; RUN:     -r=%t1.bc,h,px \
+; RUN:     -r=%t2.bc,g,px \
+; RUN:     -r=%t2.bc,h, 2>&1 | FileCheck %s --check-prefix=TIME
+; RUN: cmp %t1.bc.thinlto.bc %t1.serial.thinlto.bc
+; RUN: cmp %t2.bc.thinlto.bc %t2.serial.thinlto.bc
+; RUN: cmp %t1.bc.imports %t1.serial.imports
+; RUN: FileCheck %s --check-prefix=IMPORTS < %t1.bc.imports
+
+; IMPORTS: thinlink-threads.ll.tmp2.bc
+
+; TIME: ThinLTO Thin Link
+; TIME-DAG: Collect defined summaries
+; TIME-DAG: Cross-module import
+; TIME-DAG: Internalization
+; TIME-DAG: Weak symbol resolution
+
+; The imported function references an internal global of its module, which
+; must be promoted.
+; RUN: opt -function-import -summary-file %t2.bc.thinlto.bc %t2.bc -o %t2.out
+; RUN: llvm-dis -o - %t2.out | FileCheck %s
+; CHECK: @G.llvm.0
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @g()
+
+define i32 @f() {
+entry:
+  %r = call i32 @g()
+  %s = call i32 @h()
+  %t = add i32 %r, %s
+  ret i32 %t
+}
+
+define linkonce_odr i32 @h() {
+entry:
+  ret i32 1
+}
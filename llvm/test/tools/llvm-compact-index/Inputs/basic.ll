@@ -0,0 +1,9 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@g = global i32 1
+
+define void @callee() {
+  %v = load i32, i32* @g
+  ret void
+}
@@ -0,0 +1,76 @@
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/basic.ll -o %t2.bc
+; RUN: llvm-lto -thinlto-action=thinlink -o %t.index.bc %t1.bc %t2.bc
+
+; Converting and dumping the compact index gives the same output as dumping
+; it straight from the bitcode index.
+; RUN: llvm-compact-index %t.index.bc -o %t.csi
+; RUN: llvm-compact-index %t.csi > %t.dump
+; RUN: llvm-compact-index %t.index.bc -dump | diff %t.dump -
+; RUN: FileCheck %s < %t.dump
+
+; CHECK-DAG: module {{[0-9]}}: {{.*}}1.bc id={{[0-9]+}} summaries=[{{[0-9]}}, {{[0-9]}})
+; CHECK-DAG: module {{[0-9]}}: {{.*}}2.bc id={{[0-9]+}} summaries=[{{[0-9]}}, {{[0-9]}})
+
+; The declaration of callee in this module doesn't get a summary of its own.
+; CHECK-DAG: summary {{[0-9]}}: function module={{[0-9]}} linkage=external insts=2
+; CHECK-DAG: call guid {{[0-9]}} hotness=0
+; CHECK-DAG: summary {{[0-9]}}: function module={{[0-9]}} linkage=external insts=2
+; CHECK-DAG: ref guid {{[0-9]}}
+; CHECK-DAG: summary {{[0-9]}}: variable module={{[0-9]}} linkage=external
+; CHECK-DAG: summary {{[0-9]}}: alias module={{[0-9]}} linkage=weak aliasee={{[0-9]}}
+
+; RUN: llvm-compact-index %t.index.bc -compare | FileCheck %s --check-prefix=CMP
+; CMP: modules:        2
+; CMP-NEXT: GUIDs:          4
+; CMP-NEXT: summaries:      4
+; CMP-NEXT: calls:          1
+; CMP-NEXT: refs:           1
+; CMP-NEXT: bitcode size:   {{[0-9]+}} bytes
+; CMP-NEXT: compact size:   {{[0-9]+}} bytes
+; CMP-NEXT: bitcode load:   {{[0-9.]+}} ms
+; CMP-NEXT: compact load:   {{[0-9.]+}} ms
+; CMP-NEXT: bitcode walk:   {{[0-9.]+}} ms
+; CMP-NEXT: compact walk:   {{[0-9.]+}} ms
+; CMP-NEXT: bitcode import: {{[0-9.]+}} ms
+; CMP-NEXT: compact import: {{[0-9.]+}} ms
+
+; The imports computed from the compact index are the same as the ones
+; computed from the bitcode index: callee is imported from the second module,
+; which exports it and the variable it references.
+; RUN: llvm-compact-index %t.csi -imports > %t.imports
+; RUN: llvm-compact-index %t.index.bc -imports | diff %t.imports -
+; RUN: FileCheck %s --check-prefix=IMPORTS < %t.imports
+; IMPORTS:      module {{.*}}1.bc
+; IMPORTS-NEXT:   import {{[0-9]+}} from {{.*}}2.bc threshold=70
+; IMPORTS-NEXT: module {{.*}}2.bc
+; IMPORTS-NEXT:   export {{[0-9]+}}
+; IMPORTS-NEXT:   export {{[0-9]+}}
+; IMPORTS-NOT: {{.}}
+
+; Aliases of variables can't be represented.
+; RUN: opt -module-summary %p/Inputs/alias-variable.ll -o %t3.bc
+; RUN: llvm-lto -thinlto-action=thinlink -o %t3.index.bc %t3.bc
+; RUN: not llvm-compact-index %t3.index.bc -o %t3.csi 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=ALIAS
+; ALIAS: the aliasee of alias {{[0-9]+}} is not a function
+
+; A file which is neither a compact index nor bitcode is rejected.
+; RUN: not llvm-compact-index %s 2>&1 | FileCheck %s --check-prefix=ERR
+; ERR: llvm-compact-index: error:
+
+; -o and -compare need a bitcode index.
+; RUN: not llvm-compact-index %t.csi -compare 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=ERR
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@main.alias = weak alias i32 (), i32 ()* @main
+
+define i32 @main() {
+  call void @callee()
+  ret i32 0
+}
+
+declare void @callee()
@@ -0,0 +1,48 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-lazy-load %t.bc -func=b | FileCheck %s
+; RUN: llvm-lazy-load %t.bc -func=b -lazy-metadata | FileCheck %s
+; RUN: llvm-as %s -bitcode-mdindex-threshold=0 -o %t.index.bc
+; RUN: llvm-lazy-load %t.index.bc -func=b -lazy-metadata -importing \
+; RUN:   | FileCheck %s
+; CHECK: functions:      1 of 3
+; CHECK-NEXT: instructions:   2
+; CHECK-NEXT: module:         {{[0-9.]+}} ms
+; CHECK-NEXT: first function: {{[0-9.]+}} ms
+; CHECK-NEXT: total:          {{[0-9.]+}} ms
+
+; RUN: llvm-lazy-load %t.bc -n 0 | FileCheck %s --check-prefix=ALL
+; ALL: functions:      3 of 3
+; ALL-NEXT: instructions:   5
+
+; RUN: not llvm-lazy-load %t.bc -func=d 2>&1 | FileCheck %s --check-prefix=ERR
+; ERR: error: no function body for 'd'
+
+define i32 @a() !dbg !4 {
+  ret i32 0, !dbg !7
+}
+
+define i32 @b(i32 %x) !dbg !8 {
+  %y = add i32 %x, 1, !dbg !9
+  ret i32 %y, !dbg !9
+}
+
+define void @c() {
+  call void @d()
+  ret void
+}
+
+declare void @d()
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, producer: "clang", isOptimized: false, emissionKind: FullDebug, file: !1, enums: !2, retainedTypes: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 1, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "a", line: 1, isLocal: false, isDefinition: true, unit: !0, file: !1, scope: !1, type: !5)
+!5 = !DISubroutineType(types: !6)
+!6 = !{null}
+!7 = !DILocation(line: 1, scope: !4)
+!8 = distinct !DISubprogram(name: "b", line: 2, isLocal: false, isDefinition: true, unit: !0, file: !1, scope: !1, type: !5)
+!9 = !DILocation(line: 2, scope: !8)
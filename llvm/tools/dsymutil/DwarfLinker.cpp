@@ -1396,10 +1396,6 @@ private:
   void patchFrameInfoForObject(const DebugMapObject &, DWARFContext &,
                                unsigned AddressSize);
 
-  /// \brief DIELoc objects that need to be destructed (but not freed!).
-  std::vector<DIELoc *> DIELocs;
-  /// \brief DIEBlock objects that need to be destructed (but not freed!).
-  std::vector<DIEBlock *> DIEBlocks;
   /// \brief Allocator used for all the DIEValue objects.
   BumpPtrAllocator DIEAlloc;
   /// @}
@@ -1856,14 +1852,6 @@ void DwarfLinker::startDebugObject(DWARFContext &Dwarf, DebugMapObject &Obj) {
 void DwarfLinker::endDebugObject() {
   Units.clear();
   Ranges.clear();
-
-  for (auto I = DIEBlocks.begin(), E = DIEBlocks.end(); I != E; ++I)
-    (*I)->~DIEBlock();
-  for (auto I = DIELocs.begin(), E = DIELocs.end(); I != E; ++I)
-    (*I)->~DIELoc();
-
-  DIEBlocks.clear();
-  DIELocs.clear();
   DIEAlloc.Reset();
 }
 
@@ -2421,13 +2409,10 @@ unsigned DwarfLinker::DIECloner::cloneBlockAttribute(DIE &Die,
   DIELoc *Loc = nullptr;
   DIEBlock *Block = nullptr;
   // Just copy the block data over.
-  if (AttrSpec.Form == dwarf::DW_FORM_exprloc) {
+  if (AttrSpec.Form == dwarf::DW_FORM_exprloc)
     Loc = new (DIEAlloc) DIELoc;
-    Linker.DIELocs.push_back(Loc);
-  } else {
+  else
     Block = new (DIEAlloc) DIEBlock;
-    Linker.DIEBlocks.push_back(Block);
-  }
   Attr = Loc ? static_cast<DIEValueList *>(Loc)
              : static_cast<DIEValueList *>(Block);
 
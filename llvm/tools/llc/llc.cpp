@@ -118,6 +118,11 @@ static cl::opt<bool> DiscardValueNames(
     cl::desc("Discard names from Value (other than GlobalValue)."),
     cl::init(false), cl::Hidden);
 
+static cl::opt<bool> IRArena(
+    "ir-arena",
+    cl::desc("Allocate the IR objects from an arena freed with the context"),
+    cl::init(false), cl::Hidden);
+
 static cl::opt<std::string> StopBefore("stop-before",
     cl::desc("Stop compilation before a specific pass"),
     cl::value_desc("pass-name"), cl::init(""));
@@ -272,6 +277,8 @@ int main(int argc, char **argv) {
   cl::ParseCommandLineOptions(argc, argv, "llvm system compiler\n");
 
   Context.setDiscardValueNames(DiscardValueNames);
+  if (IRArena)
+    Context.enableIRArena();
 
   // Set a diagnostic handler that doesn't exit on the first error
   bool HasError = false;
@@ -0,0 +1,357 @@
+//===-- llvm-compact-index.cpp - Compact summary index tool ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program converts a bitcode summary index to the compact summary index
+// format, dumps compact indexes, computes the cross module imports from either
+// format and compares the size, load time and import time of both formats.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/CompactSummaryIndex.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO/FunctionImport.h"
+#include <algorithm>
+
+using namespace llvm;
+
+static cl::opt<std::string>
+    InputFilename(cl::Positional,
+                  cl::desc("<input bitcode or compact summary index>"),
+                  cl::init("-"));
+
+static cl::opt<std::string>
+    OutputFilename("o", cl::desc("Write the index in the compact format"),
+                   cl::value_desc("filename"));
+
+static cl::opt<bool> Dump("dump", cl::desc("Print the compact index"));
+
+static cl::opt<bool>
+    Compare("compare", cl::desc("Compare the size and load time of the "
+                                "bitcode and compact formats of the index"));
+
+static cl::opt<bool>
+    Imports("imports", cl::desc("Compute and print the cross module imports "
+                                "and exports of the index"));
+
+static ExitOnError ExitOnErr("llvm-compact-index: error: ");
+
+static double getWallTime() {
+  return TimeRecord::getCurrentTime().getWallTime() * 1000;
+}
+
+static StringRef getLinkageName(GlobalValue::LinkageTypes Linkage) {
+  switch (Linkage) {
+  case GlobalValue::ExternalLinkage:
+    return "external";
+  case GlobalValue::AvailableExternallyLinkage:
+    return "available_externally";
+  case GlobalValue::LinkOnceAnyLinkage:
+    return "linkonce";
+  case GlobalValue::LinkOnceODRLinkage:
+    return "linkonce_odr";
+  case GlobalValue::WeakAnyLinkage:
+    return "weak";
+  case GlobalValue::WeakODRLinkage:
+    return "weak_odr";
+  case GlobalValue::AppendingLinkage:
+    return "appending";
+  case GlobalValue::InternalLinkage:
+    return "internal";
+  case GlobalValue::PrivateLinkage:
+    return "private";
+  case GlobalValue::ExternalWeakLinkage:
+    return "extern_weak";
+  case GlobalValue::CommonLinkage:
+    return "common";
+  }
+  llvm_unreachable("unknown linkage");
+}
+
+static StringRef getKindName(GlobalValueSummary::SummaryKind Kind) {
+  switch (Kind) {
+  case GlobalValueSummary::AliasKind:
+    return "alias";
+  case GlobalValueSummary::FunctionKind:
+    return "function";
+  case GlobalValueSummary::GlobalVarKind:
+    return "variable";
+  }
+  llvm_unreachable("unknown summary kind");
+}
+
+static void dumpIndex(const CompactSummaryIndex &Index, raw_ostream &OS) {
+  for (unsigned M = 0, E = Index.getNumModules(); M != E; ++M) {
+    OS << "module " << M << ": " << Index.getModulePath(M)
+       << " id=" << Index.getModuleId(M) << " summaries=["
+       << Index.module_summary_begin(M) << ", "
+       << Index.module_summary_end(M) << ")\n";
+  }
+
+  for (unsigned G = 0, E = Index.getNumGUIDs(); G != E; ++G) {
+    OS << "guid " << G << ": " << Index.getGUID(G) << "\n";
+    for (unsigned S = Index.summary_begin(G), SE = Index.summary_end(G);
+         S != SE; ++S) {
+      auto Kind = Index.getSummaryKind(S);
+      OS << "  summary " << S << ": " << getKindName(Kind)
+         << " module=" << Index.getModule(S)
+         << " linkage=" << getLinkageName(Index.getLinkage(S));
+      GlobalValueSummary::GVFlags Flags = Index.getFlags(S);
+      if (Flags.NoRename)
+        OS << " norename";
+      if (Flags.HasInlineAsmMaybeReferencingInternal)
+        OS << " inlineasm";
+      if (Flags.IsNotViableToInline)
+        OS << " notviable";
+      if (Kind == GlobalValueSummary::AliasKind)
+        OS << " aliasee=" << Index.getAliasee(S);
+      if (Kind == GlobalValueSummary::FunctionKind)
+        OS << " insts=" << Index.getInstCount(S);
+      OS << "\n";
+
+      for (unsigned C = Index.call_begin(S), CE = Index.call_end(S); C != CE;
+           ++C)
+        OS << "    call guid " << Index.getCallee(C)
+           << " hotness=" << unsigned(Index.getHotness(C)) << "\n";
+      for (unsigned R = Index.ref_begin(S), RE = Index.ref_end(S); R != RE;
+           ++R)
+        OS << "    ref guid " << Index.getRef(R) << "\n";
+      for (uint64_t TypeId : Index.type_tests(S))
+        OS << "    type test " << TypeId << "\n";
+    }
+  }
+}
+
+// Visits every edge of the bitcode index, to compare with the same walk over
+// the compact index.
+static uint64_t walkIndex(const ModuleSummaryIndex &Index) {
+  uint64_t Sum = 0;
+  for (auto &I : Index) {
+    for (auto &Summary : I.second) {
+      for (auto &Ref : Summary->refs())
+        Sum += Ref.getGUID();
+      if (auto *FS = dyn_cast<FunctionSummary>(Summary.get()))
+        for (auto &Call : FS->calls())
+          Sum += Call.first.getGUID();
+    }
+  }
+  return Sum;
+}
+
+static uint64_t walkIndex(const CompactSummaryIndex &Index) {
+  uint64_t Sum = 0;
+  for (unsigned S = 0, E = Index.getNumSummaries(); S != E; ++S) {
+    for (unsigned R = Index.ref_begin(S), RE = Index.ref_end(S); R != RE; ++R)
+      Sum += Index.getGUID(Index.getRef(R));
+    for (unsigned C = Index.call_begin(S), CE = Index.call_end(S); C != CE;
+         ++C)
+      Sum += Index.getGUID(Index.getCallee(C));
+  }
+  return Sum;
+}
+
+static void
+computeImports(const ModuleSummaryIndex &Index,
+               StringMap<FunctionImporter::ImportMapTy> &ImportLists,
+               StringMap<FunctionImporter::ExportSetTy> &ExportLists) {
+  StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries;
+  Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
+  ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
+                           ExportLists);
+}
+
+// Prints the imports and exports in module path and GUID order, so that the
+// results computed from both formats can be compared.
+static void
+printImports(const StringMap<FunctionImporter::ImportMapTy> &ImportLists,
+             const StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+             raw_ostream &OS) {
+  std::vector<StringRef> Paths;
+  for (auto &I : ImportLists)
+    Paths.push_back(I.first());
+  std::sort(Paths.begin(), Paths.end());
+  for (StringRef Path : Paths) {
+    OS << "module " << Path << "\n";
+    const FunctionImporter::ImportMapTy &ImportList = ImportLists.lookup(Path);
+    std::vector<StringRef> Sources;
+    for (auto &I : ImportList)
+      Sources.push_back(I.first());
+    std::sort(Sources.begin(), Sources.end());
+    for (StringRef Source : Sources)
+      for (auto &F : ImportList.lookup(Source))
+        OS << "  import " << F.first << " from " << Source
+           << " threshold=" << F.second << "\n";
+    auto Exports = ExportLists.find(Path);
+    if (Exports == ExportLists.end())
+      continue;
+    std::vector<GlobalValue::GUID> GUIDs(Exports->second.begin(),
+                                         Exports->second.end());
+    std::sort(GUIDs.begin(), GUIDs.end());
+    for (GlobalValue::GUID GUID : GUIDs)
+      OS << "  export " << GUID << "\n";
+  }
+}
+
+static void compareFormats(MemoryBufferRef Bitcode) {
+  double Start = getWallTime();
+  std::unique_ptr<ModuleSummaryIndex> Index =
+      ExitOnErr(getModuleSummaryIndex(Bitcode));
+  double BitcodeLoadTime = getWallTime() - Start;
+
+  Start = getWallTime();
+  uint64_t BitcodeSum = walkIndex(*Index);
+  double BitcodeWalkTime = getWallTime() - Start;
+
+  StringMap<FunctionImporter::ImportMapTy> BitcodeImportLists;
+  StringMap<FunctionImporter::ExportSetTy> BitcodeExportLists;
+  Start = getWallTime();
+  computeImports(*Index, BitcodeImportLists, BitcodeExportLists);
+  double BitcodeImportTime = getWallTime() - Start;
+
+  std::string Buffer;
+  raw_string_ostream OS(Buffer);
+  ExitOnErr(writeCompactSummaryIndex(*Index, OS));
+  OS.flush();
+  Index.reset();
+
+  Start = getWallTime();
+  CompactSummaryIndex Compact = ExitOnErr(CompactSummaryIndex::create(
+      MemoryBufferRef(Buffer, Bitcode.getBufferIdentifier())));
+  double CompactLoadTime = getWallTime() - Start;
+
+  Start = getWallTime();
+  uint64_t CompactSum = walkIndex(Compact);
+  double CompactWalkTime = getWallTime() - Start;
+
+  StringMap<FunctionImporter::ImportMapTy> CompactImportLists;
+  StringMap<FunctionImporter::ExportSetTy> CompactExportLists;
+  Start = getWallTime();
+  ComputeCrossModuleImport(Compact, CompactImportLists, CompactExportLists);
+  double CompactImportTime = getWallTime() - Start;
+
+  if (BitcodeSum != CompactSum) {
+    errs() << "llvm-compact-index: error: the edges of the compact index "
+              "differ from the bitcode index\n";
+    exit(1);
+  }
+
+  std::string BitcodeImports, CompactImports;
+  raw_string_ostream BitcodeOS(BitcodeImports), CompactOS(CompactImports);
+  printImports(BitcodeImportLists, BitcodeExportLists, BitcodeOS);
+  printImports(CompactImportLists, CompactExportLists, CompactOS);
+  if (BitcodeOS.str() != CompactOS.str()) {
+    errs() << "llvm-compact-index: error: the imports computed from the "
+              "compact index differ from the bitcode index\n";
+    exit(1);
+  }
+
+  outs() << "modules:        " << Compact.getNumModules() << "\n";
+  outs() << "GUIDs:          " << Compact.getNumGUIDs() << "\n";
+  outs() << "summaries:      " << Compact.getNumSummaries() << "\n";
+  outs() << "calls:          " << Compact.getNumCalls() << "\n";
+  outs() << "refs:           " << Compact.getNumRefs() << "\n";
+  outs() << "bitcode size:   " << Bitcode.getBufferSize() << " bytes\n";
+  outs() << "compact size:   " << Buffer.size() << " bytes\n";
+  outs() << format("bitcode load:   %.3f ms\n", BitcodeLoadTime);
+  outs() << format("compact load:   %.3f ms\n", CompactLoadTime);
+  outs() << format("bitcode walk:   %.3f ms\n", BitcodeWalkTime);
+  outs() << format("compact walk:   %.3f ms\n", CompactWalkTime);
+  outs() << format("bitcode import: %.3f ms\n", BitcodeImportTime);
+  outs() << format("compact import: %.3f ms\n", CompactImportTime);
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+  cl::ParseCommandLineOptions(argc, argv, "compact summary index tool\n");
+
+  // Neither format needs a null terminator, so the file can always be mapped
+  // into memory instead of being read.
+  std::unique_ptr<MemoryBuffer> MB =
+      ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(
+          InputFilename, -1, /*RequiresNullTerminator=*/false)));
+
+  if (CompactSummaryIndex::isCompactSummaryIndex(*MB)) {
+    if (!OutputFilename.empty() || Compare) {
+      errs() << "llvm-compact-index: error: -o and -compare need a bitcode "
+                "input\n";
+      return 1;
+    }
+    CompactSummaryIndex Index =
+        ExitOnErr(CompactSummaryIndex::create(*MB));
+    ExitOnErr(Index.verify());
+    if (Imports) {
+      StringMap<FunctionImporter::ImportMapTy> ImportLists;
+      StringMap<FunctionImporter::ExportSetTy> ExportLists;
+      ComputeCrossModuleImport(Index, ImportLists, ExportLists);
+      printImports(ImportLists, ExportLists, outs());
+    } else
+      dumpIndex(Index, outs());
+    return 0;
+  }
+
+  const unsigned char *Start =
+      reinterpret_cast<const unsigned char *>(MB->getBufferStart());
+  if (!isBitcode(Start, Start + MB->getBufferSize())) {
+    errs() << "llvm-compact-index: error: " << InputFilename
+           << ": not a bitcode file or a compact summary index\n";
+    return 1;
+  }
+
+  if (Compare)
+    compareFormats(*MB);
+
+  if (Imports) {
+    std::unique_ptr<ModuleSummaryIndex> Index =
+        ExitOnErr(getModuleSummaryIndex(*MB));
+    StringMap<FunctionImporter::ImportMapTy> ImportLists;
+    StringMap<FunctionImporter::ExportSetTy> ExportLists;
+    computeImports(*Index, ImportLists, ExportLists);
+    printImports(ImportLists, ExportLists, outs());
+  }
+
+  if (!OutputFilename.empty() || Dump) {
+    std::unique_ptr<ModuleSummaryIndex> Index =
+        ExitOnErr(getModuleSummaryIndex(*MB));
+    std::string Buffer;
+    raw_string_ostream OS(Buffer);
+    ExitOnErr(writeCompactSummaryIndex(*Index, OS));
+    OS.flush();
+
+    if (!OutputFilename.empty()) {
+      std::error_code EC;
+      raw_fd_ostream Out(OutputFilename, EC, sys::fs::F_None);
+      if (EC) {
+        errs() << "llvm-compact-index: error: " << OutputFilename << ": "
+               << EC.message() << "\n";
+        return 1;
+      }
+      Out << Buffer;
+    }
+
+    if (Dump) {
+      CompactSummaryIndex Compact = ExitOnErr(CompactSummaryIndex::create(
+          MemoryBufferRef(Buffer, MB->getBufferIdentifier())));
+      ExitOnErr(Compact.verify());
+      dumpIndex(Compact, outs());
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,126 @@
+//===-- llvm-lazy-load.cpp - Lazy bitcode loading benchmark ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program measures the cost of reading a few functions out of a large
+// bitcode file. It opens the file lazily, materializes the requested
+// functions and reports the time to the first function, the total time and
+// the memory used.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+static cl::opt<std::string>
+    InputFilename(cl::Positional, cl::desc("<input bitcode>"), cl::init("-"));
+
+static cl::list<std::string>
+    Functions("func", cl::desc("Function to materialize (may be repeated)"),
+              cl::value_desc("name"));
+
+static cl::opt<unsigned>
+    NumFunctions("n", cl::init(1),
+                 cl::desc("Number of functions to materialize in file order "
+                          "if no -func is given (0 materializes all)"));
+
+static cl::opt<bool>
+    LazyMetadata("lazy-metadata",
+                 cl::desc("Read the module-level metadata on demand"));
+
+static cl::opt<bool>
+    Importing("importing",
+              cl::desc("Read the module the way the ThinLTO function importer "
+                       "does, loading module-level metadata records only when "
+                       "they are referenced"));
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+  cl::ParseCommandLineOptions(argc, argv, "lazy bitcode loading benchmark\n");
+
+  ExitOnError ExitOnErr("llvm-lazy-load: error: ");
+  double Start = TimeRecord::getCurrentTime().getWallTime();
+  auto Elapsed = [&] {
+    return (TimeRecord::getCurrentTime().getWallTime() - Start) * 1000;
+  };
+
+  // Bitcode doesn't need a null terminator, so the file can always be
+  // mapped into memory instead of being read.
+  std::unique_ptr<MemoryBuffer> MB =
+      ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(
+          InputFilename, -1, /*RequiresNullTerminator=*/false)));
+  LLVMContext Context;
+  std::unique_ptr<Module> M = ExitOnErr(
+      getOwningLazyBitcodeModule(std::move(MB), Context, LazyMetadata,
+                                 Importing));
+  double ModuleTime = Elapsed();
+
+  std::vector<Function *> ToMaterialize;
+  if (!Functions.empty()) {
+    for (const std::string &Name : Functions) {
+      Function *F = M->getFunction(Name);
+      if (!F || F->isDeclaration()) {
+        errs() << "llvm-lazy-load: error: no function body for '" << Name
+               << "'\n";
+        return 1;
+      }
+      ToMaterialize.push_back(F);
+    }
+  } else {
+    for (Function &F : *M) {
+      if (F.isDeclaration())
+        continue;
+      if (NumFunctions && ToMaterialize.size() == NumFunctions)
+        break;
+      ToMaterialize.push_back(&F);
+    }
+  }
+
+  unsigned NumDefined = 0;
+  for (Function &F : *M)
+    if (!F.isDeclaration())
+      ++NumDefined;
+
+  double FirstFunctionTime = ModuleTime;
+  size_t NumInsts = 0;
+  for (Function *F : ToMaterialize) {
+    ExitOnErr(F->materialize());
+    if (F == ToMaterialize.front())
+      FirstFunctionTime = Elapsed();
+    for (BasicBlock &BB : *F)
+      NumInsts += BB.size();
+  }
+  double TotalTime = Elapsed();
+
+  outs() << "functions:      " << ToMaterialize.size() << " of " << NumDefined
+         << "\n";
+  outs() << "instructions:   " << NumInsts << "\n";
+  outs() << format("module:         %.3f ms\n", ModuleTime);
+  outs() << format("first function: %.3f ms\n", FirstFunctionTime);
+  outs() << format("total:          %.3f ms\n", TotalTime);
+  outs() << "malloc usage:   " << sys::Process::GetMallocUsage() / 1024
+         << " KB\n";
+  outs() << "peak RSS:       " << sys::Process::GetPeakMemoryUsage() / 1024
+         << " KB\n";
+  return 0;
+}
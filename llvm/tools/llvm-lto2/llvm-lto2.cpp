@@ -21,6 +21,7 @@
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/LTO/LTO.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/Threading.h"
 
@@ -48,6 +49,12 @@ static cl::opt<std::string> OutputFilename("o", cl::Required,
 static cl::opt<std::string> CacheDir("cache-dir", cl::desc("Cache Directory"),
                                      cl::value_desc("directory"));
 
+static cl::opt<std::string>
+    LTOCacheDir("lto-cache-dir",
+                cl::desc("Cache directory for the code generation partitions "
+                         "of regular LTO"),
+                cl::value_desc("directory"));
+
 static cl::opt<std::string> OptPipeline("opt-pipeline",
                                         cl::desc("Optimizer Pipeline"),
                                         cl::value_desc("pipeline"));
@@ -67,6 +74,10 @@ static cl::opt<bool>
 static cl::opt<int> Threads("thinlto-threads",
                             cl::init(llvm::heavyweight_hardware_concurrency()));
 
+static cl::opt<unsigned>
+    Partitions("lto-partitions", cl::init(1),
+               cl::desc("Number of regular LTO code generation partitions"));
+
 static cl::list<std::string> SymbolResolutions(
     "r",
     cl::desc("Specify a symbol resolution: filename,symbolname,resolution\n"
@@ -118,6 +129,9 @@ template <typename T> static T check(ErrorOr<T> E, std::string Msg) {
 }
 
 int main(int argc, char **argv) {
+  // Print the timing reports of -time-passes on exit.
+  llvm_shutdown_obj Y;
+
   InitializeAllTargets();
   InitializeAllTargetMCs();
   InitializeAllAsmPrinters();
@@ -201,13 +215,14 @@ int main(int argc, char **argv) {
 
   Conf.OverrideTriple = OverrideTriple;
   Conf.DefaultTriple = DefaultTriple;
+  Conf.ThinLinkThreads = Threads;
 
   ThinBackend Backend;
   if (ThinLTODistributedIndexes)
     Backend = createWriteIndexesThinBackend("", "", true, "");
   else
     Backend = createInProcessThinBackend(Threads);
-  LTO Lto(std::move(Conf), std::move(Backend));
+  LTO Lto(std::move(Conf), std::move(Backend), Partitions);
 
   bool HasErrors = false;
   for (std::string F : InputFilenames) {
@@ -269,6 +284,9 @@ int main(int argc, char **argv) {
   NativeObjectCache Cache;
   if (!CacheDir.empty())
     Cache = localCache(CacheDir, AddFile);
+  NativeObjectCache RegularLTOCache;
+  if (!LTOCacheDir.empty())
+    RegularLTOCache = localCache(LTOCacheDir, AddFile);
 
-  check(Lto.run(AddStream, Cache), "LTO::run failed");
+  check(Lto.run(AddStream, Cache, RegularLTOCache), "LTO::run failed");
 }
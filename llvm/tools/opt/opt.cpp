@@ -226,6 +226,11 @@ static cl::opt<bool> DiscardValueNames(
     cl::desc("Discard names from Value (other than GlobalValue)."),
     cl::init(false), cl::Hidden);
 
+static cl::opt<bool> IRArena(
+    "ir-arena",
+    cl::desc("Allocate the IR objects from an arena freed with the context"),
+    cl::init(false), cl::Hidden);
+
 static cl::opt<bool> Coroutines(
   "enable-coroutines",
   cl::desc("Enable coroutine passes."),
@@ -413,6 +418,8 @@ int main(int argc, char **argv) {
   SMDiagnostic Err;
 
   Context.setDiscardValueNames(DiscardValueNames);
+  if (IRArena)
+    Context.enableIRArena();
   if (!DisableDITypeMap)
     Context.enableDebugTypeODRUniquing();
 
@@ -0,0 +1,96 @@
+//===- IRArenaTest.cpp - IR arena allocation tests ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+using namespace llvm;
+
+namespace {
+
+static std::unique_ptr<Module> parseIR(LLVMContext &C, const char *IR) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> Mod = parseAssemblyString(IR, Err, C);
+  if (!Mod)
+    Err.print("IRArenaTest", errs());
+  return Mod;
+}
+
+static const char *LoopIR = "define i32 @f(i32 %n) {\n"
+                            "entry:\n"
+                            "  br label %loop\n"
+                            "loop:\n"
+                            "  %i = phi i32 [ 0, %entry ], [ %inc, %loop ]\n"
+                            "  %inc = add i32 %i, 1\n"
+                            "  %cmp = icmp slt i32 %inc, %n\n"
+                            "  br i1 %cmp, label %loop, label %exit\n"
+                            "exit:\n"
+                            "  ret i32 %inc\n"
+                            "}\n";
+
+TEST(IRArenaTest, AllocatesFromArena) {
+  LLVMContext C;
+  EXPECT_EQ(0u, C.getIRArenaSize());
+  C.enableIRArena();
+  std::unique_ptr<Module> M = parseIR(C, LoopIR);
+  ASSERT_TRUE(M != nullptr);
+  size_t Size = C.getIRArenaSize();
+  EXPECT_NE(0u, Size);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  // Grow the hung off operands of the phi and add new blocks, then delete
+  // some of the IR, which leaves the arena as it is.
+  Function *F = M->getFunction("f");
+  BasicBlock *Loop = &*std::next(F->begin());
+  PHINode *Phi = cast<PHINode>(&Loop->front());
+  BasicBlock *Latch = BasicBlock::Create(C, "latch", F);
+  IRBuilder<> B(Latch);
+  Value *Inc = B.CreateAdd(Phi, B.getInt32(2), "inc2");
+  B.CreateBr(Loop);
+  Phi->addIncoming(Inc, Latch);
+  Phi->addIncoming(Inc, Latch);
+  EXPECT_LT(Size, C.getIRArenaSize());
+
+  Size = C.getIRArenaSize();
+  Phi->removeIncomingValue(Latch, /*DeletePHIIfEmpty=*/false);
+  Phi->removeIncomingValue(Latch, /*DeletePHIIfEmpty=*/false);
+  Latch->eraseFromParent();
+  EXPECT_EQ(Size, C.getIRArenaSize());
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  // Objects created from the heap and from the arena can be mixed.
+  C.disableIRArena();
+  std::unique_ptr<Module> M2 = parseIR(C, LoopIR);
+  ASSERT_TRUE(M2 != nullptr);
+  EXPECT_EQ(Size, C.getIRArenaSize());
+  Function *F2 = M2->getFunction("f");
+  F2->removeFromParent();
+  M->getFunctionList().push_back(F2);
+  F2->setName("g");
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  M2.reset();
+  F->eraseFromParent();
+  M.reset();
+}
+
+TEST(IRArenaTest, DisabledByDefault) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = parseIR(C, LoopIR);
+  ASSERT_TRUE(M != nullptr);
+  EXPECT_EQ(0u, C.getIRArenaSize());
+}
+
+} // end anonymous namespace
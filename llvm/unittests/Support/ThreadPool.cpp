@@ -9,6 +9,7 @@
 
 #include "llvm/Support/ThreadPool.h"
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Triple.h"
@@ -164,3 +165,50 @@ TEST_F(ThreadPoolTest, PoolDestruction) {
   }
   ASSERT_EQ(5, checked_in);
 }
+
+TEST_F(ThreadPoolTest, TaskGroup) {
+  CHECK_UNSUPPORTED();
+  std::atomic_int checked_in{0};
+  ThreadPool Pool(2);
+  {
+    TaskGroup Group(Pool);
+    for (size_t i = 0; i < 100; ++i)
+      Group.spawn([&checked_in] { ++checked_in; });
+    Group.wait();
+    ASSERT_EQ(100, checked_in);
+    Group.spawn([&checked_in] { ++checked_in; });
+  }
+  ASSERT_EQ(101, checked_in);
+}
+
+static int parallelSum(ThreadPool &Pool, ArrayRef<int> Values) {
+  if (Values.size() <= 4) {
+    int Sum = 0;
+    for (int V : Values)
+      Sum += V;
+    return Sum;
+  }
+  size_t Half = Values.size() / 2;
+  int Left, Right;
+  {
+    TaskGroup Group(Pool);
+    Group.spawn([&] { Left = parallelSum(Pool, Values.take_front(Half)); });
+    Right = parallelSum(Pool, Values.drop_front(Half));
+  }
+  return Left + Right;
+}
+
+TEST_F(ThreadPoolTest, NestedTaskGroups) {
+  CHECK_UNSUPPORTED();
+  // Test that tasks can wait for nested groups without deadlocking, even if
+  // there are more nested groups than threads.
+  std::vector<int> Values(1000);
+  for (size_t i = 0; i < Values.size(); ++i)
+    Values[i] = i;
+
+  ThreadPool Pool(2);
+  int Sum = 0;
+  Pool.async([&] { Sum = parallelSum(Pool, Values); });
+  Pool.wait();
+  ASSERT_EQ(999 * 1000 / 2, Sum);
+}
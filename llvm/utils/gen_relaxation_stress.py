@@ -0,0 +1,61 @@
+#!/usr/bin/env python
+"""A generator of assembly files which stress the relaxation of the assembler.
+
+This program writes an x86-64 assembly file with the given number of
+functions. Each function is made of basic blocks with branches to the next and
+to the first block of the function, padded with .p2align directives, and of
+.loc directives, so the object has millions of fragments which depend on each
+other through branch displacements, alignment padding and line table address
+deltas. The branches start as short branches and a fraction of them has to be
+relaxed to near branches, which cascades through the offsets of the following
+blocks.
+
+Use it to measure the time the assembler spends in relaxation:
+
+  gen_relaxation_stress.py 100000 > stress.s
+  time llvm-mc -triple x86_64-linux-gnu -filetype=obj -stats stress.s -o /dev/null
+"""
+
+from __future__ import print_function
+import argparse
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('functions', type=int, help="Number of functions")
+  parser.add_argument('--blocks', type=int, default=16,
+                      help="Number of basic blocks per function")
+  parser.add_argument('--block-size', type=int, default=24,
+                      help="Number of bytes of padding in each basic block")
+  parser.add_argument('--align-every', type=int, default=4,
+                      help="Align one basic block out of this many to 16 "
+                           "bytes, 0 to disable")
+  args = parser.parse_args()
+
+  print("\t.text")
+  print("\t.file\t1 \"stress.c\"")
+  line = 1
+  for f in range(args.functions):
+    print("\t.globl\tf%d" % f)
+    print("\t.type\tf%d,@function" % f)
+    print("f%d:" % f)
+    print("\t.cfi_startproc")
+    for b in range(args.blocks):
+      if args.align_every and b % args.align_every == 0:
+        print("\t.p2align\t4, 0x90")
+      print(".Lf%d_%d:" % (f, b))
+      print("\t.loc\t1 %d 0" % line)
+      line += 1
+      print("\t.fill\t%d, 1, 0x90" % args.block_size)
+      # The displacement of the back edges grows with the function, so the
+      # later ones need the near form.
+      print("\tjne\t.Lf%d_0" % f)
+      if b + 1 != args.blocks:
+        print("\tje\t.Lf%d_%d" % (f, b + 1))
+    print("\tretq")
+    print("\t.cfi_endproc")
+    print(".Lf%d_end:" % f)
+    print("\t.size\tf%d, .Lf%d_end-f%d" % (f, f, f))
+
+if __name__ == '__main__':
+  main()